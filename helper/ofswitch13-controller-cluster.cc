@@ -0,0 +1,482 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include <ns3/log.h>
+#include <ns3/hash.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include "ofswitch13-controller-cluster.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13ControllerCluster");
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13ControllerCluster);
+
+OFSwitch13ControllerCluster::OFSwitch13ControllerCluster ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OFSwitch13ControllerCluster::~OFSwitch13ControllerCluster ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13ControllerCluster::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13ControllerCluster")
+    .SetParent<Object> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13ControllerCluster> ()
+    .AddAttribute ("VirtualNodes",
+                   "The number of virtual nodes for each controller in the "
+                   "consistent hashing ring.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (
+                     &OFSwitch13ControllerCluster::m_virtualNodes),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("SyncDelay",
+                   "The inter-controller latency for replicating key-value "
+                   "store updates.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&OFSwitch13ControllerCluster::m_syncDelay),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("FailureDetectionDelay",
+                   "The time to detect a controller failure or recovery "
+                   "before rebalancing switch ownership.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (
+                     &OFSwitch13ControllerCluster::m_detectDelay),
+                   MakeTimeChecker (Time (0)))
+    .AddTraceSource ("OwnerChange",
+                     "Trace source indicating a switch ownership change.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13ControllerCluster::m_ownerTrace),
+                     "ns3::OFSwitch13ControllerCluster::OwnerTracedCallback")
+    .AddTraceSource ("StoreUpdate",
+                     "Trace source indicating a replica applied an update "
+                     "from another controller.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13ControllerCluster::m_storeTrace),
+                     "ns3::OFSwitch13ControllerCluster::StoreTracedCallback")
+  ;
+  return tid;
+}
+
+void
+OFSwitch13ControllerCluster::AddController (Ptr<OFSwitch13Controller> ctrl)
+{
+  NS_LOG_FUNCTION (this << ctrl);
+
+  NS_ASSERT_MSG (ctrl, "Invalid controller application.");
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      NS_ABORT_MSG_IF (m_members [i].m_ctrl == ctrl,
+                       "Controller already in this cluster.");
+    }
+
+  Member member;
+  member.m_ctrl = ctrl;
+  member.m_alive = true;
+  member.m_clock = 0;
+  m_members.push_back (member);
+
+  // The trace context identifies the controller index.
+  std::ostringstream context;
+  context << m_members.size () - 1;
+  ctrl->TraceConnect (
+    "SwitchConnection", context.str (), MakeCallback (
+      &OFSwitch13ControllerCluster::NotifySwitchConnection, this));
+
+  Rebalance ();
+}
+
+uint32_t
+OFSwitch13ControllerCluster::GetNControllers (void) const
+{
+  return m_members.size ();
+}
+
+Ptr<OFSwitch13Controller>
+OFSwitch13ControllerCluster::GetController (uint32_t idx) const
+{
+  NS_ASSERT_MSG (idx < m_members.size (), "Controller index out of range.");
+  return m_members [idx].m_ctrl;
+}
+
+Ptr<OFSwitch13Controller>
+OFSwitch13ControllerCluster::GetOwner (uint64_t dpId) const
+{
+  NS_LOG_FUNCTION (this << dpId);
+
+  OwnerMap_t::const_iterator it = m_owners.find (dpId);
+  uint32_t idx = (it != m_owners.end ()) ? it->second : Lookup (dpId);
+  if (idx < m_members.size ())
+    {
+      return m_members [idx].m_ctrl;
+    }
+  return 0;
+}
+
+bool
+OFSwitch13ControllerCluster::IsAlive (Ptr<OFSwitch13Controller> ctrl) const
+{
+  return m_members [GetIndex (ctrl)].m_alive;
+}
+
+void
+OFSwitch13ControllerCluster::FailController (Ptr<OFSwitch13Controller> ctrl)
+{
+  NS_LOG_FUNCTION (this << ctrl);
+
+  uint32_t idx = GetIndex (ctrl);
+  if (m_members [idx].m_alive)
+    {
+      NS_LOG_INFO ("Controller " << idx << " failed.");
+      m_members [idx].m_alive = false;
+      Simulator::Schedule (m_detectDelay,
+                           &OFSwitch13ControllerCluster::Rebalance, this);
+    }
+}
+
+void
+OFSwitch13ControllerCluster::RecoverController (Ptr<OFSwitch13Controller> ctrl)
+{
+  NS_LOG_FUNCTION (this << ctrl);
+
+  uint32_t idx = GetIndex (ctrl);
+  if (!m_members [idx].m_alive)
+    {
+      NS_LOG_INFO ("Controller " << idx << " recovered.");
+      m_members [idx].m_alive = true;
+      Simulator::Schedule (m_syncDelay,
+                           &OFSwitch13ControllerCluster::SyncReplica,
+                           this, idx);
+      Simulator::Schedule (m_detectDelay,
+                           &OFSwitch13ControllerCluster::Join, this, idx);
+    }
+}
+
+void
+OFSwitch13ControllerCluster::Put (Ptr<OFSwitch13Controller> ctrl,
+                                  const std::string &key,
+                                  const std::string &value)
+{
+  NS_LOG_FUNCTION (this << ctrl << key << value);
+
+  Write (GetIndex (ctrl), key, value, false);
+}
+
+void
+OFSwitch13ControllerCluster::Erase (Ptr<OFSwitch13Controller> ctrl,
+                                    const std::string &key)
+{
+  NS_LOG_FUNCTION (this << ctrl << key);
+
+  Write (GetIndex (ctrl), key, std::string (), true);
+}
+
+bool
+OFSwitch13ControllerCluster::Get (Ptr<OFSwitch13Controller> ctrl,
+                                  const std::string &key,
+                                  std::string &value) const
+{
+  NS_LOG_FUNCTION (this << ctrl << key);
+
+  const Store_t &store = m_members [GetIndex (ctrl)].m_store;
+  Store_t::const_iterator it = store.find (key);
+  if (it == store.end () || it->second.m_erased)
+    {
+      return false;
+    }
+  value = it->second.m_value;
+  return true;
+}
+
+void
+OFSwitch13ControllerCluster::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+
+  // The trace sinks are bound to this cluster without holding a reference,
+  // so they must be disconnected before the cluster goes away.
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      m_members [i].m_ctrl->TraceDisconnect (
+        "SwitchConnection", context.str (), MakeCallback (
+          &OFSwitch13ControllerCluster::NotifySwitchConnection, this));
+    }
+  m_members.clear ();
+  m_ring.clear ();
+  m_owners.clear ();
+  Object::DoDispose ();
+}
+
+uint32_t
+OFSwitch13ControllerCluster::GetIndex (Ptr<OFSwitch13Controller> ctrl) const
+{
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      if (m_members [i].m_ctrl == ctrl)
+        {
+          return i;
+        }
+    }
+  NS_ABORT_MSG ("Controller not in this cluster.");
+}
+
+void
+OFSwitch13ControllerCluster::BuildRing (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_ring.clear ();
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      if (!m_members [i].m_alive)
+        {
+          continue;
+        }
+      for (uint32_t v = 0; v < m_virtualNodes; v++)
+        {
+          uint32_t point [2] = {i, v};
+          m_ring [Hash32 ((const char*)point, sizeof (point))] = i;
+        }
+    }
+}
+
+uint32_t
+OFSwitch13ControllerCluster::Lookup (uint64_t dpId) const
+{
+  if (m_ring.empty ())
+    {
+      return m_members.size ();
+    }
+
+  // The owner is the first virtual node clockwise from the switch hash.
+  uint32_t hash = Hash32 ((const char*)&dpId, sizeof (dpId));
+  Ring_t::const_iterator it = m_ring.lower_bound (hash);
+  if (it == m_ring.end ())
+    {
+      it = m_ring.begin ();
+    }
+  return it->second;
+}
+
+void
+OFSwitch13ControllerCluster::Rebalance (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  BuildRing ();
+  if (m_ring.empty ())
+    {
+      NS_LOG_WARN ("No live controllers in the cluster.");
+      return;
+    }
+
+  for (OwnerMap_t::iterator it = m_owners.begin ();
+       it != m_owners.end (); it++)
+    {
+      uint32_t oldOwner = it->second;
+      uint32_t newOwner = Lookup (it->first);
+      if (newOwner == oldOwner)
+        {
+          continue;
+        }
+
+      NS_LOG_INFO ("Switch " << it->first << " moved from controller " <<
+                   oldOwner << " to controller " << newOwner);
+      it->second = newOwner;
+      m_ownerTrace (it->first, oldOwner, newOwner);
+
+      // Demote the previous owner before promoting the new one.
+      AssignRole (oldOwner, it->first);
+      AssignRole (newOwner, it->first);
+    }
+}
+
+void
+OFSwitch13ControllerCluster::Join (uint32_t idx)
+{
+  NS_LOG_FUNCTION (this << idx);
+
+  if (idx >= m_members.size () || !m_members [idx].m_alive)
+    {
+      return;
+    }
+
+  // The switches may have demoted this controller while it was failed.
+  Rebalance ();
+  std::set<uint64_t>::iterator it;
+  for (it = m_members [idx].m_switches.begin ();
+       it != m_members [idx].m_switches.end (); it++)
+    {
+      OwnerMap_t::iterator ownerIt = m_owners.find (*it);
+      if (ownerIt != m_owners.end () && ownerIt->second != idx)
+        {
+          AssignRole (idx, *it);
+        }
+    }
+}
+
+void
+OFSwitch13ControllerCluster::AssignRole (uint32_t idx, uint64_t dpId)
+{
+  NS_LOG_FUNCTION (this << idx << dpId);
+
+  Member &member = m_members [idx];
+  if (!member.m_alive || member.m_switches.count (dpId) == 0)
+    {
+      return;
+    }
+
+  enum ofp_controller_role role = OFPCR_ROLE_SLAVE;
+  if (m_owners [dpId] == idx)
+    {
+      role = OFPCR_ROLE_MASTER;
+    }
+  member.m_ctrl->RequestRole (dpId, role);
+}
+
+void
+OFSwitch13ControllerCluster::NotifySwitchConnection (std::string context,
+                                                     uint64_t dpId,
+                                                     bool connected)
+{
+  NS_LOG_FUNCTION (this << context << dpId << connected);
+
+  uint32_t idx = std::strtoul (context.c_str (), 0, 10);
+  NS_ASSERT_MSG (idx < m_members.size (), "Invalid controller index.");
+  if (!connected)
+    {
+      m_members [idx].m_switches.erase (dpId);
+      return;
+    }
+
+  m_members [idx].m_switches.insert (dpId);
+  if (m_owners.find (dpId) == m_owners.end ())
+    {
+      uint32_t owner = Lookup (dpId);
+      if (owner == m_members.size ())
+        {
+          return;
+        }
+      m_owners [dpId] = owner;
+    }
+  AssignRole (idx, dpId);
+}
+
+void
+OFSwitch13ControllerCluster::Write (uint32_t idx, const std::string &key,
+                                    const std::string &value, bool erased)
+{
+  NS_LOG_FUNCTION (this << idx << key << erased);
+
+  Member &member = m_members [idx];
+  if (!member.m_alive)
+    {
+      NS_LOG_WARN ("Ignoring store write from failed controller " << idx);
+      return;
+    }
+
+  StoreEntry entry;
+  entry.m_value = value;
+  entry.m_version = ++member.m_clock;
+  entry.m_origin = idx;
+  entry.m_erased = erased;
+  member.m_store [key] = entry;
+
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      if (i != idx && m_members [i].m_alive)
+        {
+          Simulator::Schedule (m_syncDelay,
+                               &OFSwitch13ControllerCluster::Replicate,
+                               this, i, key, entry);
+        }
+    }
+}
+
+void
+OFSwitch13ControllerCluster::Replicate (uint32_t idx, std::string key,
+                                        StoreEntry entry)
+{
+  NS_LOG_FUNCTION (this << idx << key);
+
+  // Updates to failed replicas are lost. They catch up on recovery.
+  if (idx < m_members.size () && m_members [idx].m_alive)
+    {
+      Merge (idx, key, entry);
+    }
+}
+
+void
+OFSwitch13ControllerCluster::Merge (uint32_t idx, const std::string &key,
+                                    const StoreEntry &entry)
+{
+  Member &member = m_members [idx];
+  member.m_clock = std::max (member.m_clock, entry.m_version);
+
+  // Last-writer-wins, with the writer index breaking timestamp ties.
+  Store_t::iterator it = member.m_store.find (key);
+  if (it != member.m_store.end ()
+      && (it->second.m_version > entry.m_version
+          || (it->second.m_version == entry.m_version
+              && it->second.m_origin >= entry.m_origin)))
+    {
+      return;
+    }
+  member.m_store [key] = entry;
+  m_storeTrace (idx, key);
+}
+
+void
+OFSwitch13ControllerCluster::SyncReplica (uint32_t idx)
+{
+  NS_LOG_FUNCTION (this << idx);
+
+  if (idx >= m_members.size () || !m_members [idx].m_alive)
+    {
+      return;
+    }
+
+  for (uint32_t i = 0; i < m_members.size (); i++)
+    {
+      if (i == idx || !m_members [i].m_alive)
+        {
+          continue;
+        }
+      Store_t::const_iterator it;
+      for (it = m_members [i].m_store.begin ();
+           it != m_members [i].m_store.end (); it++)
+        {
+          Merge (idx, it->first, it->second);
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_CONTROLLER_CLUSTER_H
+#define OFSWITCH13_CONTROLLER_CLUSTER_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/traced-callback.h>
+#include <ns3/ofswitch13-controller.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ * \brief This class groups a set of OpenFlow controller applications into a
+ * logical cluster that partitions the switches among the controllers.
+ *
+ * Each switch is owned by a single controller, selected by consistent hashing
+ * of the switch datapath ID over a ring with a number of virtual nodes for
+ * each live controller. Switches are expected to connect to all controllers
+ * in the cluster: the owner requests the master role over the switch, while
+ * the other controllers request the slave role (see
+ * OFSwitch13Controller::RequestRole). When a controller fails or recovers,
+ * the cluster rebuilds the ring after the failure detection delay and moves
+ * only the switches whose owner changed.
+ *
+ * The cluster also maintains a replicated key-value store, with one replica
+ * for each controller. Writes are applied to the local replica immediately
+ * and delivered to the remaining live replicas after the synchronization
+ * delay, which models the inter-controller latency. Conflicting writes are
+ * resolved with last-writer-wins semantics based on Lamport timestamps. A
+ * recovered controller pulls the contents of live replicas to catch up.
+ *
+ * \attention Controller failures are logical: a failed controller stops
+ * taking part in ownership and replication, but its application keeps
+ * running. Controllers in the cluster should keep the InitialRole attribute
+ * set to Equal, as roles are assigned by the cluster.
+ */
+class OFSwitch13ControllerCluster : public Object
+{
+public:
+  OFSwitch13ControllerCluster ();          //!< Default constructor.
+  virtual ~OFSwitch13ControllerCluster (); //!< Dummy destructor.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Add a controller application to this cluster. Controllers must be added
+   * before switches connect to them.
+   * \param ctrl The controller application.
+   */
+  void AddController (Ptr<OFSwitch13Controller> ctrl);
+
+  /**
+   * Get the number of controllers in this cluster.
+   * \return The number of controllers.
+   */
+  uint32_t GetNControllers (void) const;
+
+  /**
+   * Get the controller application at the given index.
+   * \param idx The controller index.
+   * \return The controller application.
+   */
+  Ptr<OFSwitch13Controller> GetController (uint32_t idx) const;
+
+  /**
+   * Get the controller that owns the switch.
+   * \param dpId The OpenFlow datapath ID.
+   * \return The owner controller, or 0 when no live controllers.
+   */
+  Ptr<OFSwitch13Controller> GetOwner (uint64_t dpId) const;
+
+  /**
+   * Check for a live controller.
+   * \param ctrl The controller application.
+   * \return True when the controller is alive.
+   */
+  bool IsAlive (Ptr<OFSwitch13Controller> ctrl) const;
+
+  /**
+   * \name Controller failure and recovery.
+   * Mark the controller as failed (or live) in this cluster. Replication
+   * is updated immediately, while switch ownership is rebalanced after the
+   * failure detection delay.
+   * \param ctrl The controller application.
+   */
+  //\{
+  void FailController    (Ptr<OFSwitch13Controller> ctrl);
+  void RecoverController (Ptr<OFSwitch13Controller> ctrl);
+  //\}
+
+  /**
+   * \name Replicated key-value store.
+   * Write (or erase) a key using the replica of the given controller, or
+   * read a key from that replica. Writes from failed controllers are
+   * ignored.
+   * \param ctrl The controller application.
+   * \param key The key.
+   * \param value The value.
+   * \return For Get (), true when the key was found.
+   */
+  //\{
+  void Put   (Ptr<OFSwitch13Controller> ctrl, const std::string &key,
+              const std::string &value);
+  void Erase (Ptr<OFSwitch13Controller> ctrl, const std::string &key);
+  bool Get   (Ptr<OFSwitch13Controller> ctrl, const std::string &key,
+              std::string &value) const;
+  //\}
+
+  /**
+   * TracedCallback signature for switch ownership changes.
+   * \param dpId The OpenFlow datapath ID.
+   * \param oldOwner The previous owner controller index.
+   * \param newOwner The new owner controller index.
+   */
+  typedef void (*OwnerTracedCallback)(uint64_t dpId, uint32_t oldOwner,
+                                      uint32_t newOwner);
+
+  /**
+   * TracedCallback signature for replicated store updates.
+   * \param idx The index of the controller whose replica was updated.
+   * \param key The updated key.
+   */
+  typedef void (*StoreTracedCallback)(uint32_t idx, const std::string &key);
+
+protected:
+  /** Destructor implementation. */
+  virtual void DoDispose ();
+
+private:
+  /** A single versioned entry in the replicated store. */
+  struct StoreEntry
+  {
+    std::string m_value;    //!< Entry value.
+    uint64_t    m_version;  //!< Lamport timestamp.
+    uint32_t    m_origin;   //!< Writer controller index.
+    bool        m_erased;   //!< Erased entry (tombstone).
+  };
+
+  /** Map saving store entries by key */
+  typedef std::map<std::string, StoreEntry> Store_t;
+
+  /** A single controller in the cluster. */
+  struct Member
+  {
+    Ptr<OFSwitch13Controller> m_ctrl;     //!< Controller application.
+    bool                      m_alive;    //!< Live controller.
+    uint64_t                  m_clock;    //!< Lamport clock.
+    Store_t                   m_store;    //!< Store replica.
+    std::set<uint64_t>        m_switches; //!< Connected switches.
+  };
+
+  /** List of cluster members */
+  typedef std::vector<Member> MemberList_t;
+
+  /** Map saving controller indexes by hash ring position */
+  typedef std::map<uint32_t, uint32_t> Ring_t;
+
+  /** Map saving owner controller indexes by datapath ID */
+  typedef std::map<uint64_t, uint32_t> OwnerMap_t;
+
+  /**
+   * Get the index of a controller in this cluster.
+   * \param ctrl The controller application.
+   * \return The controller index.
+   */
+  uint32_t GetIndex (Ptr<OFSwitch13Controller> ctrl) const;
+
+  /**
+   * Rebuild the hash ring with the virtual nodes of live controllers.
+   */
+  void BuildRing (void);
+
+  /**
+   * Look for the controller owning the switch in the hash ring.
+   * \param dpId The OpenFlow datapath ID.
+   * \return The controller index, or the number of controllers when the
+   *         ring is empty.
+   */
+  uint32_t Lookup (uint64_t dpId) const;
+
+  /**
+   * Rebuild the hash ring and move switches whose owner changed, demoting
+   * the previous owner and promoting the new one.
+   */
+  void Rebalance (void);
+
+  /**
+   * Rebalance after a controller recovery, and also demote the recovered
+   * controller on switches it does not own.
+   * \param idx The recovered controller index.
+   */
+  void Join (uint32_t idx);
+
+  /**
+   * Request the master or slave role for the controller over the switch,
+   * according to the current ownership.
+   * \param idx The controller index.
+   * \param dpId The OpenFlow datapath ID.
+   */
+  void AssignRole (uint32_t idx, uint64_t dpId);
+
+  /**
+   * Notify when a switch connects to or disconnects from a controller.
+   * \param context The controller index.
+   * \param dpId The OpenFlow datapath ID.
+   * \param connected True after the handshake, false when disconnected.
+   */
+  void NotifySwitchConnection (std::string context, uint64_t dpId,
+                               bool connected);
+
+  /**
+   * Write an entry into the local replica and replicate it to the others.
+   * \param idx The writer controller index.
+   * \param key The key.
+   * \param value The value.
+   * \param erased True for erasing the key.
+   */
+  void Write (uint32_t idx, const std::string &key, const std::string &value,
+              bool erased);
+
+  /**
+   * Deliver a replicated entry to a controller replica.
+   * \param idx The destination controller index.
+   * \param key The key.
+   * \param entry The store entry.
+   */
+  void Replicate (uint32_t idx, std::string key, StoreEntry entry);
+
+  /**
+   * Merge an entry into a controller replica, keeping the newest one.
+   * \param idx The controller index.
+   * \param key The key.
+   * \param entry The store entry.
+   */
+  void Merge (uint32_t idx, const std::string &key, const StoreEntry &entry);
+
+  /**
+   * Pull the contents of live replicas into a recovered replica.
+   * \param idx The recovered controller index.
+   */
+  void SyncReplica (uint32_t idx);
+
+  MemberList_t  m_members;        //!< Cluster members.
+  Ring_t        m_ring;           //!< Consistent hashing ring.
+  OwnerMap_t    m_owners;         //!< Switch owners.
+  uint32_t      m_virtualNodes;   //!< Virtual nodes per controller.
+  Time          m_syncDelay;      //!< Inter-controller latency.
+  Time          m_detectDelay;    //!< Failure detection delay.
+
+  /** Trace source fired when a switch changes its owner. */
+  TracedCallback<uint64_t, uint32_t, uint32_t> m_ownerTrace;
+
+  /** Trace source fired when a replica applies a remote update. */
+  TracedCallback<uint32_t, const std::string&> m_storeTrace;
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_CONTROLLER_CLUSTER_H */
@@ -66,7 +66,9 @@ OFSwitch13Helper::GetTypeId (void)
                    MakeEnumChecker (
                      OFSwitch13Helper::SINGLECSMA,    "SingleCsma",
                      OFSwitch13Helper::DEDICATEDCSMA, "DedicatedCsma",
-                     OFSwitch13Helper::DEDICATEDP2P,  "DedicatedP2p"))
+                     OFSwitch13Helper::DEDICATEDP2P,  "DedicatedP2p",
+                     OFSwitch13Helper::DIRECT,        "Direct",
+                     OFSwitch13Helper::TREEP2P,       "TreeP2p"))
   ;
   return tid;
 }
@@ -111,10 +113,16 @@ OFSwitch13Helper::EnableOpenFlowPcap (std::string prefix, bool promiscuous)
         break;
       }
     case OFSwitch13Helper::DEDICATEDP2P:
+    case OFSwitch13Helper::TREEP2P:
       {
         m_p2pHelper.EnablePcap (prefix, m_controlDevs, promiscuous);
         break;
       }
+    case OFSwitch13Helper::DIRECT:
+      {
+        NS_LOG_WARN ("No pcap traces for direct OpenFlow channels.");
+        break;
+      }
     default:
       {
         NS_ABORT_MSG ("Invalid OpenflowChannelType.");
@@ -138,10 +146,16 @@ OFSwitch13Helper::EnableOpenFlowAscii (std::string prefix)
         break;
       }
     case OFSwitch13Helper::DEDICATEDP2P:
+    case OFSwitch13Helper::TREEP2P:
       {
         m_p2pHelper.EnableAsciiAll (ascii.CreateFileStream (prefix + ".txt"));
         break;
       }
+    case OFSwitch13Helper::DIRECT:
+      {
+        NS_LOG_WARN ("No ascii traces for direct OpenFlow channels.");
+        break;
+      }
     default:
       {
         NS_ABORT_MSG ("Invalid OpenflowChannelType.");
@@ -204,8 +218,11 @@ OFSwitch13Helper::InstallSwitch (Ptr<Node> swNode, NetDeviceContainer ports)
   NS_LOG_INFO ("Installing OpenFlow device on node " << swNode->GetId ());
   NS_ASSERT_MSG (!m_blocked, "OpenFlow channels already configured.");
 
-  // Install the TCP/IP stack into switch node.
-  m_internet.Install (swNode);
+  // Install the TCP/IP stack into switch node (not used by direct channels).
+  if (m_channelType != OFSwitch13Helper::DIRECT)
+    {
+      m_internet.Install (swNode);
+    }
 
   // Create and aggregate the OpenFlow device to the switch node.
   Ptr<OFSwitch13Device> openFlowDev = m_devFactory.Create<OFSwitch13Device> ();
@@ -240,6 +257,20 @@ OFSwitch13Helper::InstallSwitch (NodeContainer swNodes)
   return openFlowDevices;
 }
 
+int64_t
+OFSwitch13Helper::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  int64_t currentStream = stream;
+  OFSwitch13DeviceContainer::Iterator it;
+  for (it = m_openFlowDevs.Begin (); it != m_openFlowDevs.End (); it++)
+    {
+      currentStream += (*it)->AssignStreams (currentStream);
+    }
+  return (currentStream - stream);
+}
+
 void
 OFSwitch13Helper::SetAddressBase (Ipv4Address network, Ipv4Mask mask,
                                   Ipv4Address base)
@@ -57,7 +57,13 @@ class OFSwitch13LearningController;
  * using a /24 network mask. Users can modify this configuration by changing
  * the ChannelType attribute at instantiation time. Dedicated out-of-band
  * connections over CSMA or Point-to-Point channels are also available, using a
- * /30 network mask for IP allocation.
+ * /30 network mask for IP allocation. The internal helper also supports direct
+ * in-process channels (see OFSwitch13DirectChannel), which deliver OpenFlow
+ * messages without any network device or TCP/IP stack. In this case, IP
+ * addresses are only used to identify switches and controllers. Finally, the
+ * internal helper can build a tree-shaped management network, where switches
+ * are the leaves, controllers are attached to the root, and the inner nodes
+ * are IP routers connected by Point-to-Point links, using a /30 network mask.
  *
  * Please note that this base helper class was designed to configure a single
  * OpenFlow network domain. All switches will be connected to all controllers
@@ -79,7 +85,9 @@ public:
   {
     SINGLECSMA = 0,       //!< Uses a single shared CSMA channel.
     DEDICATEDCSMA = 1,    //!< Uses individual CSMA channels.
-    DEDICATEDP2P = 2      //!< Uses individual P2P channels.
+    DEDICATEDP2P = 2,     //!< Uses individual P2P channels.
+    DIRECT = 3,           //!< Uses individual in-process direct channels.
+    TREEP2P = 4           //!< Uses a tree of P2P links and routers.
   };
 
   OFSwitch13Helper ();          //!< Default constructor.
@@ -180,6 +188,15 @@ public:
    */
   virtual void CreateOpenFlowChannels (void) = 0;
 
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by the OpenFlow switch devices configured by this helper.
+   * \attention Call this method only after adding the switch ports.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned by this helper.
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+
   /**
    * Set the IP network base address, used to assign IP addresses to switches
    * and controllers during the CreateOpenFlowChannels () procedure.
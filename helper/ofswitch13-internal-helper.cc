@@ -22,6 +22,8 @@
 
 #include "ofswitch13-internal-helper.h"
 #include <ns3/ofswitch13-learning-controller.h>
+#include <ns3/ofswitch13-direct-channel.h>
+#include <ns3/ipv4-static-routing-helper.h>
 
 namespace ns3 {
 
@@ -47,6 +49,13 @@ OFSwitch13InternalHelper::GetTypeId (void)
     .SetParent<OFSwitch13Helper> ()
     .SetGroupName ("OFSwitch13")
     .AddConstructor<OFSwitch13InternalHelper> ()
+    .AddAttribute ("TreeFanOut",
+                   "The maximum number of children of each aggregation node "
+                   "in the TreeP2p management network.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (
+                     &OFSwitch13InternalHelper::m_treeFanOut),
+                   MakeUintegerChecker<uint32_t> (2))
   ;
   return tid;
 }
@@ -108,24 +117,7 @@ OFSwitch13InternalHelper::CreateOpenFlowChannels (void)
     case OFSwitch13InternalHelper::DEDICATEDCSMA:
     case OFSwitch13InternalHelper::DEDICATEDP2P:
       {
-        // Setting channel/device data rates.
-        m_p2pHelper.SetDeviceAttribute (
-          "DataRate", DataRateValue (m_channelDataRate));
-        m_csmaHelper.SetChannelAttribute (
-          "DataRate", DataRateValue (m_channelDataRate));
-
-        // To avoid IP datagram fragmentation, we are configuring the OpenFlow
-        // channel devices with a very large MTU value. The TCP sockets used to
-        // send packets to theses devices are also configured to use a large
-        // segment size at OFSwitch13Controller and OFSwitch13Device.
-        m_csmaHelper.SetDeviceAttribute ("Mtu", UintegerValue (9000));
-        m_p2pHelper.SetDeviceAttribute ("Mtu", UintegerValue (9000));
-
-        // Using large queues on devices to avoid losing packets.
-        m_csmaHelper.SetQueue ("ns3::DropTailQueue<Packet>",
-                               "MaxSize", StringValue ("65536p"));
-        m_p2pHelper.SetQueue ("ns3::DropTailQueue<Packet>",
-                              "MaxSize", StringValue ("65536p"));
+        ConfigureLinkHelpers ();
 
         // Create individual channels for each pair switch/controller.
         UintegerValue portValue;
@@ -159,6 +151,211 @@ OFSwitch13InternalHelper::CreateOpenFlowChannels (void)
           }
         break;
       }
+    case OFSwitch13InternalHelper::DIRECT:
+      {
+        NS_LOG_INFO ("Connect switches and controllers using direct "
+                     "channels.");
+
+        // Without network devices, IP addresses are only used to identify
+        // the ends of each channel.
+        std::vector<Address> controllerAddrs;
+        UintegerValue portValue;
+        for (uint32_t ctIdx = 0; ctIdx < m_controlNodes.GetN (); ctIdx++)
+          {
+            m_controlApps.Get (ctIdx)->GetAttribute ("Port", portValue);
+            controllerAddrs.push_back (
+              InetSocketAddress (m_ipv4helper.NewAddress (), portValue.Get ()));
+          }
+
+        ObjectFactory channelFactory ("ns3::OFSwitch13DirectChannel");
+        channelFactory.Set ("DataRate", DataRateValue (m_channelDataRate));
+        for (uint32_t swIdx = 0; swIdx < m_switchNodes.GetN (); swIdx++)
+          {
+            Ptr<OFSwitch13Device> ofDev = m_openFlowDevs.Get (swIdx);
+            Address swAddr =
+              InetSocketAddress (m_ipv4helper.NewAddress (), 0);
+
+            for (uint32_t ctIdx = 0; ctIdx < m_controlNodes.GetN (); ctIdx++)
+              {
+                Ptr<OFSwitch13Controller> ctApp =
+                  DynamicCast<OFSwitch13Controller> (m_controlApps.Get (ctIdx));
+                Ptr<OFSwitch13DirectChannel> channel =
+                  channelFactory.Create<OFSwitch13DirectChannel> ();
+                m_directChannels.push_back (channel);
+                Ptr<OFSwitch13SocketHandler> ctrlEnd =
+                  channel->CreateHandler (controllerAddrs [ctIdx]);
+                Ptr<OFSwitch13SocketHandler> swEnd =
+                  channel->CreateHandler (swAddr);
+
+                NS_LOG_INFO ("Connect switch " << ofDev->GetDatapathId () <<
+                             " to controller " <<
+                             InetSocketAddress::ConvertFrom (
+                               controllerAddrs [ctIdx]).GetIpv4 ());
+                Simulator::ScheduleNow (
+                  &OFSwitch13Device::StartDirectConnection,
+                  ofDev, swEnd, controllerAddrs [ctIdx]);
+                Simulator::ScheduleNow (
+                  &OFSwitch13Controller::AcceptDirectConnection,
+                  ctApp, ctrlEnd, swAddr);
+              }
+          }
+        m_ipv4helper.NewNetwork ();
+        break;
+      }
+    case OFSwitch13InternalHelper::TREEP2P:
+      {
+        NS_LOG_INFO ("Connect switches and controllers using a tree-shaped "
+                     "management network with fan-out " << m_treeFanOut);
+        if (m_switchNodes.GetN () == 0)
+          {
+            NS_LOG_WARN ("No switches to connect.");
+            break;
+          }
+        ConfigureLinkHelpers ();
+
+        // The tree is built bottom-up, with the switches as leaves. Each
+        // subtree gets an aligned block of addresses (a power of two) that
+        // holds the /30 subnets of the leaf links below it, so each node has
+        // a default route toward its parent and a single network route
+        // toward each child aggregation node.
+        std::vector<NodeContainer> levels (1, m_switchNodes);
+        std::vector<std::vector<uint32_t> > sizes (
+          1, std::vector<uint32_t> (m_switchNodes.GetN (), 4));
+        do
+          {
+            const NodeContainer &children = levels.back ();
+            uint32_t nParents =
+              (children.GetN () + m_treeFanOut - 1) / m_treeFanOut;
+            NodeContainer parents;
+            parents.Create (nParents);
+            m_internet.Install (parents);
+            m_treeNodes.Add (parents);
+
+            // Siblings are sorted by decreasing block size, as only the last
+            // node in each level may have fewer children, so consecutive
+            // blocks are kept aligned.
+            std::vector<uint32_t> parentSizes (nParents, 0);
+            for (uint32_t idx = 0; idx < children.GetN (); idx++)
+              {
+                parentSizes [idx / m_treeFanOut] += sizes.back () [idx];
+              }
+            for (uint32_t pIdx = 0; pIdx < nParents; pIdx++)
+              {
+                uint32_t size = 1;
+                while (size < parentSizes [pIdx])
+                  {
+                    size <<= 1;
+                  }
+                parentSizes [pIdx] = size;
+              }
+            levels.push_back (parents);
+            sizes.push_back (parentSizes);
+          }
+        while (levels.back ().GetN () > 1);
+
+        // Place the tree block at the next shared network aligned to its size.
+        // The remaining links are numbered with /30 subnets after this block,
+        // and the shared networks used by the tree are skipped at the end.
+        uint32_t treeSize = sizes.back () [0];
+        uint32_t treeBase = m_ipv4helper.NewNetwork ().Get ();
+        treeBase = (treeBase + treeSize - 1) / treeSize * treeSize;
+        Ipv4Mask linkMask ("255.255.255.252");
+        Ipv4AddressHelper treeIpv4Helper (
+          Ipv4Address (treeBase + treeSize), linkMask);
+
+        // Compute the block offsets top-down.
+        std::vector<std::vector<uint32_t> > offsets (levels.size ());
+        offsets.back ().assign (1, treeBase);
+        for (size_t lvl = levels.size () - 1; lvl > 0; lvl--)
+          {
+            offsets [lvl - 1].resize (levels [lvl - 1].GetN ());
+            std::vector<uint32_t> next = offsets [lvl];
+            for (uint32_t idx = 0; idx < levels [lvl - 1].GetN (); idx++)
+              {
+                uint32_t pIdx = idx / m_treeFanOut;
+                offsets [lvl - 1][idx] = next [pIdx];
+                next [pIdx] += sizes [lvl - 1][idx];
+              }
+          }
+
+        // Connect each node to its parent.
+        Ipv4StaticRoutingHelper routingHelper;
+        for (size_t lvl = 0; lvl < levels.size () - 1; lvl++)
+          {
+            for (uint32_t idx = 0; idx < levels [lvl].GetN (); idx++)
+              {
+                Ptr<Node> child = levels [lvl].Get (idx);
+                Ptr<Node> parent = levels [lvl + 1].Get (idx / m_treeFanOut);
+                NetDeviceContainer linkDevs =
+                  m_p2pHelper.Install (child, parent);
+                Ipv4InterfaceContainer linkIfaces;
+                if (lvl == 0)
+                  {
+                    // The leaf link subnet is the block of this switch, and
+                    // the parent reaches it as a directly connected network.
+                    Ipv4AddressHelper leafIpv4Helper (
+                      Ipv4Address (offsets [lvl][idx]), linkMask);
+                    linkIfaces = leafIpv4Helper.Assign (linkDevs);
+                    m_controlDevs.Add (linkDevs.Get (0));
+                  }
+                else
+                  {
+                    linkIfaces = treeIpv4Helper.Assign (linkDevs);
+                    treeIpv4Helper.NewNetwork ();
+                    routingHelper.GetStaticRouting (
+                      parent->GetObject<Ipv4> ())->AddNetworkRouteTo (
+                      Ipv4Address (offsets [lvl][idx]),
+                      Ipv4Mask (~(sizes [lvl][idx] - 1)),
+                      linkIfaces.GetAddress (0), linkIfaces.Get (1).second);
+                  }
+                routingHelper.GetStaticRouting (
+                  child->GetObject<Ipv4> ())->SetDefaultRoute (
+                  linkIfaces.GetAddress (1), linkIfaces.Get (0).second);
+              }
+          }
+
+        // Controllers are attached to the root of the tree.
+        Ptr<Node> root = levels.back ().Get (0);
+        UintegerValue portValue;
+        for (uint32_t ctIdx = 0; ctIdx < m_controlNodes.GetN (); ctIdx++)
+          {
+            Ptr<Node> ctNode = m_controlNodes.Get (ctIdx);
+            NetDeviceContainer linkDevs = m_p2pHelper.Install (ctNode, root);
+            m_controlDevs.Add (linkDevs.Get (0));
+            Ipv4InterfaceContainer linkIfaces =
+              treeIpv4Helper.Assign (linkDevs);
+            treeIpv4Helper.NewNetwork ();
+            routingHelper.GetStaticRouting (
+              ctNode->GetObject<Ipv4> ())->SetDefaultRoute (
+              linkIfaces.GetAddress (1), linkIfaces.Get (0).second);
+
+            // Start the connections between this controller and switches.
+            m_controlApps.Get (ctIdx)->GetAttribute ("Port", portValue);
+            InetSocketAddress addr (linkIfaces.GetAddress (0),
+                                    portValue.Get ());
+
+            OFSwitch13DeviceContainer::Iterator ofDev;
+            for (ofDev = m_openFlowDevs.Begin ();
+                 ofDev != m_openFlowDevs.End (); ofDev++)
+              {
+                NS_LOG_INFO ("Connect switch " << (*ofDev)->GetDatapathId () <<
+                             " to controller " << addr.GetIpv4 () <<
+                             " port " << addr.GetPort ());
+                Simulator::ScheduleNow (
+                  &OFSwitch13Device::StartControllerConnection, *ofDev, addr);
+              }
+          }
+
+        // Skip the shared networks used by the tree links.
+        Ipv4Address treeEnd = treeIpv4Helper.NewNetwork ();
+        Ipv4Address sharedNext;
+        do
+          {
+            sharedNext = m_ipv4helper.NewNetwork ();
+          }
+        while (sharedNext.Get () < treeEnd.Get ());
+        break;
+      }
     default:
       {
         NS_ABORT_MSG ("Invalid OpenflowChannelType.");
@@ -175,8 +372,12 @@ OFSwitch13InternalHelper::InstallController (
   NS_LOG_INFO ("Installing OpenFlow controller on node " << cNode->GetId ());
   NS_ABORT_MSG_IF (m_blocked, "OpenFlow channels already configured.");
 
-  // Install the TCP/IP stack and the controller application into node.
-  m_internet.Install (cNode);
+  // Install the TCP/IP stack (not used by direct channels) and the
+  // controller application into node.
+  if (m_channelType != OFSwitch13InternalHelper::DIRECT)
+    {
+      m_internet.Install (cNode);
+    }
   controller->SetStartTime (Seconds (0));
   cNode->AddApplication (controller);
   m_controlApps.Add (controller);
@@ -185,14 +386,61 @@ OFSwitch13InternalHelper::InstallController (
   return controller;
 }
 
+NodeContainer
+OFSwitch13InternalHelper::GetAggregationNodes (void) const
+{
+  return m_treeNodes;
+}
+
+int64_t
+OFSwitch13InternalHelper::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  int64_t currentStream = stream;
+  currentStream += OFSwitch13Helper::AssignStreams (currentStream);
+  DirectChannelList_t::iterator it;
+  for (it = m_directChannels.begin (); it != m_directChannels.end (); it++)
+    {
+      currentStream += (*it)->AssignStreams (currentStream);
+    }
+  return (currentStream - stream);
+}
+
 void
 OFSwitch13InternalHelper::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
 
+  m_directChannels.clear ();
   OFSwitch13Helper::DoDispose ();
 }
 
+void
+OFSwitch13InternalHelper::ConfigureLinkHelpers (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Setting channel/device data rates.
+  m_p2pHelper.SetDeviceAttribute (
+    "DataRate", DataRateValue (m_channelDataRate));
+  m_csmaHelper.SetChannelAttribute (
+    "DataRate", DataRateValue (m_channelDataRate));
+
+  // To avoid IP datagram fragmentation, we are configuring the OpenFlow
+  // channel devices with a very large MTU value. The TCP sockets used to
+  // send packets to theses devices are also configured to use a large
+  // segment size at OFSwitch13Controller and OFSwitch13Device.
+  m_csmaHelper.SetDeviceAttribute ("Mtu", UintegerValue (9000));
+  m_p2pHelper.SetDeviceAttribute ("Mtu", UintegerValue (9000));
+
+  // Using large queues on devices to avoid losing packets.
+  m_csmaHelper.SetQueue ("ns3::DropTailQueue<Packet>",
+                         "MaxSize", StringValue ("65536p"));
+  m_p2pHelper.SetQueue ("ns3::DropTailQueue<Packet>",
+                        "MaxSize", StringValue ("65536p"));
+}
+
 NetDeviceContainer
 OFSwitch13InternalHelper::Connect (Ptr<Node> ctrl, Ptr<Node> swtch)
 {
@@ -210,6 +458,8 @@ OFSwitch13InternalHelper::Connect (Ptr<Node> ctrl, Ptr<Node> swtch)
         return m_p2pHelper.Install (pairNodes);
       }
     case OFSwitch13InternalHelper::SINGLECSMA:
+    case OFSwitch13InternalHelper::DIRECT:
+    case OFSwitch13InternalHelper::TREEP2P:
     default:
       {
         NS_ABORT_MSG ("Invalid OpenflowChannelType.");
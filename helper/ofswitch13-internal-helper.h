@@ -28,6 +28,7 @@ namespace ns3 {
 class Node;
 class AttributeValue;
 class OFSwitch13Controller;
+class OFSwitch13DirectChannel;
 class OFSwitch13LearningController;
 
 /**
@@ -67,6 +68,23 @@ public:
     Ptr<Node> cNode, Ptr<OFSwitch13Controller> controller =
       CreateObject<OFSwitch13LearningController> ());
 
+  /**
+   * Get the aggregation nodes created for the TreeP2p management network.
+   * \attention Call this method only after configuring the OpenFlow channels.
+   * \return The aggregation nodes (empty for other channel types).
+   */
+  NodeContainer GetAggregationNodes (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by the OpenFlow switch devices and by the direct OpenFlow channels
+   * created by this helper.
+   * \attention Call this method only after configuring the OpenFlow channels.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned by this helper.
+   */
+  int64_t AssignStreams (int64_t stream);
+
 protected:
   /** Destructor implementation. */
   virtual void DoDispose ();
@@ -82,8 +100,20 @@ private:
    */
   NetDeviceContainer Connect (Ptr<Node> ctrl, Ptr<Node> swtch);
 
+  /**
+   * Configure the data rate, MTU, and queues of the CSMA and P2P helpers
+   * used to create the OpenFlow channel links.
+   */
+  void ConfigureLinkHelpers (void);
+
   ApplicationContainer      m_controlApps;      //!< OF controller apps.
   NodeContainer             m_controlNodes;     //!< OF controller nodes.
+  NodeContainer             m_treeNodes;        //!< Tree aggregation nodes.
+  uint32_t                  m_treeFanOut;       //!< Tree fan-out.
+
+  /** A list of direct OpenFlow channels. */
+  typedef std::vector<Ptr<OFSwitch13DirectChannel> > DirectChannelList_t;
+  DirectChannelList_t       m_directChannels;   //!< Direct channels.
 };
 
 } // namespace ns3
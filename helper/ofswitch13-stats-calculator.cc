@@ -51,7 +51,9 @@ OFSwitch13StatsCalculator::OFSwitch13StatsCalculator ()
   m_lastPacketsOut (0),
   m_loadDrops (0),
   m_meterDrops (0),
-  m_packets (0)
+  m_packets (0),
+  m_setups (0),
+  m_setupSum (Time (0))
 {
   NS_LOG_FUNCTION (this);
 }
@@ -84,6 +86,12 @@ OFSwitch13StatsCalculator::GetTypeId (void)
                    StringValue ("ofswitch_stats.log"),
                    MakeStringAccessor (&OFSwitch13StatsCalculator::m_filename),
                    MakeStringChecker ())
+    .AddAttribute ("FlowSetupBinWidth",
+                   "The bin width for the flow setup latency histogram.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (
+                     &OFSwitch13StatsCalculator::m_setupBinWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
   ;
   return tid;
 }
@@ -113,6 +121,10 @@ OFSwitch13StatsCalculator::HookSinks (Ptr<OFSwitch13Device> device)
     "PipelinePacket", MakeCallback (
       &OFSwitch13StatsCalculator::NotifyPipelinePacket,
       Ptr<OFSwitch13StatsCalculator> (this)));
+  device->TraceConnectWithoutContext (
+    "FlowSetupLatency", MakeCallback (
+      &OFSwitch13StatsCalculator::NotifyFlowSetup,
+      Ptr<OFSwitch13StatsCalculator> (this)));
 }
 
 uint32_t
@@ -151,6 +163,12 @@ OFSwitch13StatsCalculator::GetEwmaSumFlowEntries (void) const
   return std::round (m_avgSumFlowEntries);
 }
 
+const std::vector<uint32_t>&
+OFSwitch13StatsCalculator::GetFlowSetupHistogram (void) const
+{
+  return m_setupHistogram;
+}
+
 void
 OFSwitch13StatsCalculator::DoDispose ()
 {
@@ -184,6 +202,8 @@ OFSwitch13StatsCalculator::NotifyConstructionCompleted (void)
     << " " << setw (7)  << "NGroups"
     << " " << setw (7)  << "Buff:%"
     << " " << setw (7)  << "Dly:us"
+    << " " << setw (7)  << "Setups"
+    << " " << setw (9)  << "Setup:us"
     << std::endl;
 
   // Scheduling first update and dump.
@@ -240,6 +260,24 @@ OFSwitch13StatsCalculator::NotifyPipelinePacket (Ptr<const Packet> packet)
   m_packets++;
 }
 
+void
+OFSwitch13StatsCalculator::NotifyFlowSetup (
+  Ptr<const Packet> packet, Time total, Time pipeline, Time channel,
+  Time controller)
+{
+  NS_LOG_FUNCTION (this << packet << total);
+
+  m_setups++;
+  m_setupSum += total;
+
+  uint64_t bin = total.GetInteger () / m_setupBinWidth.GetInteger ();
+  if (bin >= m_setupHistogram.size ())
+    {
+      m_setupHistogram.resize (bin + 1, 0);
+    }
+  m_setupHistogram [bin]++;
+}
+
 void
 OFSwitch13StatsCalculator::DumpStatistics (void)
 {
@@ -253,6 +291,11 @@ OFSwitch13StatsCalculator::DumpStatistics (void)
   uint64_t packetsOut = m_device->GetPacketOutCounter ();
 
   double elapSeconds = (Simulator::Now () - m_lastUpdate).GetSeconds ();
+  Time avgSetup = Time (0);
+  if (m_setups)
+    {
+      avgSetup = Time (m_setupSum.GetDouble () / m_setups);
+    }
 
   // Print statistics to file.
   *m_wrapper->GetStream ()
@@ -271,6 +314,8 @@ OFSwitch13StatsCalculator::DumpStatistics (void)
     << " " << setw (7)  << GetEwmaGroupEntries ()
     << " " << setw (7)  << GetEwmaBufferUsage ()
     << " " << setw (7)  << GetEwmaPipelineDelay ().GetMicroSeconds ()
+    << " " << setw (7)  << m_setups
+    << " " << setw (9)  << avgSetup.GetMicroSeconds ()
     << std::endl;
 
   // Update internal counters.
@@ -283,6 +328,8 @@ OFSwitch13StatsCalculator::DumpStatistics (void)
   m_loadDrops = 0;
   m_meterDrops = 0;
   m_packets = 0;
+  m_setups = 0;
+  m_setupSum = Time (0);
 
   // Scheduling next update.
   m_lastUpdate = Simulator::Now ();
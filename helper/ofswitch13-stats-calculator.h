@@ -44,7 +44,12 @@ namespace ns3 {
  *  -# Average number of meter entries in meter table;
  *  -# Average number of group entries in group table;
  *  -# Average switch buffer space usage (percent);
- *  -# Average pipeline lookup delay for packet processing (microseconds).
+ *  -# Average pipeline lookup delay for packet processing (microseconds);
+ *  -# Flow setups completed by the controller;
+ *  -# Average flow setup latency (microseconds).
+ *
+ * The stats calculator also keeps a histogram of flow setup latencies over
+ * the entire simulation, which can be retrieved by GetFlowSetupHistogram ().
  */
 class OFSwitch13StatsCalculator : public Object
 {
@@ -79,6 +84,14 @@ public:
   uint32_t GetEwmaSumFlowEntries (void) const;
   //\}
 
+  /**
+   * Get the histogram of flow setup latencies. Each entry holds the number of
+   * flow setups with latency in the [i * width, (i + 1) * width) interval.
+   * The bin width is given by the FlowSetupBinWidth attribute.
+   * \return The flow setup latency histogram.
+   */
+  const std::vector<uint32_t>& GetFlowSetupHistogram (void) const;
+
 protected:
   /** Destructor implementation. */
   virtual void DoDispose ();
@@ -112,6 +125,17 @@ private:
    */
   void NotifyPipelinePacket (Ptr<const Packet> packet);
 
+  /**
+   * Notify when a packet-in buffered packet is released by the controller.
+   * \param packet The packet.
+   * \param total The flow setup latency.
+   * \param pipeline The pipeline delay.
+   * \param channel The estimated control channel delay.
+   * \param controller The controller queueing and processing time.
+   */
+  void NotifyFlowSetup (Ptr<const Packet> packet, Time total, Time pipeline,
+                        Time channel, Time controller);
+
   /**
    * Read statistics from switch, update internal counters,
    * and dump data into output file.
@@ -124,6 +148,8 @@ private:
   Time                      m_timeout;      //!< Update timeout.
   Time                      m_lastUpdate;   //!< Last update time.
   double                    m_alpha;        //!< EWMA alpha parameter.
+  Time                      m_setupBinWidth; //!< Setup histogram bin width.
+  std::vector<uint32_t>     m_setupHistogram; //!< Setup latency histogram.
 
   /** \name Internal counters, average values, and updated flags. */
   //\{
@@ -143,6 +169,8 @@ private:
   uint64_t  m_loadDrops;
   uint64_t  m_meterDrops;
   uint64_t  m_packets;
+  uint64_t  m_setups;
+  Time      m_setupSum;
   //\}
 };
 
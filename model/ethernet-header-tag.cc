@@ -0,0 +1,104 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include "ethernet-header-tag.h"
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EthernetHeaderTag");
+NS_OBJECT_ENSURE_REGISTERED (EthernetHeaderTag);
+
+EthernetHeaderTag::EthernetHeaderTag ()
+  : m_lengthType (0)
+{
+}
+
+EthernetHeaderTag::EthernetHeaderTag (const EthernetHeader &header)
+  : m_source (header.GetSource ()),
+  m_destination (header.GetDestination ()),
+  m_lengthType (header.GetLengthType ())
+{
+}
+
+TypeId
+EthernetHeaderTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetHeaderTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<EthernetHeaderTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+EthernetHeaderTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+EthernetHeader
+EthernetHeaderTag::GetHeader (void) const
+{
+  EthernetHeader header;
+  header.SetSource (m_source);
+  header.SetDestination (m_destination);
+  header.SetLengthType (m_lengthType);
+  return header;
+}
+
+uint32_t
+EthernetHeaderTag::GetSerializedSize (void) const
+{
+  return 14;
+}
+
+void
+EthernetHeaderTag::Serialize (TagBuffer i) const
+{
+  uint8_t buffer [6];
+  m_source.CopyTo (buffer);
+  i.Write (buffer, 6);
+  m_destination.CopyTo (buffer);
+  i.Write (buffer, 6);
+  i.WriteU16 (m_lengthType);
+}
+
+void
+EthernetHeaderTag::Deserialize (TagBuffer i)
+{
+  uint8_t buffer [6];
+  i.Read (buffer, 6);
+  m_source.CopyFrom (buffer);
+  i.Read (buffer, 6);
+  m_destination.CopyFrom (buffer);
+  m_lengthType = i.ReadU16 ();
+}
+
+void
+EthernetHeaderTag::Print (std::ostream &os) const
+{
+  os << " EthernetHeaderTag src=" << m_source
+     << " dst=" << m_destination
+     << " type=" << m_lengthType;
+}
+
+} // namespace ns3
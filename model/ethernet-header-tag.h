@@ -0,0 +1,73 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef ETHERNET_HEADER_TAG_H
+#define ETHERNET_HEADER_TAG_H
+
+#include <ns3/tag.h>
+#include <ns3/ethernet-header.h>
+#include <ns3/mac48-address.h>
+
+namespace ns3 {
+
+class Tag;
+
+/**
+ * \ingroup ofswitch13
+ * Tag used to hold the Ethernet header information (source and destination
+ * addresses and length/type field) when sending/receiving a packet to/from a
+ * switch port device that doesn't carry Ethernet frames, like the
+ * PointToPointNetDevice.
+ */
+class EthernetHeaderTag : public Tag
+{
+public:
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  EthernetHeaderTag ();       //!< Default constructor
+
+  /**
+   * Complete constructor.
+   * \param header The Ethernet header.
+   */
+  EthernetHeaderTag (const EthernetHeader &header);
+
+  /** \return The Ethernet header rebuilt from the tag information. */
+  EthernetHeader GetHeader (void) const;
+
+  // Inherited from Tag
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual uint32_t GetSerializedSize () const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  Mac48Address m_source;        //!< Source address.
+  Mac48Address m_destination;   //!< Destination address.
+  uint16_t     m_lengthType;    //!< Length/type field.
+};
+
+} // namespace ns3
+#endif // ETHERNET_HEADER_TAG_H
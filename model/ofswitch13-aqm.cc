@@ -0,0 +1,294 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ofswitch13-aqm.h"
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13Aqm");
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13Aqm);
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13RedAqm);
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13CoDelAqm);
+
+/********** OFSwitch13Aqm class **********/
+OFSwitch13Aqm::OFSwitch13Aqm ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OFSwitch13Aqm::~OFSwitch13Aqm ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13Aqm::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13Aqm")
+    .SetParent<Object> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13Aqm> ()
+    .AddAttribute ("UseEcn",
+                   "True to mark ECN capable packets instead of dropping.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&OFSwitch13Aqm::m_useEcn),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+OFSwitch13Aqm::Verdict
+OFSwitch13Aqm::CheckEnqueue (Ptr<const Queue<Packet> > queue,
+                             Ptr<const Packet> packet)
+{
+  return OFSwitch13Aqm::ACCEPT;
+}
+
+OFSwitch13Aqm::Verdict
+OFSwitch13Aqm::CheckDequeue (Ptr<const Queue<Packet> > queue,
+                             Ptr<const Packet> packet, Time sojourn)
+{
+  return OFSwitch13Aqm::ACCEPT;
+}
+
+int64_t
+OFSwitch13Aqm::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+OFSwitch13Aqm::Verdict
+OFSwitch13Aqm::CongestionSignal (void) const
+{
+  return m_useEcn ? OFSwitch13Aqm::MARK : OFSwitch13Aqm::DROP;
+}
+
+/********** OFSwitch13RedAqm class **********/
+OFSwitch13RedAqm::OFSwitch13RedAqm ()
+  : m_avg (0),
+  m_count (-1)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_uniform = CreateObject<UniformRandomVariable> ();
+}
+
+OFSwitch13RedAqm::~OFSwitch13RedAqm ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13RedAqm::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13RedAqm")
+    .SetParent<OFSwitch13Aqm> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13RedAqm> ()
+    .AddAttribute ("MinTh",
+                   "The min average queue length threshold (packets).",
+                   DoubleValue (5),
+                   MakeDoubleAccessor (&OFSwitch13RedAqm::m_minTh),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("MaxTh",
+                   "The max average queue length threshold (packets).",
+                   DoubleValue (15),
+                   MakeDoubleAccessor (&OFSwitch13RedAqm::m_maxTh),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("MaxP",
+                   "The signal probability at the max threshold.",
+                   DoubleValue (0.02),
+                   MakeDoubleAccessor (&OFSwitch13RedAqm::m_maxP),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("QW",
+                   "The queue weight for the average queue length.",
+                   DoubleValue (0.002),
+                   MakeDoubleAccessor (&OFSwitch13RedAqm::m_qW),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("UseHardDrop",
+                   "True to drop packets above the max threshold, "
+                   "even when using ECN.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&OFSwitch13RedAqm::m_hardDrop),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+OFSwitch13Aqm::Verdict
+OFSwitch13RedAqm::CheckEnqueue (Ptr<const Queue<Packet> > queue,
+                                Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << queue << packet);
+
+  NS_ASSERT_MSG (m_minTh <= m_maxTh, "Invalid RED thresholds.");
+  m_avg = (1 - m_qW) * m_avg + m_qW * queue->GetNPackets ();
+
+  if (m_avg < m_minTh)
+    {
+      m_count = -1;
+      return OFSwitch13Aqm::ACCEPT;
+    }
+
+  if (m_avg >= m_maxTh)
+    {
+      NS_LOG_DEBUG ("Average queue length " << m_avg << " above max th.");
+      m_count = 0;
+      return m_hardDrop ? OFSwitch13Aqm::DROP : CongestionSignal ();
+    }
+
+  // Signal with a probability that increases linearly with the average queue
+  // length and with the number of packets since the last signal.
+  m_count++;
+  double pb = m_maxP * (m_avg - m_minTh) / (m_maxTh - m_minTh);
+  double pa = (m_count * pb < 1) ? pb / (1 - m_count * pb) : 1;
+  if (m_uniform->GetValue () < pa)
+    {
+      NS_LOG_DEBUG ("Early signal with probability " << pa);
+      m_count = 0;
+      return CongestionSignal ();
+    }
+  return OFSwitch13Aqm::ACCEPT;
+}
+
+int64_t
+OFSwitch13RedAqm::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  m_uniform->SetStream (stream);
+  return 1;
+}
+
+void
+OFSwitch13RedAqm::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+
+  m_uniform = 0;
+  OFSwitch13Aqm::DoDispose ();
+}
+
+/********** OFSwitch13CoDelAqm class **********/
+OFSwitch13CoDelAqm::OFSwitch13CoDelAqm ()
+  : m_dropping (false),
+  m_firstAboveTime (Time (0)),
+  m_dropNext (Time (0)),
+  m_count (0),
+  m_lastCount (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OFSwitch13CoDelAqm::~OFSwitch13CoDelAqm ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13CoDelAqm::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13CoDelAqm")
+    .SetParent<OFSwitch13Aqm> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13CoDelAqm> ()
+    .AddAttribute ("Target",
+                   "The target sojourn time.",
+                   TimeValue (MilliSeconds (5)),
+                   MakeTimeAccessor (&OFSwitch13CoDelAqm::m_target),
+                   MakeTimeChecker ())
+    .AddAttribute ("Interval",
+                   "The sliding minimum window.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&OFSwitch13CoDelAqm::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinBytes",
+                   "The min queue bytes for signaling (usually the MTU).",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&OFSwitch13CoDelAqm::m_minBytes),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+OFSwitch13Aqm::Verdict
+OFSwitch13CoDelAqm::CheckDequeue (Ptr<const Queue<Packet> > queue,
+                                  Ptr<const Packet> packet, Time sojourn)
+{
+  NS_LOG_FUNCTION (this << queue << packet << sojourn);
+
+  // Check for the sojourn time above target for at least one interval.
+  Time now = Simulator::Now ();
+  bool okToDrop = false;
+  if (sojourn < m_target || queue->GetNBytes () <= m_minBytes)
+    {
+      m_firstAboveTime = Time (0);
+    }
+  else if (m_firstAboveTime.IsZero ())
+    {
+      m_firstAboveTime = now + m_interval;
+    }
+  else if (now >= m_firstAboveTime)
+    {
+      okToDrop = true;
+    }
+
+  if (m_dropping)
+    {
+      if (!okToDrop)
+        {
+          NS_LOG_DEBUG ("Sojourn time below target. Leaving dropping state.");
+          m_dropping = false;
+        }
+      else if (now >= m_dropNext)
+        {
+          m_count++;
+          m_dropNext = ControlLaw (m_dropNext);
+          return CongestionSignal ();
+        }
+    }
+  else if (okToDrop)
+    {
+      // Restart the control law close to the last dropping state when it
+      // was recently left.
+      NS_LOG_DEBUG ("Sojourn time above target. Entering dropping state.");
+      m_dropping = true;
+      uint32_t delta = m_count - m_lastCount;
+      m_count = (delta > 1 && now - m_dropNext < m_interval * 16) ? delta : 1;
+      m_lastCount = m_count;
+      m_dropNext = ControlLaw (now);
+      return CongestionSignal ();
+    }
+  return OFSwitch13Aqm::ACCEPT;
+}
+
+Time
+OFSwitch13CoDelAqm::ControlLaw (Time t) const
+{
+  return t + Time (m_interval.GetDouble () / std::sqrt (m_count));
+}
+
+} // namespace ns3
@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_AQM_H
+#define OFSWITCH13_AQM_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/queue.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ *
+ * \brief Active queue management (AQM) algorithm for an internal queue of the
+ * OFSwitch13Queue. The AQM is checked by the OpenFlow queue before enqueuing a
+ * packet into the internal queue and after dequeuing a packet from it (with
+ * the packet sojourn time). The AQM may accept the packet, drop it, or mark
+ * it with the ECN Congestion Experienced codepoint. Packets that are not ECN
+ * capable are dropped instead of marked. This base class accepts all packets,
+ * leaving the internal queue with its own drop policy.
+ */
+class OFSwitch13Aqm : public Object
+{
+public:
+  /** AQM decision for a packet. */
+  enum Verdict
+  {
+    ACCEPT = 0,   //!< Accept the packet.
+    MARK = 1,     //!< Mark the packet with ECN CE (or drop it).
+    DROP = 2      //!< Drop the packet.
+  };
+
+  OFSwitch13Aqm ();           //!< Default constructor.
+  virtual ~OFSwitch13Aqm ();  //!< Dummy destructor.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Check a packet before enqueuing it into the internal queue.
+   * \param queue The internal queue.
+   * \param packet The packet.
+   * \return The AQM decision.
+   */
+  virtual Verdict CheckEnqueue (Ptr<const Queue<Packet> > queue,
+                                Ptr<const Packet> packet);
+
+  /**
+   * Check a packet after dequeuing it from the internal queue.
+   * \param queue The internal queue.
+   * \param packet The packet.
+   * \param sojourn The time the packet spent in the internal queue.
+   * \return The AQM decision.
+   */
+  virtual Verdict CheckDequeue (Ptr<const Queue<Packet> > queue,
+                                Ptr<const Packet> packet, Time sojourn);
+
+  /**
+   * Assign a fixed random variable stream number to the random variables used
+   * by this AQM.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned.
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+
+protected:
+  /**
+   * Get the verdict for a congestion signal, according to the UseEcn
+   * attribute.
+   * \return MARK when using ECN, DROP otherwise.
+   */
+  Verdict CongestionSignal (void) const;
+
+private:
+  bool m_useEcn;    //!< Mark packets instead of dropping.
+};
+
+/**
+ * \ingroup ofswitch13
+ *
+ * \brief Random Early Detection (RED) AQM for OpenFlow internal queues. The
+ * average queue length in packets is updated at each enqueue, and packets are
+ * signaled with increasing probability when the average is between the min
+ * and max thresholds. Above the max threshold, packets are always signaled
+ * (dropped when using hard drop). A step marking policy for DCTCP can be
+ * configured with equal thresholds, a queue weight of 1, ECN, and no hard
+ * drop.
+ */
+class OFSwitch13RedAqm : public OFSwitch13Aqm
+{
+public:
+  OFSwitch13RedAqm ();            //!< Default constructor.
+  virtual ~OFSwitch13RedAqm ();   //!< Dummy destructor.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  // Inherited from OFSwitch13Aqm.
+  Verdict CheckEnqueue (Ptr<const Queue<Packet> > queue,
+                        Ptr<const Packet> packet);
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  /** Destructor implementation. */
+  virtual void DoDispose ();
+
+private:
+  double    m_minTh;      //!< Min average queue length threshold.
+  double    m_maxTh;      //!< Max average queue length threshold.
+  double    m_maxP;       //!< Max signal probability at max threshold.
+  double    m_qW;         //!< Queue weight for the average.
+  bool      m_hardDrop;   //!< Drop above max threshold even with ECN.
+  double    m_avg;        //!< Average queue length.
+  int32_t   m_count;      //!< Packets since the last signal.
+
+  Ptr<UniformRandomVariable> m_uniform;  //!< Signal probability RNG.
+};
+
+/**
+ * \ingroup ofswitch13
+ *
+ * \brief Controlled Delay (CoDel) AQM for OpenFlow internal queues, following
+ * RFC 8289. Packets are signaled at dequeue when the sojourn time stays above
+ * the target for at least one interval, with the interval between signals
+ * decreasing with the inverse square root of the number of signals.
+ */
+class OFSwitch13CoDelAqm : public OFSwitch13Aqm
+{
+public:
+  OFSwitch13CoDelAqm ();            //!< Default constructor.
+  virtual ~OFSwitch13CoDelAqm ();   //!< Dummy destructor.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  // Inherited from OFSwitch13Aqm.
+  Verdict CheckDequeue (Ptr<const Queue<Packet> > queue,
+                        Ptr<const Packet> packet, Time sojourn);
+
+private:
+  /**
+   * Get the next signal time according to the CoDel control law.
+   * \param t The reference time.
+   * \return The next signal time.
+   */
+  Time ControlLaw (Time t) const;
+
+  Time      m_target;         //!< Target sojourn time.
+  Time      m_interval;       //!< Sliding minimum window.
+  uint32_t  m_minBytes;       //!< Min queue bytes for signaling.
+  bool      m_dropping;       //!< In dropping state.
+  Time      m_firstAboveTime; //!< Time to declare sojourn above target.
+  Time      m_dropNext;       //!< Time for the next signal.
+  uint32_t  m_count;          //!< Signals since entering dropping state.
+  uint32_t  m_lastCount;      //!< Signals in the last dropping state.
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_AQM_H */
@@ -19,9 +19,14 @@
  */
 
 #include <wordexp.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
 #include <ns3/uinteger.h>
+#include <ns3/nstime.h>
 #include <ns3/tcp-socket-factory.h>
 #include "ofswitch13-controller.h"
+#include "lib/byte-order.h"
 
 namespace ns3 {
 
@@ -30,11 +35,13 @@ NS_OBJECT_ENSURE_REGISTERED (OFSwitch13Controller);
 
 /********** Public methods ***********/
 OFSwitch13Controller::OFSwitch13Controller ()
-  : m_serverSocket (0)
+  : m_serverSocket (0),
+  m_desiredShadow (0)
 {
   NS_LOG_FUNCTION (this);
 
   m_xid = rand () & 0xffffffff;
+  m_statsRng = CreateObject<UniformRandomVariable> ();
 }
 
 OFSwitch13Controller::~OFSwitch13Controller ()
@@ -48,11 +55,113 @@ OFSwitch13Controller::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::OFSwitch13Controller")
     .SetParent<Object> ()
     .SetGroupName ("OFSwitch13")
+    .AddAttribute ("InitialRole",
+                   "The controller role requested after the handshake "
+                   "procedure with each switch.",
+                   EnumValue (OFPCR_ROLE_EQUAL),
+                   MakeEnumAccessor (&OFSwitch13Controller::m_initialRole),
+                   MakeEnumChecker (OFPCR_ROLE_EQUAL,  "Equal",
+                                    OFPCR_ROLE_MASTER, "Master",
+                                    OFPCR_ROLE_SLAVE,  "Slave"))
     .AddAttribute ("Port",
                    "Port number to listen for incoming packets.",
                    UintegerValue (6653),
                    MakeUintegerAccessor (&OFSwitch13Controller::m_port),
                    MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("FlowShadow",
+                   "Keep a controller-side mirror of the flow entries, "
+                   "groups, and meters installed into each switch.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&OFSwitch13Controller::m_shadowEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FlowStatsInterval",
+                   "Interval for periodic flow stats polling "
+                   "(zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13Controller::m_flowStatsInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("PortStatsInterval",
+                   "Interval for periodic port stats polling "
+                   "(zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13Controller::m_portStatsInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("QueueStatsInterval",
+                   "Interval for periodic queue stats polling "
+                   "(zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13Controller::m_queueStatsInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("MeterStatsInterval",
+                   "Interval for periodic meter stats polling "
+                   "(zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13Controller::m_meterStatsInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("TableStatsInterval",
+                   "Interval for periodic table stats polling "
+                   "(zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13Controller::m_tableStatsInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("EchoInterval",
+                   "Interval between echo requests sent by the echo "
+                   "monitor to each switch (zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (&OFSwitch13Controller::m_echoInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("EchoMissLimit",
+                   "Number of consecutive missed echo replies before "
+                   "closing the connection to the switch.",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (
+                     &OFSwitch13Controller::m_echoMissLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("EchoRttAlpha",
+                   "The EWMA alpha parameter for averaging the echo RTT.",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&OFSwitch13Controller::m_echoAlpha),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("RttBinWidth",
+                   "The bin width for the echo RTT histogram.",
+                   TimeValue (MicroSeconds (100)),
+                   MakeTimeAccessor (&OFSwitch13Controller::m_rttBinWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("TransactionTimeout",
+                   "Default timeout for request-reply transactions.",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&OFSwitch13Controller::m_txnTimeout),
+                   MakeTimeChecker (NanoSeconds (1)))
+
+    .AddTraceSource ("StatsRate",
+                     "Trace source indicating rates computed from "
+                     "periodic statistics polling.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Controller::m_statsRateTrace),
+                     "ns3::OFSwitch13Controller::StatsRateTracedCallback")
+    .AddTraceSource ("RoleChange",
+                     "Trace source indicating a controller role change "
+                     "confirmed by the switch.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Controller::m_roleTrace),
+                     "ns3::OFSwitch13Controller::RoleTracedCallback")
+    .AddTraceSource ("SwitchConnection",
+                     "Trace source indicating a switch connected (after "
+                     "the handshake procedure) or disconnected.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Controller::m_switchConnectionTrace),
+                     "ns3::OFSwitch13Controller::"
+                     "SwitchConnectionTracedCallback")
+    .AddTraceSource ("EchoRtt",
+                     "Trace source indicating a new echo RTT sample.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Controller::m_echoRttTrace),
+                     "ns3::OFSwitch13Controller::EchoRttTracedCallback")
   ;
   return tid;
 }
@@ -63,9 +172,30 @@ OFSwitch13Controller::DoDispose ()
   NS_LOG_FUNCTION (this);
 
   m_serverSocket = 0;
+  for (DpIdSwitchMap_t::iterator it = m_dpIdMap.begin ();
+       it != m_dpIdMap.end (); it++)
+    {
+      it->second->m_echoEvent.Cancel ();
+      RemoteSwitch::StatsEventMap_t::iterator evIt;
+      for (evIt = it->second->m_statsEvents.begin ();
+           evIt != it->second->m_statsEvents.end (); evIt++)
+        {
+          evIt->second.Cancel ();
+        }
+    }
   m_switchesMap.clear ();
-  m_echoMap.clear ();
-  m_barrierMap.clear ();
+  m_dpIdMap.clear ();
+  m_echoTemplate = 0;
+  m_barrierTemplate = 0;
+  m_desiredShadow = 0;
+  m_statsTemplates.clear ();
+  m_statsRng = 0;
+  for (TransactionMap_t::iterator it = m_transactions.begin ();
+       it != m_transactions.end (); it++)
+    {
+      it->second.m_timeout.Cancel ();
+    }
+  m_transactions.clear ();
   m_schedCommands.clear ();
 
   Application::DoDispose ();
@@ -121,6 +251,26 @@ OFSwitch13Controller::DpctlSchedule (uint64_t dpId, const std::string textCmd)
   return 0;
 }
 
+int
+OFSwitch13Controller::RequestRole (Ptr<const RemoteSwitch> swtch,
+                                   enum ofp_controller_role role)
+{
+  NS_LOG_FUNCTION (this << swtch << role);
+
+  return SendRoleRequest (ConstCast<RemoteSwitch> (swtch), role, false);
+}
+
+int
+OFSwitch13Controller::RequestRole (uint64_t dpId,
+                                   enum ofp_controller_role role)
+{
+  NS_LOG_FUNCTION (this << dpId << role);
+
+  Ptr<const RemoteSwitch> swtch = GetRemoteSwitch (dpId);
+  NS_ASSERT_MSG (swtch, "Can't request role for an unregistered switch.");
+  return RequestRole (swtch, role);
+}
+
 void
 OFSwitch13Controller::DpctlSendAndPrint (struct vconn *vconn,
                                          struct ofl_msg_header *msg)
@@ -128,6 +278,23 @@ OFSwitch13Controller::DpctlSendAndPrint (struct vconn *vconn,
   NS_LOG_FUNCTION_NOARGS ();
 
   Ptr<const RemoteSwitch> swtch ((RemoteSwitch*)vconn, true);
+  Ptr<OFSwitch13FlowShadow> desired = swtch->m_ctrlApp->m_desiredShadow;
+  if (desired)
+    {
+      // We are building the desired state for reconciliation. Let's save the
+      // modification message into the desired state instead of sending it.
+      uint8_t *buf;
+      size_t buf_size;
+      if (!ofl_msg_pack (msg, 0, &buf, &buf_size, 0))
+        {
+          if (!desired->Update (buf, buf_size))
+            {
+              NS_LOG_WARN ("Ignoring unsupported command for reconcile.");
+            }
+          free (buf);
+        }
+      return;
+    }
   swtch->m_ctrlApp->SendToSwitch (swtch, msg, 0);
 }
 
@@ -137,8 +304,14 @@ OFSwitch13Controller::StartApplication ()
 {
   NS_LOG_FUNCTION (this << m_port);
 
-  // Create the server listening socket
+  // Create the server listening socket. Nodes without the TCP/IP stack can
+  // only accept switch connections over direct channels.
   TypeId tcpFactory = TypeId::LookupByName ("ns3::TcpSocketFactory");
+  if (!GetNode ()->GetObject<SocketFactory> (tcpFactory))
+    {
+      NS_LOG_INFO ("No TCP/IP stack. Not listening for connections.");
+      return;
+    }
   m_serverSocket = Socket::CreateSocket (GetNode (), tcpFactory);
   m_serverSocket->SetAttribute ("SegmentSize", UintegerValue (8900));
   m_serverSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), m_port));
@@ -158,6 +331,29 @@ OFSwitch13Controller::StopApplication ()
 {
   NS_LOG_FUNCTION (this << m_port);
 
+  // Stop the echo and statistics monitors and complete the pending
+  // transactions while the connections are still available, as the
+  // transaction callbacks may send messages to the switches. The map is
+  // copied because these callbacks may also change it.
+  SwitchsMap_t switches = m_switchesMap;
+  for (SwitchsMap_t::iterator it = switches.begin ();
+       it != switches.end (); it++)
+    {
+      Ptr<RemoteSwitch> swtch = it->second;
+      if (it->first != swtch->m_address)
+        {
+          continue;
+        }
+      swtch->m_echoEvent.Cancel ();
+      RemoteSwitch::StatsEventMap_t::iterator evIt;
+      for (evIt = swtch->m_statsEvents.begin ();
+           evIt != swtch->m_statsEvents.end (); evIt++)
+        {
+          evIt->second.Cancel ();
+        }
+      TransactionDoneAll (swtch, TRANSACTION_CLOSED);
+    }
+
   for (SwitchsMap_t::iterator it = m_switchesMap.begin ();
        it != m_switchesMap.end (); it++)
     {
@@ -165,6 +361,7 @@ OFSwitch13Controller::StopApplication ()
       swtch->m_handler = 0;
     }
   m_switchesMap.clear ();
+  m_dpIdMap.clear ();
 
   if (m_serverSocket)
     {
@@ -186,19 +383,22 @@ OFSwitch13Controller::HandshakeSuccessful (Ptr<const RemoteSwitch> swtch)
   NS_LOG_FUNCTION (this << swtch);
 }
 
+void
+OFSwitch13Controller::ChannelCongestion (Ptr<const RemoteSwitch> swtch,
+                                         bool congested)
+{
+  NS_LOG_FUNCTION (this << swtch << congested);
+}
+
 Ptr<const OFSwitch13Controller::RemoteSwitch>
 OFSwitch13Controller::GetRemoteSwitch (uint64_t dpId) const
 {
   NS_LOG_FUNCTION (this << dpId);
 
-  SwitchsMap_t::const_iterator it;
-  for (it = m_switchesMap.begin (); it != m_switchesMap.end (); it++)
+  DpIdSwitchMap_t::const_iterator it = m_dpIdMap.find (dpId);
+  if (it != m_dpIdMap.end ())
     {
-      Ptr<const RemoteSwitch> swtch = it->second;
-      if (swtch->m_dpId == dpId)
-        {
-          return swtch;
-        }
+      return it->second;
     }
   return 0;
 }
@@ -220,70 +420,303 @@ OFSwitch13Controller::SendToSwitch (Ptr<const RemoteSwitch> swtch,
       xid = GetNextXid ();
     }
 
+  // Keep the installed state mirror updated with modification messages.
+  if (swtch->m_shadow && (msg->type == OFPT_FLOW_MOD
+                          || msg->type == OFPT_GROUP_MOD
+                          || msg->type == OFPT_METER_MOD))
+    {
+      uint8_t *buf;
+      size_t buf_size;
+      if (ofl_msg_pack (msg, xid, &buf, &buf_size, 0))
+        {
+          NS_LOG_ERROR ("Error packing OpenFlow message.");
+          return -1;
+        }
+      swtch->m_shadow->Update (buf, buf_size);
+      Ptr<Packet> packet = Create<Packet> (buf, buf_size);
+      free (buf);
+      return swtch->m_handler->SendMessage (packet);
+    }
+  if (swtch->m_shadow && msg->type == OFPT_BARRIER_REQUEST)
+    {
+      swtch->m_shadow->Barrier (xid);
+    }
+
   // Create the packet from the OpenFlow message and send it to the switch.
   return swtch->m_handler->SendMessage (ofs::PacketFromMsg (msg, xid));
 }
 
+int
+OFSwitch13Controller::SendToSwitch (Ptr<const RemoteSwitch> swtch,
+                                    Ptr<ofs::MessageTemplate> tmpl,
+                                    uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << swtch);
+
+  NS_ASSERT_MSG (tmpl && tmpl->IsValid (), "Invalid message template.");
+  NS_LOG_DEBUG ("TX to switch " << swtch->GetIpv4 () <<
+                " [dp " << swtch->GetDpId () << "]: template type " <<
+                (uint16_t)tmpl->GetType ());
+
+  // Set the transaction ID only for unknown values
+  if (!xid)
+    {
+      xid = GetNextXid ();
+    }
+
+  // Create the packet from the template and send it to the switch.
+  if (swtch->m_shadow && tmpl->GetType () == OFPT_BARRIER_REQUEST)
+    {
+      swtch->m_shadow->Barrier (xid);
+    }
+  return swtch->m_handler->SendMessage (tmpl->CreatePacket (xid));
+}
+
 void
 OFSwitch13Controller::SendEchoRequest (Ptr<const RemoteSwitch> swtch,
                                        size_t payloadSize)
 {
   NS_LOG_FUNCTION (this << swtch);
 
-  // Create the echo request message
+  TransactionCallback cb = MakeCallback (&OFSwitch13Controller::EchoDone,
+                                         this);
+
+  // Echo requests with no payload are always the same, so we pack the
+  // message only once and reuse it for all switches.
+  if (!payloadSize)
+    {
+      if (!m_echoTemplate)
+        {
+          struct ofl_msg_echo msg;
+          msg.header.type = OFPT_ECHO_REQUEST;
+          msg.data_length = 0;
+          msg.data = 0;
+          m_echoTemplate = Create<ofs::MessageTemplate> (
+              (struct ofl_msg_header*)&msg);
+        }
+      SendRequest (swtch, m_echoTemplate, cb);
+      return;
+    }
+
+  // Create the echo request message and fill payload with random bytes
   struct ofl_msg_echo msg;
   msg.header.type = OFPT_ECHO_REQUEST;
   msg.data_length = payloadSize;
-  msg.data = 0;
+  msg.data = (uint8_t*)xmalloc (payloadSize);
+  random_bytes (msg.data, payloadSize);
+
+  // Send the message to the switch and free the payload
+  SendRequest (swtch, (struct ofl_msg_header*)&msg, cb);
+  free (msg.data);
+}
+
+void
+OFSwitch13Controller::SendBarrierRequest (Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch);
 
-  // Fill payload with random bytes
-  if (payloadSize)
+  // Barrier requests are always the same, so we pack the message only once
+  // and reuse it for all switches.
+  if (!m_barrierTemplate)
     {
-      msg.data = (uint8_t*)xmalloc (payloadSize);
-      random_bytes (msg.data, payloadSize);
+      struct ofl_msg_header msg;
+      msg.type = OFPT_BARRIER_REQUEST;
+      m_barrierTemplate = Create<ofs::MessageTemplate> (&msg);
     }
 
-  // Create and save the echo metadata for this request
+  // Send the message to the switch
+  SendRequest (swtch, m_barrierTemplate,
+               MakeCallback (&OFSwitch13Controller::BarrierDone, this));
+}
+
+uint32_t
+OFSwitch13Controller::SendRequest (Ptr<const RemoteSwitch> swtch,
+                                   struct ofl_msg_header *msg,
+                                   TransactionCallback cb, Time timeout)
+{
+  NS_LOG_FUNCTION (this << swtch);
+
   uint32_t xid = GetNextXid ();
-  std::pair <uint32_t, EchoInfo> entry (xid, EchoInfo (swtch));
-  std::pair <EchoMsgMap_t::iterator, bool> ret;
-  ret = m_echoMap.insert (entry);
-  if (ret.second == false)
+  if (SendToSwitch (swtch, msg, xid))
     {
-      NS_LOG_ERROR ("Error requesting echo to switch " << swtch);
+      return 0;
     }
+  TransactionStart (swtch, xid, cb, timeout);
+  return xid;
+}
 
-  // Send the message to the switch
-  SendToSwitch (swtch, (struct ofl_msg_header*)&msg, xid);
+uint32_t
+OFSwitch13Controller::SendRequest (Ptr<const RemoteSwitch> swtch,
+                                   Ptr<ofs::MessageTemplate> tmpl,
+                                   TransactionCallback cb, Time timeout)
+{
+  NS_LOG_FUNCTION (this << swtch);
 
-  // Free the payload
-  if (payloadSize)
+  uint32_t xid = GetNextXid ();
+  if (SendToSwitch (swtch, tmpl, xid))
     {
-      free (msg.data);
+      return 0;
     }
+  TransactionStart (swtch, xid, cb, timeout);
+  return xid;
 }
 
-void
-OFSwitch13Controller::SendBarrierRequest (Ptr<const RemoteSwitch> swtch)
+uint32_t
+OFSwitch13Controller::RateStatsRequest (Ptr<const RemoteSwitch> swtch,
+                                        TransactionCallback cb,
+                                        uint32_t portNo, Time timeout)
 {
-  NS_LOG_FUNCTION (this << swtch);
+  NS_LOG_FUNCTION (this << swtch << portNo);
 
-  // Create the barrier request message
-  struct ofl_msg_header msg;
-  msg.type = OFPT_BARRIER_REQUEST;
+  // The ofsoftswitch13 library can't pack experimenter multipart requests,
+  // so the request is built in wire format.
+  size_t length = sizeof (struct ofp_multipart_request)
+    + sizeof (struct ofp_experimenter_multipart_header)
+    + sizeof (struct ofs::ofs13_rate_stats_request);
+  std::vector<uint8_t> wire (length, 0);
 
-  // Create and save the barrier metadata for this request
   uint32_t xid = GetNextXid ();
-  std::pair <uint32_t, BarrierInfo> entry (xid, BarrierInfo (swtch));
-  std::pair <BarrierMsgMap_t::iterator, bool> ret;
-  ret = m_barrierMap.insert (entry);
-  if (ret.second == false)
+  struct ofp_multipart_request *request =
+    (struct ofp_multipart_request*)&wire[0];
+  request->header.version = OFP_VERSION;
+  request->header.type = OFPT_MULTIPART_REQUEST;
+  request->header.length = htons (length);
+  request->header.xid = htonl (xid);
+  request->type = htons (OFPMP_EXPERIMENTER);
+  struct ofp_experimenter_multipart_header *expHeader =
+    (struct ofp_experimenter_multipart_header*)request->body;
+  expHeader->experimenter = htonl (ofs::OFS13_EXPERIMENTER_ID);
+  expHeader->exp_type = htonl (ofs::OFS13_EXP_RATE_STATS);
+  struct ofs::ofs13_rate_stats_request *body =
+    (struct ofs::ofs13_rate_stats_request*)(expHeader + 1);
+  body->port_no = htonl (portNo);
+
+  NS_LOG_DEBUG ("TX to switch " << swtch->GetIpv4 () <<
+                " [dp " << swtch->GetDpId () << "]: rate stats request");
+  if (swtch->m_handler->SendMessage (Create<Packet> (&wire[0], length)))
     {
-      NS_LOG_ERROR ("Error requesting barrier to switch " << swtch);
+      return 0;
     }
+  TransactionStart (swtch, xid, cb, timeout);
+  return xid;
+}
 
-  // Send the message to the switch
-  SendToSwitch (swtch, &msg, xid);
+uint32_t
+OFSwitch13Controller::DpctlRequest (Ptr<const RemoteSwitch> swtch,
+                                    const std::string textCmd,
+                                    TransactionCallback cb, Time timeout)
+{
+  NS_LOG_FUNCTION (this << swtch << textCmd);
+
+  // The dpctl utility assigns a new transaction id for each message it
+  // sends, so the request is the last one sent by this command.
+  uint32_t lastXid = m_xid;
+  if (DpctlExecute (swtch, textCmd) || m_xid == lastXid)
+    {
+      NS_LOG_WARN ("No request sent by dpctl command " << textCmd);
+      return 0;
+    }
+  TransactionStart (swtch, m_xid, cb, timeout);
+  return m_xid;
+}
+
+uint32_t
+OFSwitch13Controller::DpctlBatch (Ptr<const RemoteSwitch> swtch,
+                                  const std::vector<std::string> &cmds,
+                                  TransactionCallback cb, Time timeout)
+{
+  NS_LOG_FUNCTION (this << swtch << cmds.size ());
+
+  // Transaction ids are sequentially assigned, so the range between the
+  // first and the last ids identifies all the messages in the batch.
+  uint32_t firstXid = m_xid + 1;
+  for (size_t i = 0; i < cmds.size (); i++)
+    {
+      DpctlExecute (swtch, cmds [i]);
+    }
+  uint32_t lastXid = m_xid;
+
+  // Barrier requests are always the same, so we pack the message only once
+  // and reuse it for all switches.
+  if (!m_barrierTemplate)
+    {
+      struct ofl_msg_header msg;
+      msg.type = OFPT_BARRIER_REQUEST;
+      m_barrierTemplate = Create<ofs::MessageTemplate> (&msg);
+    }
+  uint32_t xid = SendRequest (swtch, m_barrierTemplate, cb, timeout);
+  if (xid)
+    {
+      PendingTransaction &pending = m_transactions [xid];
+      pending.m_batch = (lastXid + 1 != firstXid);
+      pending.m_firstXid = firstXid;
+      pending.m_lastXid = lastXid;
+    }
+  return xid;
+}
+
+bool
+OFSwitch13Controller::CancelTransaction (uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << xid);
+
+  TransactionMap_t::iterator it = m_transactions.find (xid);
+  if (it == m_transactions.end ())
+    {
+      return false;
+    }
+  it->second.m_timeout.Cancel ();
+  m_transactions.erase (it);
+  return true;
+}
+
+bool
+OFSwitch13Controller::IsTransactionPending (uint32_t xid) const
+{
+  return m_transactions.find (xid) != m_transactions.end ();
+}
+
+uint32_t
+OFSwitch13Controller::Reconcile (Ptr<const RemoteSwitch> swtch,
+                                 const std::vector<std::string> &desired)
+{
+  NS_LOG_FUNCTION (this << swtch);
+
+  NS_ASSERT_MSG (swtch->m_shadow, "Reconcile requires the flow shadow.");
+
+  // Build the desired state by executing the dpctl commands in capture mode.
+  m_desiredShadow = Create<OFSwitch13FlowShadow> ();
+  for (size_t i = 0; i < desired.size (); i++)
+    {
+      DpctlExecute (swtch, desired [i]);
+    }
+  OFSwitch13FlowShadow::MessageList_t msgs =
+    swtch->m_shadow->Diff (*m_desiredShadow);
+  m_desiredShadow = 0;
+
+  // Send the differences to the switch, updating the mirror.
+  OFSwitch13FlowShadow::MessageList_t::iterator it;
+  for (it = msgs.begin (); it != msgs.end (); it++)
+    {
+      struct ofp_header *header = (struct ofp_header*)it->data ();
+      header->xid = htonl (GetNextXid ());
+      swtch->m_shadow->Update (it->data (), it->size ());
+      swtch->m_handler->SendMessage (Create<Packet> (it->data (), it->size ()));
+    }
+  NS_LOG_INFO ("Reconcile sent " << msgs.size () << " messages to switch " <<
+               swtch->GetDpId ());
+  return msgs.size ();
+}
+
+uint32_t
+OFSwitch13Controller::Reconcile (uint64_t dpId,
+                                 const std::vector<std::string> &desired)
+{
+  NS_LOG_FUNCTION (this << dpId);
+
+  Ptr<const RemoteSwitch> swtch = GetRemoteSwitch (dpId);
+  NS_ASSERT_MSG (swtch, "Can't reconcile state for an unregistered switch.");
+  return Reconcile (swtch, desired);
 }
 
 // --- BEGIN: Handlers functions -------
@@ -311,20 +744,8 @@ OFSwitch13Controller::HandleEchoReply (
 {
   NS_LOG_FUNCTION (this << swtch << xid);
 
-  EchoMsgMap_t::iterator it = m_echoMap.find (xid);
-  if (it == m_echoMap.end ())
-    {
-      NS_LOG_WARN ("Echo response for unknonw echo request.");
-    }
-  else
-    {
-      it->second.m_waiting = false;
-      it->second.m_recv = Simulator::Now ();
-      NS_LOG_INFO ("Echo reply from " << it->second.m_swtch->GetIpv4 () <<
-                   " with RTT " << it->second.GetRtt ().As (Time::MS));
-      m_echoMap.erase (it);
-    }
-
+  // Replies for pending echo requests are consumed by the transactions.
+  NS_LOG_WARN ("Echo response for unknown echo request.");
   ofl_msg_free ((struct ofl_msg_header*)msg, 0);
   return 0;
 }
@@ -336,17 +757,8 @@ OFSwitch13Controller::HandleBarrierReply (
 {
   NS_LOG_FUNCTION (this << swtch << xid);
 
-  BarrierMsgMap_t::iterator it = m_barrierMap.find (xid);
-  if (it == m_barrierMap.end ())
-    {
-      NS_LOG_WARN ("Barrier response for unknonw barrier request.");
-    }
-  else
-    {
-      NS_LOG_INFO ("Barrier reply from " << it->second.m_swtch->GetIpv4 ());
-      m_barrierMap.erase (it);
-    }
-
+  // Replies for pending barrier requests are consumed by the transactions.
+  NS_LOG_WARN ("Barrier response for unknown barrier request.");
   ofl_msg_free (msg, 0);
   return 0;
 }
@@ -386,16 +798,78 @@ OFSwitch13Controller::HandleFeaturesReply (
   swtch->m_capabilities = msg->capabilities;
   ofl_msg_free ((struct ofl_msg_header*)msg, 0);
 
+  // Auxiliary connections are attached to the main connection of the same
+  // datapath, so messages received from them are handled as if they came from
+  // the main one, while messages sent by the controller always go out through
+  // the main connection.
+  if (swtch->m_auxiliaryId)
+    {
+      DpIdSwitchMap_t::iterator it = m_dpIdMap.find (swtch->m_dpId);
+      if (it == m_dpIdMap.end ())
+        {
+          NS_LOG_ERROR ("No main connection for this auxiliary connection.");
+          return 0;
+        }
+      Ptr<RemoteSwitch> mainSwtch = it->second;
+      mainSwtch->m_auxHandlers [swtch->m_address] = swtch->m_handler;
+      m_switchesMap [swtch->m_address] = mainSwtch;
+
+      // Replies to transactions started over this connection (like the
+      // handshake barrier) will now be received from the main switch.
+      TransactionMap_t::iterator txnIt;
+      for (txnIt = m_transactions.begin ();
+           txnIt != m_transactions.end (); txnIt++)
+        {
+          if (txnIt->second.m_txn.m_swtch == swtch)
+            {
+              txnIt->second.m_txn.m_swtch = mainSwtch;
+            }
+        }
+      NS_LOG_INFO ("Auxiliary connection " << (uint16_t)swtch->m_auxiliaryId
+                                           << " from switch "
+                                           << swtch->m_dpId);
+      return 0;
+    }
+
+  // Index this switch by its datapath ID for faster lookups. When the switch
+  // reconnects before we notice the old connection closing, the stale entry
+  // is released and replaced by the new one.
+  DpIdSwitchMap_t::iterator dpIt = m_dpIdMap.find (swtch->m_dpId);
+  if (dpIt != m_dpIdMap.end () && dpIt->second != swtch)
+    {
+      NS_LOG_WARN ("Switch " << swtch->m_dpId << " reconnected. " <<
+                   "Releasing the stale connection.");
+      Ptr<RemoteSwitch> stale = dpIt->second;
+      UnregisterSwitch (stale->m_address);
+      stale->m_handler->Close ();
+    }
+  m_dpIdMap [swtch->m_dpId] = swtch;
+
   // Executing any scheduled commands for this OpenFlow datapath ID
-  std::pair <DpIdCmdMap_t::iterator, DpIdCmdMap_t::iterator> ret;
-  ret = m_schedCommands.equal_range (swtch->m_dpId);
-  for (DpIdCmdMap_t::iterator it = ret.first; it != ret.second; it++)
+  std::pair <DpIdCmdMap_t::iterator, DpIdCmdMap_t::iterator> cmds;
+  cmds = m_schedCommands.equal_range (swtch->m_dpId);
+  for (DpIdCmdMap_t::iterator it = cmds.first; it != cmds.second; it++)
     {
       DpctlExecute (swtch, it->second);
     }
-  m_schedCommands.erase (ret.first, ret.second);
+  m_schedCommands.erase (cmds.first, cmds.second);
+
+  // Start the periodic statistics polling and echo monitor for this switch.
+  StatsStart (swtch);
+  if (m_echoInterval.IsStrictlyPositive ())
+    {
+      swtch->m_echoEvent = Simulator::Schedule (
+          m_echoInterval, &OFSwitch13Controller::EchoPoll, this, swtch);
+    }
+
+  // Request the initial controller role. New connections are always equal.
+  if (m_initialRole != OFPCR_ROLE_EQUAL)
+    {
+      SendRoleRequest (swtch, m_initialRole, false);
+    }
 
   // Notify listeners that the handshake procedure is concluded.
+  m_switchConnectionTrace (swtch->m_dpId, true);
   HandshakeSuccessful (swtch);
   return 0;
 }
@@ -502,6 +976,42 @@ OFSwitch13Controller::HandleQueueGetConfigReply (
   ofl_msg_free ((struct ofl_msg_header*)msg, 0);
   return 0;
 }
+
+bool
+OFSwitch13Controller::HandlePacketInView (
+  const ofs::PacketInView &view, Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  return false;
+}
+
+bool
+OFSwitch13Controller::HandleFlowRemovedView (
+  const ofs::FlowRemovedView &view, Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  return false;
+}
+
+bool
+OFSwitch13Controller::HandlePortStatusView (
+  const ofs::PortStatusView &view, Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  return false;
+}
+
+bool
+OFSwitch13Controller::HandleMultipartReplyView (
+  const ofs::MultipartReplyView &view, Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  return false;
+}
 // --- END: Handlers functions -------
 
 /********** Private methods **********/
@@ -533,6 +1043,7 @@ OFSwitch13Controller::HandleSwitchMsg (
         (struct ofl_msg_echo*)msg, swtch, xid);
 
     case OFPT_ERROR:
+      RoleError ((struct ofl_msg_error*)msg, swtch, xid);
       return HandleError (
         (struct ofl_msg_error*)msg, swtch, xid);
 
@@ -561,6 +1072,7 @@ OFSwitch13Controller::HandleSwitchMsg (
         (struct ofl_msg_multipart_reply_header*)msg, swtch, xid);
 
     case OFPT_ROLE_REPLY:
+      RoleReply ((struct ofl_msg_role_request*)msg, swtch, xid);
       return HandleRoleReply (
         (struct ofl_msg_role_request*)msg, swtch, xid);
 
@@ -574,57 +1086,817 @@ OFSwitch13Controller::HandleSwitchMsg (
     }
 }
 
+bool
+OFSwitch13Controller::HandleSwitchMsgView (
+  const uint8_t *data, size_t size, Ptr<RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << size);
+
+  // Dispatches message views to appropriate fast-path handler functions.
+  switch (((const struct ofp_header*)data)->type)
+    {
+    case OFPT_PACKET_IN:
+      {
+        ofs::PacketInView view (data, size);
+        return view.IsValid () && HandlePacketInView (view, swtch);
+      }
+    case OFPT_FLOW_REMOVED:
+      {
+        ofs::FlowRemovedView view (data, size);
+        if (!view.IsValid ())
+          {
+            return false;
+          }
+        if (swtch->m_shadow)
+          {
+            swtch->m_shadow->RemoveFlow (view);
+          }
+        return HandleFlowRemovedView (view, swtch);
+      }
+    case OFPT_PORT_STATUS:
+      {
+        ofs::PortStatusView view (data, size);
+        return view.IsValid () && HandlePortStatusView (view, swtch);
+      }
+    case OFPT_MULTIPART_REPLY:
+      {
+        ofs::MultipartReplyView view (data, size);
+        if (!view.IsValid ())
+          {
+            return false;
+          }
+        // OFSwitch13 experimenter replies are always consumed here, as the
+        // ofsoftswitch13 library can't unpack them.
+        return HandleMultipartReplyView (view, swtch)
+               || view.GetExperimenterId () == ofs::OFS13_EXPERIMENTER_ID;
+      }
+    default:
+      return false;
+    }
+}
+
 void
-OFSwitch13Controller::ReceiveFromSwitch (Ptr<Packet> packet, Address from)
+OFSwitch13Controller::TransactionStart (Ptr<const RemoteSwitch> swtch,
+                                        uint32_t xid, TransactionCallback cb,
+                                        Time timeout)
 {
-  NS_LOG_FUNCTION (this << packet);
+  NS_LOG_FUNCTION (this << swtch << xid);
 
-  uint32_t xid;
-  struct ofl_msg_header *msg;
-  ofl_err error;
+  PendingTransaction &pending = m_transactions [xid];
+  pending.m_txn.m_xid = xid;
+  pending.m_txn.m_swtch = swtch;
+  pending.m_txn.m_status = TRANSACTION_DONE;
+  pending.m_txn.m_start = Simulator::Now ();
+  pending.m_callback = cb;
+  pending.m_batch = false;
+  pending.m_firstXid = 0;
+  pending.m_lastXid = 0;
+  pending.m_timeout = Simulator::Schedule (
+      timeout.IsStrictlyPositive () ? timeout : m_txnTimeout,
+      &OFSwitch13Controller::TransactionDone, this, xid,
+      TRANSACTION_TIMEOUT);
+}
 
-  // Get the openflow buffer, unpack the message and send to message handler
-  struct ofpbuf *buffer;
-  buffer = ofs::BufferFromPacket (packet, packet->GetSize ());
-  error = ofl_msg_unpack ((uint8_t*)buffer->data, buffer->size, &msg, &xid, 0);
+bool
+OFSwitch13Controller::TransactionReply (const uint8_t *data, size_t size,
+                                        Ptr<RemoteSwitch> swtch)
+{
+  if (m_transactions.empty ())
+    {
+      return false;
+    }
 
-  if (!error)
+  // Only replies and errors are matched, as the xid of asynchronous and
+  // request messages from the switch is not related to controller requests.
+  ofs::MessageView view (data, size);
+  uint8_t type = view.GetType ();
+  if (type == OFPT_HELLO || type == OFPT_ECHO_REQUEST
+      || type == OFPT_PACKET_IN || type == OFPT_FLOW_REMOVED
+      || type == OFPT_PORT_STATUS)
     {
-      Ptr<RemoteSwitch> swtch = GetRemoteSwitch (from);
-      char *msgStr = ofl_msg_to_string (msg, 0);
-      NS_LOG_DEBUG ("RX from switch " << swtch->GetIpv4 () <<
-                    " [dp " << swtch->GetDpId () << "]: " << msgStr);
-      free (msgStr);
+      return false;
+    }
 
-      error = HandleSwitchMsg (msg, swtch, xid);
-      if (error)
+  uint32_t xid = view.GetXid ();
+  TransactionMap_t::iterator it = m_transactions.find (xid);
+  if (it == m_transactions.end ())
+    {
+      if (type != OFPT_ERROR)
         {
-          // NOTE: It is assumed that if a handler returns with error, it did
-          // not use any part of the control message, thus it can be freed up.
-          // If no error is returned however, the message must be freed inside
-          // the handler (because the handler might keep parts of the message)
-          ofl_msg_free (msg, 0);
+          return false;
+        }
+
+      // Look for a batch including the failed message.
+      for (it = m_transactions.begin (); it != m_transactions.end (); it++)
+        {
+          PendingTransaction &pending = it->second;
+          uint32_t offset = xid - pending.m_firstXid;
+          uint32_t length = pending.m_lastXid - pending.m_firstXid;
+          if (pending.m_batch && pending.m_txn.m_swtch == swtch
+              && offset <= length)
+            {
+              pending.m_txn.m_status = TRANSACTION_ERROR;
+              pending.m_txn.m_replies.push_back (
+                std::vector<uint8_t> (data, data + size));
+              return true;
+            }
         }
+      return false;
     }
-  if (error)
+
+  PendingTransaction &pending = it->second;
+  if (pending.m_txn.m_swtch != swtch)
     {
-      NS_LOG_ERROR ("Error processing OpenFlow message from switch.");
+      return false;
+    }
+  pending.m_txn.m_replies.push_back (std::vector<uint8_t> (data, data + size));
+
+  if (type == OFPT_ERROR)
+    {
+      TransactionDone (xid, TRANSACTION_ERROR);
     }
-  ofpbuf_delete (buffer);
+  else if (type == OFPT_MULTIPART_REPLY)
+    {
+      ofs::MultipartReplyView reply (data, size);
+      if (!reply.IsValid () || !reply.HasMore ())
+        {
+          TransactionDone (xid, TRANSACTION_DONE);
+        }
+    }
+  else
+    {
+      // Barrier replies keep the error status from batched messages.
+      TransactionDone (xid, pending.m_txn.m_status);
+    }
+  return true;
 }
 
-Ptr<OFSwitch13Controller::RemoteSwitch>
-OFSwitch13Controller::GetRemoteSwitch (Address address)
+void
+OFSwitch13Controller::TransactionDone (uint32_t xid, TransactionStatus status)
 {
-  NS_LOG_FUNCTION (this << address);
+  NS_LOG_FUNCTION (this << xid << status);
 
-  SwitchsMap_t::const_iterator it = m_switchesMap.find (address);
-  if (it != m_switchesMap.end ())
+  TransactionMap_t::iterator it = m_transactions.find (xid);
+  if (it == m_transactions.end ())
     {
-      return it->second;
+      return;
     }
-  NS_ABORT_MSG ("Couldn't find the remote switch for this address.");
-}
+
+  // Remove the transaction before invoking the callback, as it may start
+  // new transactions.
+  PendingTransaction pending = it->second;
+  m_transactions.erase (it);
+  pending.m_timeout.Cancel ();
+  pending.m_txn.m_status = status;
+  if (status == TRANSACTION_TIMEOUT || status == TRANSACTION_CLOSED)
+    {
+      pending.m_txn.m_replies.clear ();
+      NS_LOG_WARN ("Transaction " << xid << " not completed.");
+    }
+  if (!pending.m_callback.IsNull ())
+    {
+      pending.m_callback (pending.m_txn);
+    }
+}
+
+void
+OFSwitch13Controller::TransactionDoneAll (Ptr<const RemoteSwitch> swtch,
+                                          TransactionStatus status)
+{
+  NS_LOG_FUNCTION (this << swtch << status);
+
+  std::vector<uint32_t> xids;
+  for (TransactionMap_t::iterator it = m_transactions.begin ();
+       it != m_transactions.end (); it++)
+    {
+      if (it->second.m_txn.m_swtch == swtch)
+        {
+          xids.push_back (it->first);
+        }
+    }
+  for (size_t i = 0; i < xids.size (); i++)
+    {
+      TransactionDone (xids [i], status);
+    }
+}
+
+void
+OFSwitch13Controller::EchoDone (const Transaction &txn)
+{
+  NS_LOG_FUNCTION (this << txn.m_xid);
+
+  if (txn.m_status == TRANSACTION_DONE)
+    {
+      NS_LOG_INFO ("Echo reply from " << txn.m_swtch->GetIpv4 () <<
+                   " with RTT " <<
+                   (Simulator::Now () - txn.m_start).As (Time::MS));
+    }
+}
+
+void
+OFSwitch13Controller::BarrierDone (const Transaction &txn)
+{
+  NS_LOG_FUNCTION (this << txn.m_xid);
+
+  if (txn.m_status == TRANSACTION_DONE)
+    {
+      NS_LOG_INFO ("Barrier reply from " << txn.m_swtch->GetIpv4 ());
+    }
+}
+
+void
+OFSwitch13Controller::EchoPoll (Ptr<RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch);
+
+  // Stop polling switches that are not registered anymore.
+  DpIdSwitchMap_t::iterator it = m_dpIdMap.find (swtch->m_dpId);
+  if (it == m_dpIdMap.end () || it->second != swtch)
+    {
+      return;
+    }
+
+  // Replies not received before the next request are counted as missed.
+  if (!m_echoTemplate)
+    {
+      struct ofl_msg_echo msg;
+      msg.header.type = OFPT_ECHO_REQUEST;
+      msg.data_length = 0;
+      msg.data = 0;
+      m_echoTemplate = Create<ofs::MessageTemplate> (
+          (struct ofl_msg_header*)&msg);
+    }
+  SendRequest (swtch, m_echoTemplate,
+               MakeCallback (&OFSwitch13Controller::EchoPollDone, this),
+               m_echoInterval);
+  swtch->m_echoEvent = Simulator::Schedule (
+      m_echoInterval, &OFSwitch13Controller::EchoPoll, this, swtch);
+}
+
+void
+OFSwitch13Controller::EchoPollDone (const Transaction &txn)
+{
+  NS_LOG_FUNCTION (this << txn.m_xid << txn.m_status);
+
+  Ptr<RemoteSwitch> swtch = ConstCast<RemoteSwitch> (txn.m_swtch);
+  if (txn.m_status == TRANSACTION_DONE)
+    {
+      Time rtt = Simulator::Now () - txn.m_start;
+      swtch->m_echoMissed = 0;
+      swtch->m_ewmaRtt = swtch->m_ewmaRtt.IsZero () ? rtt :
+        Time (m_echoAlpha * rtt.GetDouble ()
+              + (1 - m_echoAlpha) * swtch->m_ewmaRtt.GetDouble ());
+
+      uint64_t bin = rtt.GetInteger () / m_rttBinWidth.GetInteger ();
+      if (bin >= swtch->m_rttHistogram.size ())
+        {
+          swtch->m_rttHistogram.resize (bin + 1, 0);
+        }
+      swtch->m_rttHistogram [bin]++;
+      m_echoRttTrace (swtch->m_dpId, rtt, swtch->m_ewmaRtt);
+      return;
+    }
+
+  // The connection may have been released by the controller in the meantime.
+  if (txn.m_status != TRANSACTION_TIMEOUT || !swtch->m_handler
+      || ++swtch->m_echoMissed < m_echoMissLimit)
+    {
+      return;
+    }
+
+  // Too many missed replies. Close the connection, so the switch can
+  // reconnect (or fail over to another controller). The switch is only
+  // unregistered by the close callbacks, as messages already in flight can
+  // still be received until then.
+  NS_LOG_WARN ("Switch " << swtch->m_dpId << " missed " <<
+               swtch->m_echoMissed << " echo replies. Closing connection.");
+  swtch->m_echoEvent.Cancel ();
+  RemoteSwitch::StatsEventMap_t::iterator evIt;
+  for (evIt = swtch->m_statsEvents.begin ();
+       evIt != swtch->m_statsEvents.end (); evIt++)
+    {
+      evIt->second.Cancel ();
+    }
+  swtch->m_handler->Close ();
+}
+
+void
+OFSwitch13Controller::StatsStart (Ptr<RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch);
+
+  static const uint16_t types [] = {
+    OFPMP_FLOW, OFPMP_PORT_STATS, OFPMP_QUEUE, OFPMP_METER, OFPMP_TABLE
+  };
+  for (size_t i = 0; i < sizeof (types) / sizeof (types [0]); i++)
+    {
+      Time interval = GetStatsInterval (types [i]);
+      if (interval.IsStrictlyPositive ())
+        {
+          Time offset = Seconds (
+              m_statsRng->GetValue (0, interval.GetSeconds ()));
+          swtch->m_statsEvents [types [i]] = Simulator::Schedule (
+              offset, &OFSwitch13Controller::StatsPoll, this, swtch,
+              types [i]);
+        }
+    }
+}
+
+void
+OFSwitch13Controller::StatsPoll (Ptr<RemoteSwitch> swtch, uint16_t type)
+{
+  NS_LOG_FUNCTION (this << swtch << type);
+
+  // Stop polling switches that are not registered anymore.
+  DpIdSwitchMap_t::iterator it = m_dpIdMap.find (swtch->m_dpId);
+  if (it == m_dpIdMap.end () || it->second != swtch)
+    {
+      return;
+    }
+
+  // Pending requests are completed by the transaction timeout at the
+  // polling interval, so a lost reply only skips a single round.
+  Time interval = GetStatsInterval (type);
+  if (swtch->m_statsXids.find (type) == swtch->m_statsXids.end ())
+    {
+      uint32_t xid = SendRequest (
+          swtch, GetStatsTemplate (type),
+          MakeCallback (&OFSwitch13Controller::StatsPollDone, this),
+          interval);
+      if (xid)
+        {
+          swtch->m_statsXids [type] = xid;
+        }
+    }
+  else
+    {
+      NS_LOG_WARN ("Stats request " << type << " still pending for switch " <<
+                   swtch->m_dpId << ". Skipping this round.");
+    }
+  swtch->m_statsEvents [type] = Simulator::Schedule (
+      interval, &OFSwitch13Controller::StatsPoll, this, swtch, type);
+}
+
+void
+OFSwitch13Controller::StatsPollDone (const Transaction &txn)
+{
+  NS_LOG_FUNCTION (this << txn.m_xid << txn.m_status);
+
+  Ptr<RemoteSwitch> swtch = ConstCast<RemoteSwitch> (txn.m_swtch);
+  RemoteSwitch::StatsXidMap_t::iterator pending;
+  for (pending = swtch->m_statsXids.begin ();
+       pending != swtch->m_statsXids.end (); pending++)
+    {
+      if (pending->second == txn.m_xid)
+        {
+          break;
+        }
+    }
+  if (pending == swtch->m_statsXids.end ())
+    {
+      return;
+    }
+  uint16_t type = pending->first;
+  swtch->m_statsXids.erase (pending);
+  if (txn.m_status != TRANSACTION_DONE)
+    {
+      NS_LOG_WARN ("Stats request " << type << " failed for switch " <<
+                   swtch->m_dpId << ".");
+      return;
+    }
+
+  for (size_t i = 0; i < txn.m_replies.size (); i++)
+    {
+      const std::vector<uint8_t> &reply = txn.m_replies [i];
+      ofs::MultipartReplyView view (reply.data (), reply.size ());
+      if (view.IsValid () && view.GetMultipartType () == type)
+        {
+          StatsReply (view, swtch);
+        }
+    }
+
+  // The request is complete, so we can remove the counters for entries that
+  // were not reported in this reply.
+  RemoteSwitch::StatsCountersMap_t &counters = swtch->m_statsCounters [type];
+  RemoteSwitch::StatsCountersMap_t::iterator it = counters.begin ();
+  while (it != counters.end ())
+    {
+      if (it->second.m_xid != txn.m_xid)
+        {
+          it = counters.erase (it);
+        }
+      else
+        {
+          it++;
+        }
+    }
+}
+
+void
+OFSwitch13Controller::StatsReply (const ofs::MultipartReplyView &view,
+                                  Ptr<RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  uint16_t type = view.GetMultipartType ();
+  uint32_t xid = view.GetXid ();
+
+  StatsRate rate;
+  rate.m_dpId = swtch->m_dpId;
+  rate.m_type = type;
+  rate.m_tableId = 0;
+  rate.m_priority = 0;
+  switch (type)
+    {
+    case OFPMP_FLOW:
+      {
+        const struct ofp_flow_stats *entry = view.GetNextFlowStats (0);
+        for (; entry; entry = view.GetNextFlowStats (entry))
+          {
+            // Flows are identified by table, priority, and match fields.
+            const uint8_t *match = (const uint8_t*)&entry->match;
+            std::string key ((const char*)&entry->table_id, 1);
+            key.append ((const char*)&entry->priority, 2);
+            key.append ((const char*)match, ntohs (entry->match.length));
+            rate.m_id = ntohll (entry->cookie);
+            rate.m_tableId = entry->table_id;
+            rate.m_priority = ntohs (entry->priority);
+            StatsUpdate (swtch, rate, key, xid,
+                         ntohll (entry->byte_count),
+                         ntohll (entry->packet_count), 0, 0);
+          }
+        break;
+      }
+    case OFPMP_PORT_STATS:
+      {
+        for (size_t i = 0; i < view.GetNPortStats (); i++)
+          {
+            const struct ofp_port_stats *entry = view.GetPortStats (i);
+            std::string key ((const char*)&entry->port_no, 4);
+            rate.m_id = ntohl (entry->port_no);
+            StatsUpdate (swtch, rate, key, xid,
+                         ntohll (entry->tx_bytes),
+                         ntohll (entry->tx_packets),
+                         ntohll (entry->rx_bytes),
+                         ntohll (entry->rx_packets));
+          }
+        break;
+      }
+    case OFPMP_QUEUE:
+      {
+        for (size_t i = 0; i < view.GetNQueueStats (); i++)
+          {
+            const struct ofp_queue_stats *entry = view.GetQueueStats (i);
+            rate.m_id = ((uint64_t)ntohl (entry->port_no) << 32)
+              | ntohl (entry->queue_id);
+            std::string key ((const char*)&rate.m_id, 8);
+            StatsUpdate (swtch, rate, key, xid,
+                         ntohll (entry->tx_bytes),
+                         ntohll (entry->tx_packets), 0, 0);
+          }
+        break;
+      }
+    case OFPMP_METER:
+      {
+        const struct ofp_meter_stats *entry = view.GetNextMeterStats (0);
+        for (; entry; entry = view.GetNextMeterStats (entry))
+          {
+            std::string key ((const char*)&entry->meter_id, 4);
+            rate.m_id = ntohl (entry->meter_id);
+            StatsUpdate (swtch, rate, key, xid, 0, 0,
+                         ntohll (entry->byte_in_count),
+                         ntohll (entry->packet_in_count));
+          }
+        break;
+      }
+    case OFPMP_TABLE:
+      {
+        for (size_t i = 0; i < view.GetNTableStats (); i++)
+          {
+            const struct ofp_table_stats *entry = view.GetTableStats (i);
+            std::string key ((const char*)&entry->table_id, 1);
+            rate.m_id = entry->table_id;
+            StatsUpdate (swtch, rate, key, xid,
+                         0, ntohll (entry->matched_count),
+                         0, ntohll (entry->lookup_count));
+          }
+        break;
+      }
+    }
+}
+
+void
+OFSwitch13Controller::StatsUpdate (
+  Ptr<RemoteSwitch> swtch, StatsRate &rate, const std::string &key,
+  uint32_t xid, uint64_t txBytes, uint64_t txPackets, uint64_t rxBytes,
+  uint64_t rxPackets)
+{
+  Time now = Simulator::Now ();
+  RemoteSwitch::StatsCountersMap_t &counters =
+    swtch->m_statsCounters [rate.m_type];
+  RemoteSwitch::StatsCountersMap_t::iterator it = counters.find (key);
+  if (it != counters.end ())
+    {
+      // Rates are only computed for monotonic counters. A reset counter
+      // (i.e., a replaced flow entry) starts a new sample sequence.
+      RemoteSwitch::StatsCounters &last = it->second;
+      if (now > last.m_time
+          && txBytes >= last.m_txBytes && txPackets >= last.m_txPackets
+          && rxBytes >= last.m_rxBytes && rxPackets >= last.m_rxPackets)
+        {
+          double secs = (now - last.m_time).GetSeconds ();
+          rate.m_interval = now - last.m_time;
+          rate.m_txBps = (txBytes - last.m_txBytes) * 8 / secs;
+          rate.m_txPps = (txPackets - last.m_txPackets) / secs;
+          rate.m_rxBps = (rxBytes - last.m_rxBytes) * 8 / secs;
+          rate.m_rxPps = (rxPackets - last.m_rxPackets) / secs;
+          m_statsRateTrace (rate);
+        }
+    }
+  else
+    {
+      it = counters.insert (
+          std::make_pair (key, RemoteSwitch::StatsCounters ())).first;
+    }
+
+  RemoteSwitch::StatsCounters &last = it->second;
+  last.m_txBytes = txBytes;
+  last.m_txPackets = txPackets;
+  last.m_rxBytes = rxBytes;
+  last.m_rxPackets = rxPackets;
+  last.m_time = now;
+  last.m_xid = xid;
+}
+
+Time
+OFSwitch13Controller::GetStatsInterval (uint16_t type) const
+{
+  switch (type)
+    {
+    case OFPMP_FLOW:
+      return m_flowStatsInterval;
+    case OFPMP_PORT_STATS:
+      return m_portStatsInterval;
+    case OFPMP_QUEUE:
+      return m_queueStatsInterval;
+    case OFPMP_METER:
+      return m_meterStatsInterval;
+    case OFPMP_TABLE:
+      return m_tableStatsInterval;
+    default:
+      return Time (0);
+    }
+}
+
+Ptr<ofs::MessageTemplate>
+OFSwitch13Controller::GetStatsTemplate (uint16_t type)
+{
+  NS_LOG_FUNCTION (this << type);
+
+  StatsTemplateMap_t::iterator it = m_statsTemplates.find (type);
+  if (it != m_statsTemplates.end ())
+    {
+      return it->second;
+    }
+
+  // Statistics requests are always the same for all switches, so we pack
+  // each request type only once.
+  Ptr<ofs::MessageTemplate> tmpl;
+  switch (type)
+    {
+    case OFPMP_FLOW:
+      {
+        struct ofl_match match;
+        ofl_structs_match_init (&match);
+
+        struct ofl_msg_multipart_request_flow msg;
+        msg.header.header.type = OFPT_MULTIPART_REQUEST;
+        msg.header.type = OFPMP_FLOW;
+        msg.header.flags = 0;
+        msg.table_id = OFPTT_ALL;
+        msg.out_port = OFPP_ANY;
+        msg.out_group = OFPG_ANY;
+        msg.cookie = 0;
+        msg.cookie_mask = 0;
+        msg.match = (struct ofl_match_header*)&match;
+        tmpl = Create<ofs::MessageTemplate> ((struct ofl_msg_header*)&msg);
+        break;
+      }
+    case OFPMP_PORT_STATS:
+      {
+        struct ofl_msg_multipart_request_port msg;
+        msg.header.header.type = OFPT_MULTIPART_REQUEST;
+        msg.header.type = OFPMP_PORT_STATS;
+        msg.header.flags = 0;
+        msg.port_no = OFPP_ANY;
+        tmpl = Create<ofs::MessageTemplate> ((struct ofl_msg_header*)&msg);
+        break;
+      }
+    case OFPMP_QUEUE:
+      {
+        struct ofl_msg_multipart_request_queue msg;
+        msg.header.header.type = OFPT_MULTIPART_REQUEST;
+        msg.header.type = OFPMP_QUEUE;
+        msg.header.flags = 0;
+        msg.port_no = OFPP_ANY;
+        msg.queue_id = OFPQ_ALL;
+        tmpl = Create<ofs::MessageTemplate> ((struct ofl_msg_header*)&msg);
+        break;
+      }
+    case OFPMP_METER:
+      {
+        struct ofl_msg_multipart_meter_request msg;
+        msg.header.header.type = OFPT_MULTIPART_REQUEST;
+        msg.header.type = OFPMP_METER;
+        msg.header.flags = 0;
+        msg.meter_id = OFPM_ALL;
+        tmpl = Create<ofs::MessageTemplate> ((struct ofl_msg_header*)&msg);
+        break;
+      }
+    case OFPMP_TABLE:
+      {
+        struct ofl_msg_multipart_request_header msg;
+        msg.header.type = OFPT_MULTIPART_REQUEST;
+        msg.type = OFPMP_TABLE;
+        msg.flags = 0;
+        tmpl = Create<ofs::MessageTemplate> ((struct ofl_msg_header*)&msg);
+        break;
+      }
+    default:
+      NS_ABORT_MSG ("Unsupported statistics type.");
+    }
+
+  m_statsTemplates [type] = tmpl;
+  return tmpl;
+}
+
+void
+OFSwitch13Controller::ReceiveFromSwitch (uint8_t *data, size_t size,
+                                         Address from)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  uint32_t xid;
+  struct ofl_msg_header *msg;
+  ofl_err error;
+
+  // Both the message views and the ofl_msg_unpack () function work directly
+  // over the socket handler receive buffer, with no further copies.
+  // Try the fast-path handlers before unpacking the message.
+  Ptr<RemoteSwitch> swtch = GetRemoteSwitch (from);
+  if (!swtch)
+    {
+      NS_LOG_WARN ("Discarding message from unregistered switch " <<
+                   InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+      return;
+    }
+
+  // Keep the installed state mirror consistent with the switch: messages
+  // rejected with errors are undone, and barrier replies confirm the messages
+  // sent before them.
+  const struct ofp_header *header = (const struct ofp_header*)data;
+  if (swtch->m_shadow && header->type == OFPT_ERROR)
+    {
+      swtch->m_shadow->Reject (ntohl (header->xid));
+    }
+  else if (swtch->m_shadow && header->type == OFPT_BARRIER_REPLY)
+    {
+      swtch->m_shadow->Confirm (ntohl (header->xid));
+    }
+
+  if (TransactionReply (data, size, swtch)
+      || HandleSwitchMsgView (data, size, swtch))
+    {
+      return;
+    }
+
+  // Unpack the message and send to message handler
+  error = ofl_msg_unpack (data, size, &msg, &xid, 0);
+  if (!error)
+    {
+      char *msgStr = ofl_msg_to_string (msg, 0);
+      NS_LOG_DEBUG ("RX from switch " << swtch->GetIpv4 () <<
+                    " [dp " << swtch->GetDpId () << "]: " << msgStr);
+      free (msgStr);
+
+      error = HandleSwitchMsg (msg, swtch, xid);
+      if (error)
+        {
+          // NOTE: It is assumed that if a handler returns with error, it did
+          // not use any part of the control message, thus it can be freed up.
+          // If no error is returned however, the message must be freed inside
+          // the handler (because the handler might keep parts of the message)
+          ofl_msg_free (msg, 0);
+        }
+    }
+  if (error)
+    {
+      NS_LOG_ERROR ("Error processing OpenFlow message from switch.");
+    }
+}
+
+Ptr<OFSwitch13Controller::RemoteSwitch>
+OFSwitch13Controller::GetRemoteSwitch (Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  SwitchsMap_t::const_iterator it = m_switchesMap.find (address);
+  if (it != m_switchesMap.end ())
+    {
+      return it->second;
+    }
+  return 0;
+}
+
+void
+OFSwitch13Controller::UnregisterSwitch (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  // Look for the main or auxiliary connection handler using this socket.
+  SwitchsMap_t::iterator it;
+  for (it = m_switchesMap.begin (); it != m_switchesMap.end (); it++)
+    {
+      Ptr<RemoteSwitch> swtch = it->second;
+      Ptr<OFSwitch13SocketHandler> handler = swtch->m_handler;
+      if (it->first != swtch->m_address)
+        {
+          RemoteSwitch::AuxHandlerMap_t::iterator auxIt =
+            swtch->m_auxHandlers.find (it->first);
+          handler = (auxIt != swtch->m_auxHandlers.end ()) ? auxIt->second : 0;
+        }
+      if (handler && handler->GetSocket () == socket)
+        {
+          UnregisterSwitch (it->first);
+          return;
+        }
+    }
+  NS_LOG_DEBUG ("No remote switch registered for this socket.");
+}
+
+void
+OFSwitch13Controller::UnregisterSwitch (Ptr<OFSwitch13SocketHandler> handler)
+{
+  NS_LOG_FUNCTION (this << handler);
+
+  // Direct channels are only used by main connections.
+  SwitchsMap_t::iterator it;
+  for (it = m_switchesMap.begin (); it != m_switchesMap.end (); it++)
+    {
+      if (it->first == it->second->m_address
+          && it->second->m_handler == handler)
+        {
+          UnregisterSwitch (it->first);
+          return;
+        }
+    }
+  NS_LOG_DEBUG ("No remote switch registered for this handler.");
+}
+
+void
+OFSwitch13Controller::UnregisterSwitch (Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  SwitchsMap_t::iterator it = m_switchesMap.find (address);
+  if (it != m_switchesMap.end ())
+    {
+      Ptr<RemoteSwitch> swtch = it->second;
+      if (swtch->m_address != address)
+        {
+          // This is an auxiliary connection attached to the main one.
+          swtch->m_auxHandlers.erase (address);
+          m_switchesMap.erase (it);
+          return;
+        }
+
+      // Closing the main connection also releases auxiliary ones.
+      RemoteSwitch::AuxHandlerMap_t::iterator auxIt;
+      for (auxIt = swtch->m_auxHandlers.begin ();
+           auxIt != swtch->m_auxHandlers.end (); auxIt++)
+        {
+          m_switchesMap.erase (auxIt->first);
+        }
+      swtch->m_auxHandlers.clear ();
+
+      DpIdSwitchMap_t::iterator dpIt = m_dpIdMap.find (swtch->m_dpId);
+      if (dpIt != m_dpIdMap.end () && dpIt->second == swtch)
+        {
+          m_dpIdMap.erase (dpIt);
+          m_switchConnectionTrace (swtch->m_dpId, false);
+        }
+      m_switchesMap.erase (it);
+      swtch->m_echoEvent.Cancel ();
+      RemoteSwitch::StatsEventMap_t::iterator evIt;
+      for (evIt = swtch->m_statsEvents.begin ();
+           evIt != swtch->m_statsEvents.end (); evIt++)
+        {
+          evIt->second.Cancel ();
+        }
+      TransactionDoneAll (swtch, TRANSACTION_CLOSED);
+      NS_LOG_INFO ("Switch " << swtch->m_dpId << " unregistered.");
+    }
+}
 
 bool
 OFSwitch13Controller::SocketRequest (Ptr<Socket> socket, const Address& from)
@@ -649,19 +1921,47 @@ OFSwitch13Controller::SocketAccept (Ptr<Socket> socket, const Address& from)
   uint16_t port = InetSocketAddress::ConvertFrom (from).GetPort ();
   NS_LOG_INFO ("Switch connection accepted from " << ipAddr << ":" << port);
 
+  // As we have more than one socket that is used for communication between
+  // this OpenFlow controller and switches, we need to handle the process of
+  // sending/receiving OpenFlow messages to/from sockets in an independent way.
+  // So, each socket has its own socket handler to this end.
+  RegisterSwitch (CreateObject<OFSwitch13SocketHandler> (socket), from);
+}
+
+void
+OFSwitch13Controller::AcceptDirectConnection (
+  Ptr<OFSwitch13SocketHandler> handler, Address swAddr)
+{
+  NS_LOG_FUNCTION (this << handler << swAddr);
+
+  NS_LOG_INFO ("Switch direct connection from " <<
+               InetSocketAddress::ConvertFrom (swAddr).GetIpv4 ());
+  RegisterSwitch (handler, swAddr);
+}
+
+void
+OFSwitch13Controller::RegisterSwitch (Ptr<OFSwitch13SocketHandler> handler,
+                                      Address from)
+{
+  NS_LOG_FUNCTION (this << handler << from);
+
   // This is a new switch connection to this controller.
   // Let's create the remote switch metadata and save it.
   Ptr<RemoteSwitch> swtch = Create<RemoteSwitch> ();
   swtch->m_address = from;
   swtch->m_ctrlApp = Ptr<OFSwitch13Controller> (this);
+  if (m_shadowEnabled)
+    {
+      swtch->m_shadow = Create<OFSwitch13FlowShadow> (m_txnTimeout);
+    }
 
-  // As we have more than one socket that is used for communication between
-  // this OpenFlow controller and switches, we need to handle the process of
-  // sending/receiving OpenFlow messages to/from sockets in an independent way.
-  // So, each socket has its own socket handler to this end.
-  swtch->m_handler = CreateObject<OFSwitch13SocketHandler> (socket);
-  swtch->m_handler->SetReceiveCallback (
+  swtch->m_handler = handler;
+  swtch->m_handler->SetReceiveRawCallback (
     MakeCallback (&OFSwitch13Controller::ReceiveFromSwitch, this));
+  swtch->m_handler->SetCongestionCallback (
+    MakeCallback (&OFSwitch13Controller::SocketCongestion, this));
+  swtch->m_handler->SetCloseCallback (
+    MakeCallback (&OFSwitch13Controller::DirectPeerClose, this));
 
   std::pair <Address, Ptr<RemoteSwitch> > entry (swtch->m_address, swtch);
   std::pair <SwitchsMap_t::iterator, bool> ret;
@@ -684,6 +1984,7 @@ OFSwitch13Controller::SocketPeerClose (Ptr<Socket> socket)
   NS_LOG_FUNCTION (this << socket);
 
   NS_LOG_DEBUG ("Connection successfully closed.");
+  UnregisterSwitch (socket);
   socket->ShutdownSend ();
   socket->ShutdownRecv ();
 }
@@ -694,15 +1995,139 @@ OFSwitch13Controller::SocketPeerError (Ptr<Socket> socket)
   NS_LOG_FUNCTION (this << socket);
 
   NS_LOG_ERROR ("Socket peer error " << socket);
+  UnregisterSwitch (socket);
   socket->ShutdownSend ();
   socket->ShutdownRecv ();
 }
 
+void
+OFSwitch13Controller::DirectPeerClose (Ptr<OFSwitch13SocketHandler> handler)
+{
+  NS_LOG_FUNCTION (this << handler);
+
+  NS_LOG_DEBUG ("Direct channel connection closed.");
+  UnregisterSwitch (handler);
+}
+
+void
+OFSwitch13Controller::SocketCongestion (bool congested, Address from)
+{
+  NS_LOG_FUNCTION (this << congested << from);
+
+  // Only the main connection is used to send messages to the switch.
+  SwitchsMap_t::const_iterator it = m_switchesMap.find (from);
+  if (it != m_switchesMap.end () && it->second->m_address == from)
+    {
+      ChannelCongestion (it->second, congested);
+    }
+}
+
+int
+OFSwitch13Controller::SendRoleRequest (Ptr<RemoteSwitch> swtch,
+                                       enum ofp_controller_role role,
+                                       bool probe)
+{
+  NS_LOG_FUNCTION (this << swtch << role << probe);
+
+  // Only master requests start a new generation. Slave requests reuse the
+  // last generation id, while equal and no-change requests ignore it.
+  struct ofl_msg_role_request msg;
+  msg.header.type = OFPT_ROLE_REQUEST;
+  msg.role = probe ? OFPCR_ROLE_NOCHANGE : role;
+  msg.generation_id = 0;
+  if (!probe && role == OFPCR_ROLE_MASTER)
+    {
+      msg.generation_id = ++swtch->m_generationId;
+    }
+  else if (!probe && role == OFPCR_ROLE_SLAVE)
+    {
+      msg.generation_id = swtch->m_generationId;
+    }
+
+  uint32_t xid = GetNextXid ();
+  RemoteSwitch::RoleRequest request;
+  request.m_role = role;
+  request.m_probe = probe;
+  swtch->m_roleXids [xid] = request;
+  return SendToSwitch (swtch, (struct ofl_msg_header*)&msg, xid);
+}
+
+void
+OFSwitch13Controller::RoleReply (struct ofl_msg_role_request *msg,
+                                 Ptr<RemoteSwitch> swtch, uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << swtch << xid);
+
+  RemoteSwitch::RoleXidMap_t::iterator it = swtch->m_roleXids.find (xid);
+  if (it == swtch->m_roleXids.end ())
+    {
+      return;
+    }
+  RemoteSwitch::RoleRequest request = it->second;
+  swtch->m_roleXids.erase (it);
+
+  // Learn the generation id cached by the switch (with wraparound).
+  if ((int64_t)(msg->generation_id - swtch->m_generationId) > 0)
+    {
+      swtch->m_generationId = msg->generation_id;
+    }
+
+  if (request.m_probe)
+    {
+      SendRoleRequest (swtch, request.m_role, false);
+      return;
+    }
+
+  enum ofp_controller_role role = (enum ofp_controller_role)msg->role;
+  if (role != swtch->m_role)
+    {
+      NS_LOG_INFO ("Controller role " << role << " over switch " <<
+                   swtch->m_dpId << " with generation " <<
+                   swtch->m_generationId);
+      swtch->m_role = role;
+      m_roleTrace (swtch->m_dpId, role);
+    }
+}
+
+void
+OFSwitch13Controller::RoleError (struct ofl_msg_error *msg,
+                                 Ptr<RemoteSwitch> swtch, uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << swtch << xid);
+
+  if (msg->type != OFPET_ROLE_REQUEST_FAILED)
+    {
+      return;
+    }
+
+  RemoteSwitch::RoleXidMap_t::iterator it = swtch->m_roleXids.find (xid);
+  if (it == swtch->m_roleXids.end ())
+    {
+      return;
+    }
+  RemoteSwitch::RoleRequest request = it->second;
+  swtch->m_roleXids.erase (it);
+
+  // A stale generation id means that another controller became master with
+  // a greater one. Query the current value and try again.
+  if (msg->code == OFPRRFC_STALE && !request.m_probe)
+    {
+      NS_LOG_INFO ("Stale generation id for switch " << swtch->m_dpId);
+      SendRoleRequest (swtch, request.m_role, true);
+      return;
+    }
+  NS_LOG_ERROR ("Role request failed for switch " << swtch->m_dpId);
+}
+
 OFSwitch13Controller::RemoteSwitch::RemoteSwitch ()
   : m_handler (0),
   m_ctrlApp (0),
   m_dpId (0),
-  m_role (OFPCR_ROLE_EQUAL)
+  m_role (OFPCR_ROLE_EQUAL),
+  m_shadow (0),
+  m_generationId (0),
+  m_echoMissed (0),
+  m_ewmaRtt (Time (0))
 {
   m_address = Address ();
 }
@@ -725,30 +2150,46 @@ OFSwitch13Controller::RemoteSwitch::GetDpId (void) const
   return m_dpId;
 }
 
-OFSwitch13Controller::EchoInfo::EchoInfo (Ptr<const RemoteSwitch> swtch)
-  : m_waiting (true),
-  m_send (Simulator::Now ()),
-  m_swtch (swtch)
+Ptr<const OFSwitch13FlowShadow>
+OFSwitch13Controller::RemoteSwitch::GetFlowShadow (void) const
+{
+  return m_shadow;
+}
+
+bool
+OFSwitch13Controller::RemoteSwitch::IsCongested (void) const
 {
+  return m_handler && m_handler->IsCongested ();
+}
+
+uint32_t
+OFSwitch13Controller::RemoteSwitch::GetNAuxiliaryConnections (void) const
+{
+  return m_auxHandlers.size ();
+}
+
+enum ofp_controller_role
+OFSwitch13Controller::RemoteSwitch::GetRole (void) const
+{
+  return m_role;
+}
+
+uint64_t
+OFSwitch13Controller::RemoteSwitch::GetGenerationId (void) const
+{
+  return m_generationId;
 }
 
 Time
-OFSwitch13Controller::EchoInfo::GetRtt (void) const
+OFSwitch13Controller::RemoteSwitch::GetEwmaRtt (void) const
 {
-  if (m_waiting)
-    {
-      return Time (-1);
-    }
-  else
-    {
-      return m_recv - m_send;
-    }
+  return m_ewmaRtt;
 }
 
-OFSwitch13Controller::BarrierInfo::BarrierInfo (Ptr<const RemoteSwitch> swtch)
-  : m_waiting (true),
-  m_swtch (swtch)
+const std::vector<uint32_t>&
+OFSwitch13Controller::RemoteSwitch::GetRttHistogram (void) const
 {
+  return m_rttHistogram;
 }
 
 } // namespace ns3
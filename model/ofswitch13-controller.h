@@ -22,10 +22,17 @@
 #define OFSWITCH13_CONTROLLER_H
 
 #include <ns3/application.h>
+#include <ns3/event-id.h>
 #include <ns3/socket.h>
+#include <ns3/traced-callback.h>
+#include <ns3/random-variable-stream.h>
 #include "ofswitch13-interface.h"
+#include "ofswitch13-flow-shadow.h"
+#include "ofswitch13-message-view.h"
 #include "ofswitch13-socket-handler.h"
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 
@@ -73,12 +80,104 @@ public:
      */
     uint64_t GetDpId (void) const;
 
+    /**
+     * Get the mirror of flow entries, groups, and meters installed into this
+     * switch by the controller.
+     * \return The flow shadow, or 0 when the FlowShadow attribute is false.
+     */
+    Ptr<const OFSwitch13FlowShadow> GetFlowShadow (void) const;
+
+    /**
+     * Check the congestion state of the control channel to this switch.
+     * \return True when the channel is congested.
+     */
+    bool IsCongested (void) const;
+
+    /**
+     * Get the number of auxiliary connections established by this switch.
+     * \return The number of auxiliary connections.
+     */
+    uint32_t GetNAuxiliaryConnections (void) const;
+
+    /**
+     * Get the role of this controller over the switch, as confirmed by the
+     * last role reply.
+     * \return The controller role.
+     */
+    enum ofp_controller_role GetRole (void) const;
+
+    /**
+     * Get the last generation id known for this switch.
+     * \return The generation id.
+     */
+    uint64_t GetGenerationId (void) const;
+
+    /**
+     * Get the control channel RTT measured by the echo monitor.
+     * \return The EWMA RTT, or zero when no samples are available.
+     */
+    Time GetEwmaRtt (void) const;
+
+    /**
+     * Get the control channel RTT histogram measured by the echo monitor.
+     * The bin width is given by the controller RttBinWidth attribute.
+     * \return The sample count for each bin.
+     */
+    const std::vector<uint32_t>& GetRttHistogram (void) const;
+
 private:
+    /** Map saving auxiliary connection handlers by switch address */
+    typedef std::map<Address, Ptr<OFSwitch13SocketHandler> > AuxHandlerMap_t;
+
     Ptr<OFSwitch13SocketHandler>  m_handler;  //!< Socket handler.
     Address                       m_address;  //!< Switch connection address.
     Ptr<OFSwitch13Controller>     m_ctrlApp;  //!< Controller application.
     uint64_t                      m_dpId;     //!< OpenFlow datapath ID.
     enum ofp_controller_role      m_role;     //!< Controller role over switch.
+    Ptr<OFSwitch13FlowShadow>     m_shadow;   //!< Installed state mirror.
+    AuxHandlerMap_t               m_auxHandlers; //!< Auxiliary connections.
+    uint64_t                      m_generationId; //!< Role generation id.
+
+    /** Metadata for a pending role request. */
+    struct RoleRequest
+    {
+      enum ofp_controller_role  m_role;   //!< Desired role.
+      bool                      m_probe;  //!< Generation id probe request.
+    };
+
+    /** Map saving pending role requests by transaction id */
+    typedef std::map<uint32_t, RoleRequest> RoleXidMap_t;
+
+    RoleXidMap_t m_roleXids;  //!< Pending role requests.
+
+    EventId                 m_echoEvent;      //!< Next echo request.
+    uint32_t                m_echoMissed;     //!< Consecutive missed echoes.
+    Time                    m_ewmaRtt;        //!< EWMA control RTT.
+    std::vector<uint32_t>   m_rttHistogram;   //!< Control RTT histogram.
+
+    /** Last statistics counters for a single entry. */
+    struct StatsCounters
+    {
+      uint64_t  m_txBytes;    //!< Transmitted bytes.
+      uint64_t  m_txPackets;  //!< Transmitted packets.
+      uint64_t  m_rxBytes;    //!< Received bytes.
+      uint64_t  m_rxPackets;  //!< Received packets.
+      Time      m_time;       //!< Sample time.
+      uint32_t  m_xid;        //!< Transaction id of the sample.
+    };
+
+    /** Hash map saving statistics counters by entry key */
+    typedef std::unordered_map<std::string, StatsCounters> StatsCountersMap_t;
+
+    /** Map saving pending statistics request xid by multipart type */
+    typedef std::map<uint16_t, uint32_t> StatsXidMap_t;
+
+    /** Map saving the next statistics request event by multipart type */
+    typedef std::map<uint16_t, EventId> StatsEventMap_t;
+
+    StatsXidMap_t m_statsXids;  //!< Pending statistics requests.
+    StatsEventMap_t m_statsEvents;  //!< Next statistics requests.
+    std::map<uint16_t, StatsCountersMap_t> m_statsCounters; //!< Counters.
 
     /**
      * Switch features informed to the controller during handshake procedure.
@@ -92,55 +191,95 @@ private:
 
   };  // class RemoteSwitch
 
+  /** Completion status of a transaction. */
+  enum TransactionStatus
+  {
+    TRANSACTION_DONE,     //!< All replies received.
+    TRANSACTION_ERROR,    //!< Error message received.
+    TRANSACTION_TIMEOUT,  //!< No reply before the timeout.
+    TRANSACTION_CLOSED    //!< Connection to the switch closed.
+  };
+
+  /** List of OpenFlow messages in wire format. */
+  typedef std::vector<std::vector<uint8_t> > MessageList_t;
+
   /**
    * \ingroup ofswitch13
-   * Structure to save echo request metadata used by the controller interface.
+   * Structure handed to the completion callback of a request-reply exchange.
+   * The reply list holds, in order, all parts of a multipart reply, the
+   * single reply for other requests, or the error messages received for the
+   * request (for batches, the errors for any message in the batch). The list
+   * is empty on timeout and closed connections.
    */
-  struct EchoInfo
+  struct Transaction
   {
-    friend class OFSwitch13Controller;
-
-public:
-    /**
-     * Complete constructor, with remote switch.
-     * \param swtch The remote switch.
-     */
-    EchoInfo (Ptr<const RemoteSwitch> swtch);
+    uint32_t                m_xid;      //!< Request transaction id.
+    Ptr<const RemoteSwitch> m_swtch;    //!< Remote switch.
+    TransactionStatus       m_status;   //!< Completion status.
+    Time                    m_start;    //!< Request send time.
+    MessageList_t           m_replies;  //!< Replies in wire format.
+  };
 
-    /**
-     * Compute the echo RTT time.
-     * \return the RTT time.
-     */
-    Time GetRtt (void) const;
+  /** Transaction completion callback. */
+  typedef Callback<void, const Transaction&> TransactionCallback;
 
-private:
-    bool                    m_waiting;    //!< True when waiting for reply.
-    Time                    m_send;       //!< Send time.
-    Time                    m_recv;       //!< Received time.
-    Ptr<const RemoteSwitch> m_swtch;      //!< Remote switch.
+public:
+  /**
+   * Rates computed from two consecutive statistics samples of the same entry,
+   * collected by the periodic statistics polling. The entry ID and the
+   * meaning of the rates depend on the multipart type:
+   * - OFPMP_FLOW: the flow cookie, with tx rates from flow counters;
+   * - OFPMP_PORT_STATS: the port number, with tx and rx rates;
+   * - OFPMP_QUEUE: the port number (high 32 bits) and queue id (low 32 bits),
+   *   with tx rates;
+   * - OFPMP_METER: the meter id, with rx rates from meter input counters;
+   * - OFPMP_TABLE: the table id, with tx packet rate from matched packets and
+   *   rx packet rate from looked up packets.
+   */
+  struct StatsRate
+  {
+    uint64_t  m_dpId;       //!< OpenFlow datapath ID.
+    uint16_t  m_type;       //!< Multipart type (one of OFPMP_*).
+    uint64_t  m_id;         //!< Entry ID.
+    uint8_t   m_tableId;    //!< Table id (only for flows).
+    uint16_t  m_priority;   //!< Priority (only for flows).
+    Time      m_interval;   //!< Interval between samples.
+    double    m_txBps;      //!< Transmitted bits per second.
+    double    m_txPps;      //!< Transmitted packets per second.
+    double    m_rxBps;      //!< Received bits per second.
+    double    m_rxPps;      //!< Received packets per second.
   };
 
   /**
-   * \ingroup ofswitch13
-   * Structure to save barrier metadata used by the controller interface.
+   * TracedCallback signature for statistics rates.
+   * \param rate The statistics rate.
    */
-  struct BarrierInfo
-  {
-    friend class OFSwitch13Controller;
+  typedef void (*StatsRateTracedCallback)(const StatsRate &rate);
 
-public:
-    /**
-     * Complete constructor, with remote switch.
-     * \param swtch The remote switch.
-     */
-    BarrierInfo (Ptr<const RemoteSwitch> swtch);
+  /**
+   * TracedCallback signature for controller role changes.
+   * \param dpId The OpenFlow datapath ID.
+   * \param role The new controller role (one of OFPCR_ROLE_*).
+   */
+  typedef void (*RoleTracedCallback)(uint64_t dpId, uint32_t role);
 
-private:
-    bool                    m_waiting;    //!< True when waiting for reply.
-    Ptr<const RemoteSwitch> m_swtch;      //!< Remote switch.
-  };
+  /**
+   * TracedCallback signature for switch connection and disconnection.
+   * \param dpId The OpenFlow datapath ID.
+   * \param connected True after the handshake, false when disconnected.
+   */
+  typedef void (*SwitchConnectionTracedCallback)(uint64_t dpId,
+                                                 bool connected);
+
+  /**
+   * TracedCallback signature for echo RTT samples.
+   * \param dpId The OpenFlow datapath ID.
+   * \param rtt The RTT sample.
+   * \param ewmaRtt The updated EWMA RTT.
+   */
+  typedef void (*EchoRttTracedCallback)(uint64_t dpId, Time rtt,
+                                        Time ewmaRtt);
 
-public:
   OFSwitch13Controller ();          //!< Default constructor
   virtual ~OFSwitch13Controller (); //!< Dummy destructor, see DoDispose.
 
@@ -180,6 +319,38 @@ public:
    */
   int DpctlSchedule (uint64_t dpId, const std::string textCmd);
 
+  /**
+   * Request a new controller role over the remote switch. Master requests
+   * use a new generation id, greater than the last one known for the switch.
+   * When the switch rejects the request with a stale generation id, the
+   * controller queries the current generation id (with a no-change role
+   * request) and retries the request with a greater one.
+   * \param swtch The target remote switch.
+   * \param role The requested role (one of OFPCR_ROLE_*).
+   * \return 0 if everything's ok, otherwise an error number.
+   */
+  int RequestRole (Ptr<const RemoteSwitch> swtch,
+                   enum ofp_controller_role role);
+
+  /**
+   * Request a new controller role over the remote switch.
+   * \param dpId The OpenFlow datapath ID.
+   * \param role The requested role (one of OFPCR_ROLE_*).
+   * \return 0 if everything's ok, otherwise an error number.
+   */
+  int RequestRole (uint64_t dpId, enum ofp_controller_role role);
+
+  /**
+   * Accept a switch connection over an in-process direct channel, bypassing
+   * the TCP/IP stack. The remote switch is registered just as for TCP
+   * connections accepted by the listening socket.
+   * \param handler The controller end of the direct channel.
+   * \param swAddr The switch address at the other end of the channel.
+   * \see OFSwitch13DirectChannel
+   */
+  void AcceptDirectConnection (Ptr<OFSwitch13SocketHandler> handler,
+                               Address swAddr);
+
   /**
    * Overriding ofsoftswitch13 dpctl_send_and_print  and
    * dpctl_transact_and_print weak functions from utilities/dpctl.c. Send a
@@ -211,6 +382,17 @@ protected:
    */
   virtual void HandshakeSuccessful (Ptr<const RemoteSwitch> swtch);
 
+  /**
+   * Function invoked when the congestion state of the control channel to a
+   * remote switch changes. Derived classes can override this function to
+   * throttle the messages sent to the switch (i.e., deferring flow-mods)
+   * while the channel is congested.
+   * \param swtch The remote switch.
+   * \param congested True when the channel becomes congested.
+   */
+  virtual void ChannelCongestion (Ptr<const RemoteSwitch> swtch,
+                                  bool congested);
+
   /**
    * Get the remote switch for this OpenFlow datapath ID.
    * \param dpId The OpenFlow datapath ID.
@@ -228,6 +410,18 @@ protected:
   int SendToSwitch (Ptr<const RemoteSwitch> swtch, struct ofl_msg_header *msg,
                     uint32_t xid = 0);
 
+  /**
+   * Send a pre-packed message template to a registered switch. Only the
+   * transaction id is patched into the template before sending, so the same
+   * template can be reused for repetitive messages without packing them again.
+   * \param swtch The remote switch to receive the message.
+   * \param tmpl The message template to send.
+   * \param xid The transaction id to use.
+   * \return 0 if everything's ok, otherwise an error number.
+   */
+  int SendToSwitch (Ptr<const RemoteSwitch> swtch,
+                    Ptr<ofs::MessageTemplate> tmpl, uint32_t xid = 0);
+
   /**
    * Send an echo request message to switch, and wait for a non-blocking reply.
    * \param swtch The remote switch to receive the message.
@@ -244,6 +438,103 @@ protected:
    */
   void SendBarrierRequest (Ptr<const RemoteSwitch> swtch);
 
+  /**
+   * \name Transactions
+   * Send a request to the switch and invoke the callback when the reply
+   * arrives, without blocking nor serializing requests. Replies are matched
+   * by transaction id and consumed by the transaction, so they don't reach
+   * the message handlers. Parts of multipart replies are collected until the
+   * last one. Requests without replies (e.g., flow-mods) can only complete
+   * with errors or timeouts, so use DpctlBatch () for them.
+   * \param swtch The target remote switch.
+   * \param msg The OFLib request message.
+   * \param tmpl The pre-packed request message.
+   * \param textCmd The dpctl command that sends a single request.
+   * \param cmds The list of dpctl commands in the batch.
+   * \param cb The completion callback.
+   * \param timeout The transaction timeout (zero for the TransactionTimeout
+   *        attribute value).
+   * \return The transaction id, or 0 when the request was not sent.
+   */
+  //\{
+  uint32_t SendRequest (Ptr<const RemoteSwitch> swtch,
+                        struct ofl_msg_header *msg, TransactionCallback cb,
+                        Time timeout = Time (0));
+  uint32_t SendRequest (Ptr<const RemoteSwitch> swtch,
+                        Ptr<ofs::MessageTemplate> tmpl, TransactionCallback cb,
+                        Time timeout = Time (0));
+  uint32_t DpctlRequest (Ptr<const RemoteSwitch> swtch,
+                         const std::string textCmd, TransactionCallback cb,
+                         Time timeout = Time (0));
+
+  /**
+   * Execute the batch of dpctl commands followed by a barrier request. As the
+   * switch processes messages in order, the callback is invoked after all
+   * the messages in the batch were applied, with the error status when any
+   * of them failed.
+   */
+  uint32_t DpctlBatch (Ptr<const RemoteSwitch> swtch,
+                       const std::vector<std::string> &cmds,
+                       TransactionCallback cb, Time timeout = Time (0));
+  //\}
+
+  /**
+   * Send an OFSwitch13 rate statistics request (an OFPMP_EXPERIMENTER
+   * multipart request with the OFS13_EXPERIMENTER_ID) as a transaction. Use
+   * the ofs::MultipartReplyView rate statistics accessors to read the entries
+   * from the replies handed to the callback.
+   * \param swtch The target remote switch.
+   * \param cb The completion callback.
+   * \param portNo The port number, or OFPP_ANY for all ports.
+   * \param timeout The transaction timeout (zero for the TransactionTimeout
+   *        attribute value).
+   * \return The transaction id, or 0 when the request was not sent.
+   */
+  uint32_t RateStatsRequest (Ptr<const RemoteSwitch> swtch,
+                             TransactionCallback cb, uint32_t portNo = OFPP_ANY,
+                             Time timeout = Time (0));
+
+  /**
+   * Cancel a pending transaction, so its callback will not be invoked.
+   * \param xid The transaction id.
+   * \return True if the transaction was pending.
+   */
+  bool CancelTransaction (uint32_t xid);
+
+  /**
+   * Check for a pending transaction.
+   * \param xid The transaction id.
+   * \return True if the transaction is pending.
+   */
+  bool IsTransactionPending (uint32_t xid) const;
+
+  /**
+   * Reconcile the flow entries, groups, and meters installed into the switch
+   * with the desired state. The desired state is described by a list of
+   * dpctl flow-mod, group-mod, and meter-mod commands (just like the ones used
+   * with DpctlExecute), which are compared against the controller-side mirror
+   * of the switch state. Only the minimal set of add, modify, and delete
+   * messages are sent to the switch. Any flow entry, group, or meter not
+   * described in the desired state is removed from the switch. Flow entries
+   * with an idle timeout but without the OFPFF_SEND_FLOW_REM flag may have
+   * silently expired, so they are always reinstalled. Modifications rejected
+   * by the switch with an error message are undone in the mirror.
+   * \attention Only available when the FlowShadow attribute is true.
+   * \param swtch The target remote switch.
+   * \param desired The list of dpctl commands describing the desired state.
+   * \return The number of messages sent to the switch.
+   */
+  uint32_t Reconcile (Ptr<const RemoteSwitch> swtch,
+                      const std::vector<std::string> &desired);
+
+  /**
+   * Reconcile the switch state with the desired state.
+   * \param dpId The OpenFlow datapath ID.
+   * \param desired The list of dpctl commands describing the desired state.
+   * \return The number of messages sent to the switch.
+   */
+  uint32_t Reconcile (uint64_t dpId, const std::vector<std::string> &desired);
+
   /**
    * \name OpenFlow message handlers
    * Handlers used by HandleSwitchMsg to process each type of OpenFlow message
@@ -320,6 +611,34 @@ protected:
     uint32_t xid);
   //\}
 
+  /**
+   * \name OpenFlow message view handlers
+   * Fast-path handlers invoked for the most frequent messages received from
+   * the switch before they are decoded into ofl_* structures. The read-only
+   * view gives direct access to the message fields in wire format, avoiding
+   * the memory allocations performed by ofl_msg_unpack (). When the handler
+   * returns true, the message is considered consumed and it won't be sent to
+   * the regular handler. The default implementation returns false, so the
+   * message is decoded and sent to the regular handler.
+   * \attention The view is only valid during the handler execution.
+   * \param view The read-only message view.
+   * \param swtch The remote switch metadata.
+   * \return true if the message was handled, false otherwise.
+   */
+  //\{
+  virtual bool HandlePacketInView (
+    const ofs::PacketInView &view, Ptr<const RemoteSwitch> swtch);
+
+  virtual bool HandleFlowRemovedView (
+    const ofs::FlowRemovedView &view, Ptr<const RemoteSwitch> swtch);
+
+  virtual bool HandlePortStatusView (
+    const ofs::PortStatusView &view, Ptr<const RemoteSwitch> swtch);
+
+  virtual bool HandleMultipartReplyView (
+    const ofs::MultipartReplyView &view, Ptr<const RemoteSwitch> swtch);
+  //\}
+
 private:
   /**
    * Called when an OpenFlow message is received from a switch.
@@ -333,19 +652,197 @@ private:
                            uint32_t xid);
 
   /**
-   * Receive an OpenFlow packet from switch.
-   * \param packet The packet with the OpenFlow message.
-   * \param from The packet sender address.
+   * Called when an OpenFlow message is received from a switch, before
+   * decoding it. Dispatches the message view to the appropriate fast-path
+   * handler function, when available for this message type.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \param swtch The remote switch the message was received from.
+   * \return true if the message was handled, false otherwise.
+   */
+  bool HandleSwitchMsgView (const uint8_t *data, size_t size,
+                            Ptr<RemoteSwitch> swtch);
+
+  /**
+   * Save a pending transaction and start its timeout.
+   * \param swtch The remote switch.
+   * \param xid The transaction id.
+   * \param cb The completion callback.
+   * \param timeout The transaction timeout.
+   */
+  void TransactionStart (Ptr<const RemoteSwitch> swtch, uint32_t xid,
+                         TransactionCallback cb, Time timeout);
+
+  /**
+   * Collect a message received from the switch when it is a reply for a
+   * pending transaction, completing the transaction after the last reply.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \param swtch The remote switch.
+   * \return true if the message was consumed by a transaction.
+   */
+  bool TransactionReply (const uint8_t *data, size_t size,
+                         Ptr<RemoteSwitch> swtch);
+
+  /**
+   * Remove a pending transaction and invoke its callback.
+   * \param xid The transaction id.
+   * \param status The completion status.
+   */
+  void TransactionDone (uint32_t xid, TransactionStatus status);
+
+  /**
+   * Complete all pending transactions for a switch.
+   * \param swtch The remote switch.
+   * \param status The completion status.
+   */
+  void TransactionDoneAll (Ptr<const RemoteSwitch> swtch,
+                           TransactionStatus status);
+
+  /**
+   * \name Internal completion callbacks for echo and barrier requests.
+   * \param txn The completed transaction.
+   */
+  //\{
+  void EchoDone    (const Transaction &txn);
+  void BarrierDone (const Transaction &txn);
+  //\}
+
+  /**
+   * \name Periodic statistics polling
+   * Methods used to periodically request statistics from switches and to
+   * compute the rates from multipart replies, without unpacking them.
+   */
+  //\{
+  /**
+   * Start the polling for all enabled statistics types. The first request is
+   * uniformly distributed over the polling interval, avoiding synchronized
+   * request bursts when several switches connect at the same time.
+   * \param swtch The remote switch.
+   */
+  void StatsStart (Ptr<RemoteSwitch> swtch);
+
+  /**
+   * Send a statistics request to the switch as a transaction, with the
+   * polling interval as timeout, and schedule the next one. When the
+   * previous request for this type is still pending, this round is skipped
+   * to bound the polling overhead.
+   * \param swtch The remote switch.
+   * \param type The multipart type.
+   */
+  void StatsPoll (Ptr<RemoteSwitch> swtch, uint16_t type);
+
+  /**
+   * Complete a polling request, processing all parts of the multipart reply
+   * and removing the counters for entries that were not reported. Requests
+   * completed with errors or timeouts are just released.
+   * \param txn The completed transaction.
+   */
+  void StatsPollDone (const Transaction &txn);
+
+  /**
+   * Process a single part of the multipart reply for a polling request.
+   * \param view The multipart reply view.
+   * \param swtch The remote switch.
+   */
+  void StatsReply (const ofs::MultipartReplyView &view,
+                   Ptr<RemoteSwitch> swtch);
+
+  /**
+   * Update the counters for a single entry and fire the rate trace source.
+   * \param swtch The remote switch.
+   * \param rate The rate with entry identification fields already set.
+   * \param key The entry key.
+   * \param xid The transaction id of this sample.
+   * \param txBytes The transmitted bytes.
+   * \param txPackets The transmitted packets.
+   * \param rxBytes The received bytes.
+   * \param rxPackets The received packets.
+   */
+  void StatsUpdate (Ptr<RemoteSwitch> swtch, StatsRate &rate,
+                    const std::string &key, uint32_t xid, uint64_t txBytes,
+                    uint64_t txPackets, uint64_t rxBytes, uint64_t rxPackets);
+
+  /**
+   * \param type The multipart type.
+   * \return The polling interval for this type (zero when disabled).
+   */
+  Time GetStatsInterval (uint16_t type) const;
+
+  /**
+   * \param type The multipart type.
+   * \return The pre-packed request for this type.
+   */
+  Ptr<ofs::MessageTemplate> GetStatsTemplate (uint16_t type);
+  //\}
+
+  /**
+   * Receive an OpenFlow message from switch.
+   * \param data The message in wire format (a slice of the socket handler
+   *        receive buffer).
+   * \param size The message size.
+   * \param from The message sender address.
    */
-  void ReceiveFromSwitch (Ptr<Packet> packet, Address from);
+  void ReceiveFromSwitch (uint8_t *data, size_t size, Address from);
 
   /**
    * Get the remote switch for this address.
    * \param address The socket address.
-   * \return The remote switch.
+   * \return The remote switch, or 0 if this address is not registered.
    */
   Ptr<RemoteSwitch> GetRemoteSwitch (Address address);
 
+  /**
+   * Remove the remote switch associated with this socket from the internal
+   * maps, so it can't be found anymore by address or datapath ID. The
+   * connection is identified by the addresses saved in the remote switch
+   * metadata, as the peer address is not available on closed sockets.
+   * \param socket The connection socket.
+   */
+  void UnregisterSwitch (Ptr<Socket> socket);
+
+  /**
+   * Remove the remote switch associated with this direct channel handler
+   * from the internal maps.
+   * \param handler The socket handler of the main connection.
+   */
+  void UnregisterSwitch (Ptr<OFSwitch13SocketHandler> handler);
+
+  /**
+   * Remove the remote switch connected from this address from the internal
+   * maps, completing its pending transactions.
+   * \param address The switch address.
+   */
+  void UnregisterSwitch (Address address);
+
+  /**
+   * \name Echo monitor
+   * Methods used to periodically send echo requests to the switch, measuring
+   * the control channel RTT and detecting dead connections.
+   */
+  //\{
+  /**
+   * Send an echo request to the switch and schedule the next one.
+   * \param swtch The remote switch.
+   */
+  void EchoPoll (Ptr<RemoteSwitch> swtch);
+
+  /**
+   * Update RTT statistics or count a missed reply, closing the connection
+   * after too many consecutive missed replies.
+   * \param txn The completed echo transaction.
+   */
+  void EchoPollDone (const Transaction &txn);
+  //\}
+
+  /**
+   * Create the remote switch for a new connection and send the OpenFlow Hello
+   * message to start the handshake procedure.
+   * \param handler The socket handler for this connection.
+   * \param from The switch address.
+   */
+  void RegisterSwitch (Ptr<OFSwitch13SocketHandler> handler, Address from);
+
   /**
    * \name Socket callbacks
    * Handlers used as socket callbacks to TCP communication between this
@@ -367,11 +864,64 @@ private:
   void SocketPeerError  (Ptr<Socket> socket);
   //\}
 
-  /** Map to store echo information by transaction id */
-  typedef std::map <uint32_t, EchoInfo> EchoMsgMap_t;
+  /**
+   * Socket handler callback fired when a direct channel connection is
+   * closed by any of its ends.
+   * \param handler The socket handler of the closed connection.
+   */
+  void DirectPeerClose (Ptr<OFSwitch13SocketHandler> handler);
+
+  /**
+   * Socket handler callback fired when the control channel congestion state
+   * changes.
+   * \param congested The congestion state.
+   * \param from The switch address.
+   */
+  void SocketCongestion (bool congested, Address from);
+
+  /**
+   * Send a role request message to the switch.
+   * \param swtch The remote switch.
+   * \param role The desired role.
+   * \param probe True to query the current generation id only.
+   * \return 0 if everything's ok, otherwise an error number.
+   */
+  int SendRoleRequest (Ptr<RemoteSwitch> swtch, enum ofp_controller_role role,
+                       bool probe);
 
-  /** Map to store barrier information by transaction id */
-  typedef std::map <uint32_t, BarrierInfo> BarrierMsgMap_t;
+  /**
+   * Update the controller role and generation id from a role reply,
+   * retrying the pending request after a generation id probe.
+   * \param msg The role reply message.
+   * \param swtch The remote switch.
+   * \param xid The transaction id.
+   */
+  void RoleReply (struct ofl_msg_role_request *msg, Ptr<RemoteSwitch> swtch,
+                  uint32_t xid);
+
+  /**
+   * Handle a role request failed error, probing the switch for the current
+   * generation id when the request was stale.
+   * \param msg The error message.
+   * \param swtch The remote switch.
+   * \param xid The transaction id.
+   */
+  void RoleError (struct ofl_msg_error *msg, Ptr<RemoteSwitch> swtch,
+                  uint32_t xid);
+
+  /** Metadata for a pending transaction. */
+  struct PendingTransaction
+  {
+    Transaction         m_txn;        //!< Transaction handed to callback.
+    TransactionCallback m_callback;   //!< Completion callback.
+    EventId             m_timeout;    //!< Timeout event.
+    bool                m_batch;      //!< Barrier-scoped batch.
+    uint32_t            m_firstXid;   //!< First xid in the batch.
+    uint32_t            m_lastXid;    //!< Last xid in the batch.
+  };
+
+  /** Map saving pending transactions by transaction id */
+  typedef std::map <uint32_t, PendingTransaction> TransactionMap_t;
 
   /** Multimap saving pair <datapath id / dpctl commands> */
   typedef std::multimap <uint64_t, std::string> DpIdCmdMap_t;
@@ -379,14 +929,54 @@ private:
   /** Map to store switch info by Address */
   typedef std::map <Address, Ptr<RemoteSwitch> > SwitchsMap_t;
 
+  /** Hash map to index switch info by datapath ID */
+  typedef std::unordered_map <uint64_t, Ptr<RemoteSwitch> > DpIdSwitchMap_t;
+
   uint32_t        m_xid;              //!< Global transaction idx.
   uint16_t        m_port;             //!< Local controller tcp port.
   Ptr<Socket>     m_serverSocket;     //!< Listening server socket.
 
-  EchoMsgMap_t    m_echoMap;          //!< Metadata for echo requests.
-  BarrierMsgMap_t m_barrierMap;       //!< Metadata for barrier requests.
+  TransactionMap_t m_transactions;    //!< Pending transactions.
+  Time            m_txnTimeout;       //!< Default transaction timeout.
   DpIdCmdMap_t    m_schedCommands;    //!< Scheduled commands for execution.
   SwitchsMap_t    m_switchesMap;      //!< Registered switches metadata's.
+  DpIdSwitchMap_t m_dpIdMap;          //!< Switches indexed by datapath ID.
+
+  Ptr<ofs::MessageTemplate> m_echoTemplate;    //!< Empty echo request.
+  Ptr<ofs::MessageTemplate> m_barrierTemplate; //!< Barrier request.
+
+  bool                      m_shadowEnabled;   //!< Mirror switch state.
+  Ptr<OFSwitch13FlowShadow> m_desiredShadow;   //!< State under reconcile.
+
+  /** Map saving pre-packed statistics requests by multipart type */
+  typedef std::map<uint16_t, Ptr<ofs::MessageTemplate> > StatsTemplateMap_t;
+
+  Time                m_flowStatsInterval;    //!< Flow stats interval.
+  Time                m_portStatsInterval;    //!< Port stats interval.
+  Time                m_queueStatsInterval;   //!< Queue stats interval.
+  Time                m_meterStatsInterval;   //!< Meter stats interval.
+  Time                m_tableStatsInterval;   //!< Table stats interval.
+  StatsTemplateMap_t  m_statsTemplates;       //!< Statistics requests.
+  Ptr<UniformRandomVariable> m_statsRng;      //!< Polling stagger.
+
+  Time                m_echoInterval;         //!< Echo monitor interval.
+  uint32_t            m_echoMissLimit;        //!< Missed echoes for dead.
+  double              m_echoAlpha;            //!< EWMA RTT alpha.
+  Time                m_rttBinWidth;          //!< RTT histogram bin width.
+
+  /** Trace source fired for each echo RTT sample. */
+  TracedCallback<uint64_t, Time, Time> m_echoRttTrace;
+
+  /** Trace source fired for each statistics rate. */
+  TracedCallback<const StatsRate&> m_statsRateTrace;
+
+  enum ofp_controller_role  m_initialRole;    //!< Role after handshake.
+
+  /** Trace source fired when the controller role over a switch changes. */
+  TracedCallback<uint64_t, uint32_t> m_roleTrace;
+
+  /** Trace source fired when a switch connects or disconnects. */
+  TracedCallback<uint64_t, bool> m_switchConnectionTrace;
 };
 
 } // namespace ns3
@@ -25,8 +25,13 @@
       std::clog << "[dp " << m_dpId << "] ";  \
     }
 
+#include <ns3/double.h>
+#include <ns3/pointer.h>
+#include <ns3/hash.h>
 #include <ns3/object-vector.h>
 #include "ofswitch13-device.h"
+#include "ofswitch13-message-view.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -46,12 +51,40 @@ OFSwitch13Device::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName ("OFSwitch13")
     .AddConstructor<OFSwitch13Device> ()
+    .AddAttribute ("AuxiliaryConnections",
+                   "The number of auxiliary TCP connections opened to each "
+                   "controller in addition to the main connection.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&OFSwitch13Device::m_nAuxConns),
+                   MakeUintegerChecker<uint8_t> ())
     .AddAttribute ("DatapathId",
                    "The unique identification of this OpenFlow switch.",
                    TypeId::ATTR_GET,
                    UintegerValue (0),
                    MakeUintegerAccessor (&OFSwitch13Device::m_dpId),
                    MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("EchoInterval",
+                   "Interval between echo requests sent by the echo "
+                   "monitor to each controller (zero to disable).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (&OFSwitch13Device::m_echoInterval),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("EchoMissLimit",
+                   "Number of consecutive missed echo replies before "
+                   "closing the connection to the controller.",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&OFSwitch13Device::m_echoMissLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("EchoRttAlpha",
+                   "The EWMA alpha parameter for averaging the echo RTT.",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&OFSwitch13Device::m_echoAlpha),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("RttBinWidth",
+                   "The bin width for the echo RTT histogram.",
+                   TimeValue (MicroSeconds (100)),
+                   MakeTimeAccessor (&OFSwitch13Device::m_rttBinWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
     .AddAttribute ("FlowTableSize",
                    "The maximum number of entries allowed on each flow table.",
                    TypeId::ATTR_GET | TypeId::ATTR_CONSTRUCT,
@@ -86,6 +119,38 @@ OFSwitch13Device::GetTypeId (void)
                    ObjectVectorValue (),
                    MakeObjectVectorAccessor (&OFSwitch13Device::m_ports),
                    MakeObjectVectorChecker<OFSwitch13Port> ())
+    .AddAttribute ("ReconnectDelay",
+                   "The initial delay before reconnecting to a controller "
+                   "after a failed or closed connection, doubled on each "
+                   "attempt (zero to disable reconnection).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (&OFSwitch13Device::m_retryDelay),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("ReconnectMaxDelay",
+                   "The maximum delay between reconnection attempts.",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&OFSwitch13Device::m_retryMax),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("SharedBuffer",
+                   "The shared packet buffer pool for port queues.",
+                   TypeId::ATTR_GET,
+                   PointerValue (),
+                   MakePointerAccessor (&OFSwitch13Device::m_sharedBuffer),
+                   MakePointerChecker<OFSwitch13SharedBuffer> ())
+    .AddAttribute ("SharedBufferAlpha",
+                   "The dynamic threshold alpha parameter for the shared "
+                   "buffer admission.",
+                   TypeId::ATTR_GET | TypeId::ATTR_CONSTRUCT,
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&OFSwitch13Device::m_sharedAlpha),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("SharedBufferSize",
+                   "The shared packet buffer size in bytes for all port "
+                   "queues (zero to disable the shared buffer).",
+                   TypeId::ATTR_GET | TypeId::ATTR_CONSTRUCT,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&OFSwitch13Device::m_sharedSize),
+                   MakeUintegerChecker<uint32_t> ())
     .AddAttribute ("TcamDelay",
                    "Average time to perform a TCAM operation in pipeline.",
                    TimeValue (MicroSeconds (20)),
@@ -127,6 +192,30 @@ OFSwitch13Device::GetTypeId (void)
                      MakeTraceSourceAccessor (
                        &OFSwitch13Device::m_pipePacketTrace),
                      "ns3::Packet::TracedCallback")
+    .AddTraceSource ("PacketInDrop",
+                     "Trace source indicating a packet-in dropped by "
+                     "control channel congestion.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Device::m_packetInDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("ControllerConnection",
+                     "Trace source indicating a controller connection is "
+                     "established or released.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Device::m_ctrlConnectionTrace),
+                     "ns3::OFSwitch13Device::ConnectionTracedCallback")
+    .AddTraceSource ("EchoRtt",
+                     "Trace source indicating a new echo RTT sample.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Device::m_echoRttTrace),
+                     "ns3::OFSwitch13Device::EchoRttTracedCallback")
+    .AddTraceSource ("FlowSetupLatency",
+                     "Trace source indicating a packet-in buffered packet "
+                     "released by the controller, with the flow setup "
+                     "latency breakdown.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Device::m_flowSetupTrace),
+                     "ns3::OFSwitch13Device::FlowSetupTracedCallback")
     .AddTraceSource ("DatapathTimeout",
                      "Trace source indicating a datapath timeout operation.",
                      MakeTraceSourceAccessor (
@@ -175,6 +264,8 @@ OFSwitch13Device::GetTypeId (void)
 
 OFSwitch13Device::OFSwitch13Device ()
   : m_dpId (0),
+  m_echoXid (0),
+  m_rxSender (0),
   m_pipeTokens (0),
   m_pipeConsumed (0),
   m_cFlowMod (0),
@@ -313,6 +404,26 @@ OFSwitch13Device::GetSumFlowEntries (void) const
   return m_sumFlowEntries;
 }
 
+Ptr<OFSwitch13SharedBuffer>
+OFSwitch13Device::GetSharedBuffer (void) const
+{
+  return m_sharedBuffer;
+}
+
+int64_t
+OFSwitch13Device::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  int64_t currentStream = stream;
+  PortList_t::iterator it;
+  for (it = m_ports.begin (); it != m_ports.end (); it++)
+    {
+      currentStream += (*it)->AssignStreams (currentStream);
+    }
+  return (currentStream - stream);
+}
+
 Ptr<OFSwitch13Port>
 OFSwitch13Device::AddSwitchPort (Ptr<NetDevice> portDevice)
 {
@@ -354,7 +465,7 @@ OFSwitch13Device::ReceiveFromSwitchPort (Ptr<Packet> packet, uint32_t portNo,
   m_pipeConsumed += pktSizeBits;
   m_pipePacketTrace (packet);
   Simulator::Schedule (m_pipeDelay, &OFSwitch13Device::SendToPipeline,
-                       this, packet, portNo, tunnelId);
+                       this, packet, portNo, tunnelId, Simulator::Now ());
 }
 
 void
@@ -368,35 +479,56 @@ OFSwitch13Device::StartControllerConnection (Address ctrlAddr)
   NS_ASSERT_MSG (!GetRemoteController (ctrlAddr),
                  "Controller address already in use.");
 
-  // Start a TCP connection to this target controller.
-  int error = 0;
-  TypeId tcpFact = TypeId::LookupByName ("ns3::TcpSocketFactory");
-  Ptr<Socket> ctrlSocket = Socket::CreateSocket (GetObject<Node> (), tcpFact);
-  ctrlSocket->SetAttribute ("SegmentSize", UintegerValue (8900));
+  // Create a RemoteController object for this controller and save it.
+  Ptr<RemoteController> remoteCtrl = Create<RemoteController> ();
+  remoteCtrl->m_address = ctrlAddr;
+  m_controllers.push_back (remoteCtrl);
+  ConnectController (remoteCtrl);
+}
 
-  error = ctrlSocket->Bind ();
-  if (error)
+Time
+OFSwitch13Device::GetEwmaRtt (Address ctrlAddr) const
+{
+  CtrlList_t::const_iterator it;
+  for (it = m_controllers.begin (); it != m_controllers.end (); it++)
     {
-      NS_LOG_ERROR ("Error binding socket " << error);
-      return;
+      if ((*it)->m_address == ctrlAddr)
+        {
+          return (*it)->m_ewmaRtt;
+        }
     }
+  return Time (0);
+}
 
-  error = ctrlSocket->Connect (InetSocketAddress::ConvertFrom (ctrlAddr));
-  if (error)
+std::vector<uint32_t>
+OFSwitch13Device::GetRttHistogram (Address ctrlAddr) const
+{
+  CtrlList_t::const_iterator it;
+  for (it = m_controllers.begin (); it != m_controllers.end (); it++)
     {
-      NS_LOG_ERROR ("Error connecting socket " << error);
-      return;
+      if ((*it)->m_address == ctrlAddr)
+        {
+          return (*it)->m_rttHistogram;
+        }
     }
+  return std::vector<uint32_t> ();
+}
 
-  ctrlSocket->SetConnectCallback (
-    MakeCallback (&OFSwitch13Device::SocketCtrlSucceeded, this),
-    MakeCallback (&OFSwitch13Device::SocketCtrlFailed, this));
+void
+OFSwitch13Device::StartDirectConnection (Ptr<OFSwitch13SocketHandler> handler,
+                                         Address ctrlAddr)
+{
+  NS_LOG_FUNCTION (this << handler << ctrlAddr);
 
-  // Create a RemoteController object for this controller and save it.
+  NS_ASSERT_MSG (!GetRemoteController (ctrlAddr),
+                 "Controller address already in use.");
+
+  // There's no connection handshake over direct channels, so the controller
+  // is ready to exchange messages right away.
   Ptr<RemoteController> remoteCtrl = Create<RemoteController> ();
   remoteCtrl->m_address = ctrlAddr;
-  remoteCtrl->m_socket = ctrlSocket;
   m_controllers.push_back (remoteCtrl);
+  ControllerConnected (remoteCtrl, handler);
 }
 
 // ofsoftswitch13 overriding and callback functions.
@@ -417,7 +549,8 @@ OFSwitch13Device::SendOpenflowBufferToRemote (struct ofpbuf *buffer,
   Ptr<OFSwitch13Device> dev = OFSwitch13Device::GetDevice (remote->dp->id);
   Ptr<Packet> packet = ofs::PacketFromBuffer (buffer);
   Ptr<RemoteController> remoteCtrl = dev->GetRemoteController (remote);
-  return dev->SendToController (packet, remoteCtrl);
+  return dev->SendToController (packet, remoteCtrl,
+                                dev->SelectConnection (buffer, remote));
 }
 
 void
@@ -552,7 +685,17 @@ OFSwitch13Device::DoDispose ()
       *it = 0;
     }
   m_ports.clear ();
+  m_sharedBuffer = 0;
   m_bufferPkts.clear ();
+  m_flowSetups.clear ();
+
+  CtrlList_t::iterator ctrlIt;
+  for (ctrlIt = m_controllers.begin (); ctrlIt != m_controllers.end ();
+       ctrlIt++)
+    {
+      (*ctrlIt)->m_retryEvent.Cancel ();
+      (*ctrlIt)->m_echoEvent.Cancel ();
+    }
   m_controllers.clear ();
 
   pipeline_destroy (m_datapath->pipeline);
@@ -578,6 +721,13 @@ OFSwitch13Device::NotifyConstructionCompleted ()
   AdjustGroupTableSize (GetGroupTableSize ());
   AdjustMeterTableSize (GetMeterTableSize ());
 
+  // Create the shared buffer pool before adding ports.
+  if (m_sharedSize)
+    {
+      m_sharedBuffer = CreateObject<OFSwitch13SharedBuffer> (m_sharedSize,
+                                                            m_sharedAlpha);
+    }
+
   // Execute the first datapath timeout.
   DatapathTimeout (m_datapath);
 
@@ -757,6 +907,18 @@ OFSwitch13Device::SendPacketInMessage (struct packet *pkt, uint8_t tableId,
 {
   NS_LOG_FUNCTION (this << pkt->ns3_uid << tableId << reason);
 
+  // Throttle packet-ins while the control channels are congested. As the
+  // packet is not saved into buffer, it will be dropped by the pipeline.
+  if (IsControlChannelCongested ())
+    {
+      NS_LOG_WARN ("Control channel congested. Discarding packet-in.");
+      if (m_pipePkt.IsValid () && m_pipePkt.HasId (pkt->ns3_uid))
+        {
+          m_packetInDropTrace (m_pipePkt.GetPacket ());
+        }
+      return 0;
+    }
+
   // Create the packet_in message.
   struct ofl_msg_packet_in msg;
   msg.header.type = OFPT_PACKET_IN;
@@ -771,7 +933,19 @@ OFSwitch13Device::SendPacketInMessage (struct packet *pkt, uint8_t tableId,
   // always save the packet into buffer to avoid losing ns-3 packet id
   // reference. This is not full compliant with OpenFlow specification, but
   // works very well here.
+  FlowSetupInfo setup;
+  bool fromPort = m_pipePkt.IsValid () && m_pipePkt.HasId (pkt->ns3_uid);
+  if (fromPort)
+    {
+      setup.m_arrival = m_pipePkt.GetArrival ();
+      setup.m_packetIn = Simulator::Now ();
+    }
   dp_buffers_save (pkt->dp->buffers, pkt);
+  if (fromPort && m_bufferPkts.count (pkt->ns3_uid))
+    {
+      // Keep the timestamps of the first packet-in for this packet.
+      m_flowSetups.insert (std::make_pair (pkt->ns3_uid, setup));
+    }
   msg.buffer_id = pkt->buffer_id;
   msg.data_length = MIN (maxLength, pkt->buffer->size);
 
@@ -786,6 +960,36 @@ OFSwitch13Device::SendPacketInMessage (struct packet *pkt, uint8_t tableId,
   return dp_send_message (pkt->dp, (struct ofl_msg_header *)&msg, 0);
 }
 
+bool
+OFSwitch13Device::IsControlChannelCongested (void) const
+{
+  if (m_controllers.empty ())
+    {
+      return false;
+    }
+
+  CtrlList_t::const_iterator it;
+  for (it = m_controllers.begin (); it != m_controllers.end (); it++)
+    {
+      Ptr<RemoteController> remoteCtrl = *it;
+      if (!remoteCtrl->m_handler || !remoteCtrl->m_handler->IsCongested ())
+        {
+          return false;
+        }
+
+      // Packet-ins are spread over auxiliary connections as well.
+      for (size_t i = 0; i < remoteCtrl->m_auxHandlers.size (); i++)
+        {
+          Ptr<OFSwitch13SocketHandler> handler = remoteCtrl->m_auxHandlers [i];
+          if (handler && !handler->IsCongested ())
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
 bool
 OFSwitch13Device::SendToSwitchPort (struct packet *pkt, uint32_t portNo,
                                     uint32_t queueNo)
@@ -841,9 +1045,9 @@ OFSwitch13Device::SendToSwitchPort (struct packet *pkt, uint32_t portNo,
 
 void
 OFSwitch13Device::SendToPipeline (Ptr<Packet> packet, uint32_t portNo,
-                                  uint64_t tunnelId)
+                                  uint64_t tunnelId, Time arrival)
 {
-  NS_LOG_FUNCTION (this << packet << portNo << tunnelId);
+  NS_LOG_FUNCTION (this << packet << portNo << tunnelId << arrival);
 
   NS_ASSERT_MSG (!m_pipePkt.IsValid (), "Another packet in pipeline.");
 
@@ -858,7 +1062,7 @@ OFSwitch13Device::SendToPipeline (Ptr<Packet> packet, uint32_t portNo,
   // Save the ns-3 packet into pipeline structure. Note that we are using a
   // private packet uid to avoid conflicts with ns3::Packet uid.
   pkt->ns3_uid = OFSwitch13Device::GetNewPacketId ();
-  m_pipePkt.SetPacket (pkt->ns3_uid, packet);
+  m_pipePkt.SetPacket (pkt->ns3_uid, packet, arrival);
 
   // Send the packet to pipeline.
   pipeline_process_packet (m_datapath->pipeline, pkt);
@@ -866,38 +1070,127 @@ OFSwitch13Device::SendToPipeline (Ptr<Packet> packet, uint32_t portNo,
 
 int
 OFSwitch13Device::SendToController (Ptr<Packet> packet,
-                                    Ptr<RemoteController> remoteCtrl)
+                                    Ptr<RemoteController> remoteCtrl,
+                                    uint8_t connId)
 {
-  if (!remoteCtrl->m_socket)
+  if (!remoteCtrl->m_handler)
     {
       NS_LOG_ERROR ("No controller connection. Discarding message.");
       return -1;
     }
 
-  // TODO: No support for auxiliary connections.
+  if (connId && connId <= remoteCtrl->m_auxHandlers.size ()
+      && remoteCtrl->m_auxHandlers [connId - 1])
+    {
+      return remoteCtrl->m_auxHandlers [connId - 1]->SendMessage (packet);
+    }
   return remoteCtrl->m_handler->SendMessage (packet);
 }
 
+uint8_t
+OFSwitch13Device::SelectConnection (struct ofpbuf *buffer,
+                                    struct remote *remote)
+{
+  // Replies (and errors) go back to the connection of the request, as well
+  // as the hello message sent over a new auxiliary connection. Asynchronous
+  // messages generated while handling a request (like packet-ins from a
+  // packet-out to the table) are not replies, so they are handled below.
+  struct ofp_header *header = (struct ofp_header*)buffer->data;
+  if (m_rxSender && m_rxSender->remote == remote)
+    {
+      switch (header->type)
+        {
+        case OFPT_HELLO:
+        case OFPT_ERROR:
+        case OFPT_ECHO_REPLY:
+        case OFPT_FEATURES_REPLY:
+        case OFPT_GET_CONFIG_REPLY:
+        case OFPT_MULTIPART_REPLY:
+        case OFPT_BARRIER_REPLY:
+        case OFPT_QUEUE_GET_CONFIG_REPLY:
+        case OFPT_ROLE_REPLY:
+        case OFPT_GET_ASYNC_REPLY:
+          return m_rxSender->conn_id;
+        default:
+          break;
+        }
+    }
+
+  if (header->type != OFPT_PACKET_IN)
+    {
+      return 0;
+    }
+
+  // Hash the packet-in match, so packets from the same flow are always sent
+  // over the same auxiliary connection. When the selected connection is not
+  // established, the packet-in goes to the main connection.
+  Ptr<RemoteController> remoteCtrl = GetRemoteController (remote);
+  if (remoteCtrl->m_auxHandlers.empty ())
+    {
+      return 0;
+    }
+  struct ofp_packet_in *pktIn = (struct ofp_packet_in*)buffer->data;
+  uint32_t hash = Hash32 ((const char*)&pktIn->match,
+                          ntohs (pktIn->match.length));
+  uint8_t idx = hash % remoteCtrl->m_auxHandlers.size ();
+  return remoteCtrl->m_auxHandlers [idx] ? idx + 1 : 0;
+}
+
+void
+OFSwitch13Device::StartAuxiliaryConnections (Ptr<RemoteController> remoteCtrl)
+{
+  NS_LOG_FUNCTION (this);
+
+  TypeId tcpFact = TypeId::LookupByName ("ns3::TcpSocketFactory");
+  remoteCtrl->m_auxHandlers.resize (m_nAuxConns, 0);
+  for (uint8_t i = 0; i < m_nAuxConns; i++)
+    {
+      Ptr<Socket> auxSocket =
+        Socket::CreateSocket (GetObject<Node> (), tcpFact);
+      auxSocket->SetAttribute ("SegmentSize", UintegerValue (8900));
+      remoteCtrl->m_auxSockets.push_back (auxSocket);
+
+      int error = auxSocket->Bind ();
+      if (!error)
+        {
+          error = auxSocket->Connect (
+              InetSocketAddress::ConvertFrom (remoteCtrl->m_address));
+        }
+      if (error)
+        {
+          NS_LOG_ERROR ("Error opening auxiliary connection " << error);
+          continue;
+        }
+
+      auxSocket->SetConnectCallback (
+        MakeCallback (&OFSwitch13Device::SocketAuxSucceeded, this),
+        MakeCallback (&OFSwitch13Device::SocketAuxFailed, this));
+    }
+}
+
 void
-OFSwitch13Device::ReceiveFromController (Ptr<Packet> packet, Address from)
+OFSwitch13Device::ReceiveFromController (uint8_t *data, size_t size,
+                                         Address from, uint8_t connId)
 {
-  NS_LOG_FUNCTION (this << packet << from);
+  NS_LOG_FUNCTION (this << size << from << (uint16_t)connId);
 
   struct ofl_msg_header *msg;
   ofl_err error;
 
   Ptr<RemoteController> remoteCtrl = GetRemoteController (from);
   NS_ASSERT_MSG (remoteCtrl, "Error returning controller for this address.");
+  if (EchoReply (data, size, remoteCtrl)
+      || RateStatsReply (data, size, remoteCtrl, connId))
+    {
+      return;
+    }
 
   struct sender senderCtrl;
   senderCtrl.remote = remoteCtrl->m_remote;
-  senderCtrl.conn_id = 0; // TODO No support for auxiliary connections
+  senderCtrl.conn_id = connId;
 
-  // Get the OpenFlow buffer and unpack the message.
-  struct ofpbuf *buffer;
-  buffer = ofs::BufferFromPacket (packet, packet->GetSize ());
-  error = ofl_msg_unpack ((uint8_t*)buffer->data, buffer->size, &msg,
-                          &senderCtrl.xid, m_datapath->exp);
+  // Unpack the message directly from the socket handler receive buffer.
+  error = ofl_msg_unpack (data, size, &msg, &senderCtrl.xid, m_datapath->exp);
 
   // Check for error while unpacking the message.
   if (error)
@@ -913,13 +1206,12 @@ OFSwitch13Device::ReceiveFromController (Ptr<Packet> packet, Address from)
       // was sent and the one that was received in the version fields. So, for
       // the OFPT_HELLO message, we will check for advertised version to see if
       // it is higher than ours, in which case we can continue.
-      struct ofp_header *header = (struct ofp_header*)buffer->data;
+      struct ofp_header *header = (struct ofp_header*)data;
       if (header->type != OFPT_HELLO || header->version <= OFP_VERSION)
         {
           // This is not a hello message or the advertised version is lower
           // than OFP_VERSION. Notify the error and return.
-          ReplyWithErrorMessage (error, buffer, &senderCtrl);
-          ofpbuf_delete (buffer);
+          ReplyWithErrorMessage (error, data, size, &senderCtrl);
           return;
         }
       else
@@ -928,15 +1220,14 @@ OFSwitch13Device::ReceiveFromController (Ptr<Packet> packet, Address from)
           // change the message version to OFP_VERSION so the message can be
           // successfully unpacked and we can continue.
           header->version = OFP_VERSION;
-          error = ofl_msg_unpack ((uint8_t*)buffer->data, buffer->size, &msg,
-                                  &senderCtrl.xid, m_datapath->exp);
+          error = ofl_msg_unpack (data, size, &msg, &senderCtrl.xid,
+                                  m_datapath->exp);
 
           // Check for any other error while unpacking the message.
           if (error)
             {
               // Notify the error and return.
-              ReplyWithErrorMessage (error, buffer, &senderCtrl);
-              ofpbuf_delete (buffer);
+              ReplyWithErrorMessage (error, data, size, &senderCtrl);
               return;
             }
         }
@@ -976,8 +1267,11 @@ OFSwitch13Device::ReceiveFromController (Ptr<Packet> packet, Address from)
       }
     }
 
-  // Send the message to handler.
+  // Send the message to handler. Replies are sent from within the handler,
+  // so we save the sender to select the connection for them.
+  m_rxSender = &senderCtrl;
   error = handle_control_msg (m_datapath, msg, &senderCtrl);
+  m_rxSender = 0;
   if (error)
     {
       // It is assumed that if a handler returns with error, it did not use any
@@ -985,15 +1279,13 @@ OFSwitch13Device::ReceiveFromController (Ptr<Packet> packet, Address from)
       // returned however, the message must be freed inside the handler because
       // the handler might keep parts of the message.
       ofl_msg_free (msg, m_datapath->exp);
-      ReplyWithErrorMessage (error, buffer, &senderCtrl);
+      ReplyWithErrorMessage (error, data, size, &senderCtrl);
     }
-
-  // If we got here, let's free the buffer.
-  ofpbuf_delete (buffer);
 }
 
 int
-OFSwitch13Device::ReplyWithErrorMessage (ofl_err error, struct ofpbuf *buffer,
+OFSwitch13Device::ReplyWithErrorMessage (ofl_err error, uint8_t *data,
+                                         size_t size,
                                          struct sender *senderCtrl)
 {
   NS_LOG_FUNCTION (this << error);
@@ -1002,15 +1294,26 @@ OFSwitch13Device::ReplyWithErrorMessage (ofl_err error, struct ofpbuf *buffer,
   err.header.type = OFPT_ERROR;
   err.type = (enum ofp_error_type)ofl_error_type (error);
   err.code = ofl_error_code (error);
-  err.data_length = buffer->size;
-  err.data = (uint8_t*)buffer->data;
+  err.data_length = size;
+  err.data = data;
 
   char *msgStr = ofl_msg_to_string ((struct ofl_msg_header*)&err, 0);
   NS_LOG_ERROR ("Error processing OpenFlow message. Reply with " << msgStr);
   free (msgStr);
 
-  return dp_send_message (m_datapath, (struct ofl_msg_header*)&err,
-                          senderCtrl);
+  m_rxSender = senderCtrl;
+  int ret = dp_send_message (m_datapath, (struct ofl_msg_header*)&err,
+                             senderCtrl);
+  m_rxSender = 0;
+  return ret;
+}
+
+void
+OFSwitch13Device::ReceiveFromConnection (OFSwitch13Device *device,
+                                         uint8_t connId, uint8_t *data,
+                                         size_t size, Address from)
+{
+  device->ReceiveFromController (data, size, from, connId);
 }
 
 void
@@ -1020,15 +1323,43 @@ OFSwitch13Device::SocketCtrlSucceeded (Ptr<Socket> socket)
 
   NS_LOG_INFO ("Controller accepted connection request!");
   Ptr<RemoteController> remoteCtrl = GetRemoteController (socket);
-  remoteCtrl->m_remote = remote_create (m_datapath, 0, 0);
+  remoteCtrl->m_retryDelay = Time (0);
+  socket->SetCloseCallbacks (
+    MakeCallback (&OFSwitch13Device::SocketCtrlClosed, this),
+    MakeCallback (&OFSwitch13Device::SocketCtrlClosed, this));
 
   // As we have more than one socket that is used for communication between
   // this OpenFlow switch device and controllers, we need to handle the process
   // of sending/receiving OpenFlow messages to/from sockets in an independent
   // way. So, each socket has its own socket handler to this end.
-  remoteCtrl->m_handler = CreateObject<OFSwitch13SocketHandler> (socket);
-  remoteCtrl->m_handler->SetReceiveCallback (
+  ControllerConnected (remoteCtrl,
+                       CreateObject<OFSwitch13SocketHandler> (socket));
+
+  // Open the auxiliary connections to this controller.
+  if (m_nAuxConns)
+    {
+      StartAuxiliaryConnections (remoteCtrl);
+    }
+}
+
+void
+OFSwitch13Device::ControllerConnected (Ptr<RemoteController> remoteCtrl,
+                                       Ptr<OFSwitch13SocketHandler> handler)
+{
+  NS_LOG_FUNCTION (this << handler);
+
+  // The library remote structure is kept across reconnections, but a new
+  // connection always starts with the equal role.
+  if (!remoteCtrl->m_remote)
+    {
+      remoteCtrl->m_remote = remote_create (m_datapath, 0, 0);
+    }
+  remoteCtrl->m_remote->role = OFPCR_ROLE_EQUAL;
+  remoteCtrl->m_handler = handler;
+  remoteCtrl->m_handler->SetReceiveRawCallback (
     MakeCallback (&OFSwitch13Device::ReceiveFromController, this));
+  remoteCtrl->m_handler->SetCloseCallback (
+    MakeCallback (&OFSwitch13Device::DirectCtrlClosed, this));
 
   // Send the OpenFlow Hello message.
   struct ofl_msg_header msg;
@@ -1036,8 +1367,172 @@ OFSwitch13Device::SocketCtrlSucceeded (Ptr<Socket> socket)
 
   struct sender senderCtrl;
   senderCtrl.remote = remoteCtrl->m_remote;
-  senderCtrl.conn_id = 0; // TODO No support for auxiliary connections.
+  senderCtrl.conn_id = 0;
   dp_send_message (m_datapath, &msg, &senderCtrl);
+  m_ctrlConnectionTrace (remoteCtrl->m_address, true);
+
+  // Start the echo monitor for this connection.
+  remoteCtrl->m_echoXid = 0;
+  remoteCtrl->m_echoMissed = 0;
+  if (m_echoInterval.IsStrictlyPositive ())
+    {
+      remoteCtrl->m_echoEvent = Simulator::Schedule (
+          m_echoInterval, &OFSwitch13Device::EchoPoll, this, remoteCtrl);
+    }
+}
+
+void
+OFSwitch13Device::EchoPoll (Ptr<RemoteController> remoteCtrl)
+{
+  NS_LOG_FUNCTION (this << remoteCtrl->m_address);
+
+  if (remoteCtrl->m_echoXid && ++remoteCtrl->m_echoMissed >= m_echoMissLimit)
+    {
+      NS_LOG_WARN ("Controller " << remoteCtrl->m_address << " missed " <<
+                   remoteCtrl->m_echoMissed << " echo replies.");
+
+      // Release the dead connection, so the device can reconnect (TCP) or
+      // fail over to the other controllers (direct channels are not
+      // reopened). The close notification is not necessary anymore.
+      if (remoteCtrl->m_socket)
+        {
+          remoteCtrl->m_socket->SetCloseCallbacks (
+            MakeNullCallback<void, Ptr<Socket> > (),
+            MakeNullCallback<void, Ptr<Socket> > ());
+        }
+      remoteCtrl->m_handler->SetCloseCallback (
+        MakeNullCallback<void, Ptr<OFSwitch13SocketHandler> > ());
+      remoteCtrl->m_handler->Close ();
+      m_ctrlConnectionTrace (remoteCtrl->m_address, false);
+      ControllerDisconnected (remoteCtrl);
+      return;
+    }
+
+  struct ofl_msg_echo msg;
+  msg.header.type = OFPT_ECHO_REQUEST;
+  msg.data_length = 0;
+  msg.data = 0;
+  if (++m_echoXid == 0)
+    {
+      // Zero is reserved to indicate no pending echo request.
+      m_echoXid++;
+    }
+  remoteCtrl->m_echoXid = m_echoXid;
+  remoteCtrl->m_echoSent = Simulator::Now ();
+  SendToController (ofs::PacketFromMsg ((struct ofl_msg_header*)&msg,
+                                        remoteCtrl->m_echoXid), remoteCtrl);
+  remoteCtrl->m_echoEvent = Simulator::Schedule (
+      m_echoInterval, &OFSwitch13Device::EchoPoll, this, remoteCtrl);
+}
+
+bool
+OFSwitch13Device::EchoReply (const uint8_t *data, size_t size,
+                             Ptr<RemoteController> remoteCtrl)
+{
+  ofs::MessageView view (data, size);
+  if (!remoteCtrl->m_echoXid || view.GetType () != OFPT_ECHO_REPLY
+      || view.GetXid () != remoteCtrl->m_echoXid)
+    {
+      return false;
+    }
+
+  Time rtt = Simulator::Now () - remoteCtrl->m_echoSent;
+  remoteCtrl->m_echoXid = 0;
+  remoteCtrl->m_echoMissed = 0;
+  remoteCtrl->m_ewmaRtt = remoteCtrl->m_ewmaRtt.IsZero () ? rtt :
+    Time (m_echoAlpha * rtt.GetDouble ()
+          + (1 - m_echoAlpha) * remoteCtrl->m_ewmaRtt.GetDouble ());
+
+  uint64_t bin = rtt.GetInteger () / m_rttBinWidth.GetInteger ();
+  if (bin >= remoteCtrl->m_rttHistogram.size ())
+    {
+      remoteCtrl->m_rttHistogram.resize (bin + 1, 0);
+    }
+  remoteCtrl->m_rttHistogram [bin]++;
+  m_echoRttTrace (remoteCtrl->m_address, rtt, remoteCtrl->m_ewmaRtt);
+  return true;
+}
+
+bool
+OFSwitch13Device::RateStatsReply (const uint8_t *data, size_t size,
+                                  Ptr<RemoteController> remoteCtrl,
+                                  uint8_t connId)
+{
+  ofs::MessageView view (data, size);
+  size_t hdrSize = sizeof (struct ofp_multipart_request)
+    + sizeof (struct ofp_experimenter_multipart_header);
+  if (!view.IsValid () || view.GetType () != OFPT_MULTIPART_REQUEST
+      || view.GetLength () < hdrSize)
+    {
+      return false;
+    }
+  const struct ofp_multipart_request *request =
+    (const struct ofp_multipart_request*)data;
+  const struct ofp_experimenter_multipart_header *expHeader =
+    (const struct ofp_experimenter_multipart_header*)request->body;
+  if (ntohs (request->type) != OFPMP_EXPERIMENTER
+      || ntohl (expHeader->experimenter) != ofs::OFS13_EXPERIMENTER_ID
+      || ntohl (expHeader->exp_type) != ofs::OFS13_EXP_RATE_STATS)
+    {
+      return false;
+    }
+  NS_LOG_FUNCTION (this << size << (uint16_t)connId);
+
+  // The request body is optional, and the default is all ports.
+  uint32_t portNo = OFPP_ANY;
+  size_t bodySize = sizeof (struct ofs::ofs13_rate_stats_request);
+  if (view.GetLength () >= hdrSize + bodySize)
+    {
+      const struct ofs::ofs13_rate_stats_request *body =
+        (const struct ofs::ofs13_rate_stats_request*)(data + hdrSize);
+      portNo = ntohl (body->port_no);
+    }
+
+  std::vector<struct ofs::ofs13_rate_stats> entries;
+  PortList_t::const_iterator it;
+  for (it = m_ports.begin (); it != m_ports.end (); it++)
+    {
+      if (portNo == OFPP_ANY || portNo == (*it)->GetPortNo ())
+        {
+          (*it)->GetRateStats (entries);
+        }
+    }
+
+  // Split the entries into multiple replies that fit into the 16-bit message
+  // length, setting the more flag on all but the last one.
+  size_t entrySize = sizeof (struct ofs::ofs13_rate_stats);
+  size_t maxEntries = (UINT16_MAX - hdrSize) / entrySize;
+  size_t next = 0;
+  do
+    {
+      size_t count = std::min (entries.size () - next, maxEntries);
+      size_t length = hdrSize + count * entrySize;
+      std::vector<uint8_t> wire (length, 0);
+
+      struct ofp_multipart_reply *reply = (struct ofp_multipart_reply*)&wire[0];
+      reply->header.version = OFP_VERSION;
+      reply->header.type = OFPT_MULTIPART_REPLY;
+      reply->header.length = htons (length);
+      reply->header.xid = htonl (view.GetXid ());
+      reply->type = htons (OFPMP_EXPERIMENTER);
+      if (next + count < entries.size ())
+        {
+          reply->flags = htons (OFPMPF_REPLY_MORE);
+        }
+      struct ofp_experimenter_multipart_header *replyExp =
+        (struct ofp_experimenter_multipart_header*)reply->body;
+      replyExp->experimenter = htonl (ofs::OFS13_EXPERIMENTER_ID);
+      replyExp->exp_type = htonl (ofs::OFS13_EXP_RATE_STATS);
+      if (count)
+        {
+          memcpy (&wire[hdrSize], &entries[next], count * entrySize);
+        }
+      next += count;
+
+      SendToController (Create<Packet> (&wire[0], length), remoteCtrl, connId);
+    }
+  while (next < entries.size ());
+  return true;
 }
 
 void
@@ -1046,19 +1541,183 @@ OFSwitch13Device::SocketCtrlFailed (Ptr<Socket> socket)
   NS_LOG_FUNCTION (this << socket);
 
   NS_LOG_ERROR ("Controller did not accepted connection request!");
+  ControllerDisconnected (GetRemoteController (socket));
+}
+
+void
+OFSwitch13Device::SocketCtrlClosed (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  NS_LOG_WARN ("Connection to controller closed.");
+  Ptr<RemoteController> remoteCtrl = GetRemoteController (socket);
+  m_ctrlConnectionTrace (remoteCtrl->m_address, false);
+  ControllerDisconnected (remoteCtrl);
+}
+
+void
+OFSwitch13Device::DirectCtrlClosed (Ptr<OFSwitch13SocketHandler> handler)
+{
+  NS_LOG_FUNCTION (this << handler);
 
-  // Loop over controllers looking for the one associated to this socket and
-  // remove it from the collection.
   CtrlList_t::iterator it;
   for (it = m_controllers.begin (); it != m_controllers.end (); it++)
     {
       Ptr<RemoteController> remoteCtrl = *it;
-      if (remoteCtrl->m_socket == socket)
+      if (remoteCtrl->m_handler == handler)
+        {
+          NS_LOG_WARN ("Direct channel connection to controller closed.");
+          m_ctrlConnectionTrace (remoteCtrl->m_address, false);
+          ControllerDisconnected (remoteCtrl);
+          return;
+        }
+    }
+}
+
+void
+OFSwitch13Device::ConnectController (Ptr<RemoteController> remoteCtrl)
+{
+  NS_LOG_FUNCTION (this << remoteCtrl->m_address);
+
+  // Start a TCP connection to this target controller.
+  int error = 0;
+  TypeId tcpFact = TypeId::LookupByName ("ns3::TcpSocketFactory");
+  Ptr<Socket> ctrlSocket = Socket::CreateSocket (GetObject<Node> (), tcpFact);
+  ctrlSocket->SetAttribute ("SegmentSize", UintegerValue (8900));
+  remoteCtrl->m_socket = ctrlSocket;
+
+  error = ctrlSocket->Bind ();
+  if (error)
+    {
+      NS_LOG_ERROR ("Error binding socket " << error);
+      ControllerDisconnected (remoteCtrl);
+      return;
+    }
+
+  error = ctrlSocket->Connect (
+      InetSocketAddress::ConvertFrom (remoteCtrl->m_address));
+  if (error)
+    {
+      NS_LOG_ERROR ("Error connecting socket " << error);
+      ControllerDisconnected (remoteCtrl);
+      return;
+    }
+
+  ctrlSocket->SetConnectCallback (
+    MakeCallback (&OFSwitch13Device::SocketCtrlSucceeded, this),
+    MakeCallback (&OFSwitch13Device::SocketCtrlFailed, this));
+}
+
+void
+OFSwitch13Device::ControllerDisconnected (Ptr<RemoteController> remoteCtrl)
+{
+  NS_LOG_FUNCTION (this << remoteCtrl->m_address);
+
+  // Release the main and auxiliary connections. Messages sent to this
+  // controller are discarded until a new connection is established. Direct
+  // channels are the only connections without a TCP socket.
+  bool direct = !remoteCtrl->m_socket;
+  for (size_t i = 0; i < remoteCtrl->m_auxSockets.size (); i++)
+    {
+      remoteCtrl->m_auxSockets [i]->SetCloseCallbacks (
+        MakeNullCallback<void, Ptr<Socket> > (),
+        MakeNullCallback<void, Ptr<Socket> > ());
+      remoteCtrl->m_auxSockets [i]->Close ();
+    }
+  remoteCtrl->m_auxSockets.clear ();
+  remoteCtrl->m_auxHandlers.clear ();
+  remoteCtrl->m_handler = 0;
+  remoteCtrl->m_socket = 0;
+  remoteCtrl->m_echoEvent.Cancel ();
+
+  if (direct || m_retryDelay.IsZero ())
+    {
+      // Reconnection disabled or impossible. Remove the controller from the
+      // collection, unless the library already knows about it. In this case,
+      // we keep it without a connection, as the library remote can't be
+      // released here.
+      if (remoteCtrl->m_remote)
         {
-          m_controllers.erase (it);
           return;
         }
+      CtrlList_t::iterator it;
+      for (it = m_controllers.begin (); it != m_controllers.end (); it++)
+        {
+          if (*it == remoteCtrl)
+            {
+              m_controllers.erase (it);
+              return;
+            }
+        }
+      return;
+    }
+
+  // Exponential backoff between consecutive attempts.
+  if (remoteCtrl->m_retryDelay.IsZero ())
+    {
+      remoteCtrl->m_retryDelay = m_retryDelay;
     }
+  NS_LOG_INFO ("Reconnecting to controller in " <<
+               remoteCtrl->m_retryDelay.As (Time::S));
+  remoteCtrl->m_retryEvent = Simulator::Schedule (
+      remoteCtrl->m_retryDelay, &OFSwitch13Device::ConnectController, this,
+      remoteCtrl);
+  remoteCtrl->m_retryDelay = Min (remoteCtrl->m_retryDelay * 2, m_retryMax);
+}
+
+void
+OFSwitch13Device::SocketAuxSucceeded (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  uint8_t connId = 0;
+  Ptr<RemoteController> remoteCtrl = GetAuxiliaryController (socket, connId);
+  NS_LOG_INFO ("Controller accepted auxiliary connection " <<
+               (uint16_t)connId);
+
+  Ptr<OFSwitch13SocketHandler> handler =
+    CreateObject<OFSwitch13SocketHandler> (socket);
+  handler->SetReceiveRawCallback (
+    MakeBoundCallback (&OFSwitch13Device::ReceiveFromConnection, this,
+                       connId));
+  remoteCtrl->m_auxHandlers [connId - 1] = handler;
+  socket->SetCloseCallbacks (
+    MakeCallback (&OFSwitch13Device::SocketAuxClosed, this),
+    MakeCallback (&OFSwitch13Device::SocketAuxClosed, this));
+
+  // Send the OpenFlow Hello message over this auxiliary connection.
+  struct ofl_msg_header msg;
+  msg.type = OFPT_HELLO;
+
+  struct sender senderCtrl;
+  senderCtrl.remote = remoteCtrl->m_remote;
+  senderCtrl.conn_id = connId;
+  m_rxSender = &senderCtrl;
+  dp_send_message (m_datapath, &msg, &senderCtrl);
+  m_rxSender = 0;
+}
+
+void
+OFSwitch13Device::SocketAuxFailed (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  // The auxiliary handler is kept null, so the main connection is used.
+  uint8_t connId = 0;
+  GetAuxiliaryController (socket, connId);
+  NS_LOG_ERROR ("Controller did not accepted auxiliary connection " <<
+                (uint16_t)connId);
+}
+
+void
+OFSwitch13Device::SocketAuxClosed (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  uint8_t connId = 0;
+  Ptr<RemoteController> remoteCtrl = GetAuxiliaryController (socket, connId);
+  NS_LOG_WARN ("Auxiliary connection " << (uint16_t)connId << " closed.");
+  remoteCtrl->m_auxHandlers [connId - 1] = 0;
 }
 
 void
@@ -1180,8 +1839,36 @@ OFSwitch13Device::BufferPacketRetrieve (uint64_t packetId)
   NS_ASSERT_MSG (it != m_bufferPkts.end (), "Packet not found in buffer.");
 
   // Save packet into pipeline structure.
-  m_pipePkt.SetPacket (it->first, it->second);
-  m_bufferRetrieveTrace (m_pipePkt.GetPacket ());
+  FlowSetupMap_t::iterator setupIt = m_flowSetups.find (packetId);
+  if (setupIt == m_flowSetups.end ())
+    {
+      m_pipePkt.SetPacket (it->first, it->second);
+      m_bufferRetrieveTrace (m_pipePkt.GetPacket ());
+    }
+  else
+    {
+      m_pipePkt.SetPacket (it->first, it->second, setupIt->second.m_arrival);
+      m_bufferRetrieveTrace (m_pipePkt.GetPacket ());
+
+      // The packet is released by a packet-out or flow-mod message from the
+      // controller, so we can break down the flow setup latency. The control
+      // channel delay is estimated by the echo RTT from the sender controller
+      // (zero when the echo monitor is disabled), and the remaining time is
+      // spent into controller queueing and processing.
+      Time total = Simulator::Now () - setupIt->second.m_arrival;
+      Time pipeline = setupIt->second.m_packetIn - setupIt->second.m_arrival;
+      Time response = Simulator::Now () - setupIt->second.m_packetIn;
+      Time channel = Time (0);
+      if (m_rxSender)
+        {
+          channel = Min (GetRemoteController (m_rxSender->remote)->m_ewmaRtt,
+                         response);
+        }
+      NS_LOG_DEBUG ("Flow setup for packet " << packetId << " in " << total);
+      m_flowSetupTrace (m_pipePkt.GetPacket (), total, pipeline, channel,
+                        response - channel);
+      m_flowSetups.erase (setupIt);
+    }
 
   // Delete packet from buffer.
   NS_LOG_DEBUG ("Packet " << packetId << " removed from buffer.");
@@ -1201,6 +1888,7 @@ OFSwitch13Device::BufferPacketDelete (uint64_t packetId)
       m_bufferExpireTrace (it->second);
       m_bufferPkts.erase (it);
     }
+  m_flowSetups.erase (packetId);
 }
 
 Ptr<OFSwitch13Device::RemoteController>
@@ -1251,6 +1939,27 @@ OFSwitch13Device::GetRemoteController (struct remote *remote)
   NS_ABORT_MSG ("Error returning controller for this remote pointer.");
 }
 
+Ptr<OFSwitch13Device::RemoteController>
+OFSwitch13Device::GetAuxiliaryController (Ptr<Socket> socket, uint8_t &connId)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  CtrlList_t::iterator it;
+  for (it = m_controllers.begin (); it != m_controllers.end (); it++)
+    {
+      Ptr<RemoteController> remoteCtrl = *it;
+      for (size_t i = 0; i < remoteCtrl->m_auxSockets.size (); i++)
+        {
+          if (remoteCtrl->m_auxSockets [i] == socket)
+            {
+              connId = i + 1;
+              return remoteCtrl;
+            }
+        }
+    }
+  NS_ABORT_MSG ("Error returning controller for this auxiliary socket.");
+}
+
 uint64_t
 OFSwitch13Device::GetNewPacketId ()
 {
@@ -1312,7 +2021,10 @@ OFSwitch13Device::UnregisterDatapath (uint64_t id)
 OFSwitch13Device::RemoteController::RemoteController ()
   : m_socket (0),
   m_handler (0),
-  m_remote (0)
+  m_remote (0),
+  m_echoXid (0),
+  m_echoMissed (0),
+  m_ewmaRtt (Time (0))
 {
   m_address = Address ();
 }
@@ -1324,11 +2036,13 @@ OFSwitch13Device::PipelinePacket::PipelinePacket ()
 }
 
 void
-OFSwitch13Device::PipelinePacket::SetPacket (uint64_t id, Ptr<Packet> packet)
+OFSwitch13Device::PipelinePacket::SetPacket (uint64_t id, Ptr<Packet> packet,
+                                             Time arrival)
 {
   NS_ASSERT_MSG (id && packet, "Invalid packet metadata values.");
   m_valid = true;
   m_packet = packet;
+  m_arrival = arrival;
   m_ids.push_back (id);
 }
 
@@ -1339,11 +2053,19 @@ OFSwitch13Device::PipelinePacket::GetPacket (void) const
   return m_packet;
 }
 
+Time
+OFSwitch13Device::PipelinePacket::GetArrival (void) const
+{
+  NS_ASSERT_MSG (IsValid (), "Invalid packet metadata.");
+  return m_arrival;
+}
+
 void
 OFSwitch13Device::PipelinePacket::Invalidate (void)
 {
   m_valid = false;
   m_packet = 0;
+  m_arrival = Time (0);
   m_ids.clear ();
 }
 
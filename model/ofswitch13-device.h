@@ -29,6 +29,7 @@
 #include <ns3/traced-value.h>
 #include "ofswitch13-interface.h"
 #include "ofswitch13-port.h"
+#include "ofswitch13-shared-buffer.h"
 #include "ofswitch13-socket-handler.h"
 
 namespace ns3 {
@@ -67,10 +68,26 @@ public:
     RemoteController ();
 
 private:
-    Ptr<Socket>                   m_socket;   //!< TCP socket to controller.
-    Ptr<OFSwitch13SocketHandler>  m_handler;  //!< Socket handler.
-    Address                       m_address;  //!< Controller address.
-    struct remote*                m_remote;   //!< Library remote struct.
+    /** List of auxiliary TCP sockets (auxiliary id - 1 used as index). */
+    typedef std::vector<Ptr<Socket> > SocketList_t;
+
+    /** List of auxiliary socket handlers (auxiliary id - 1 used as index). */
+    typedef std::vector<Ptr<OFSwitch13SocketHandler> > HandlerList_t;
+
+    Ptr<Socket>                   m_socket;       //!< Main TCP socket.
+    Ptr<OFSwitch13SocketHandler>  m_handler;      //!< Main socket handler.
+    SocketList_t                  m_auxSockets;   //!< Auxiliary sockets.
+    HandlerList_t                 m_auxHandlers;  //!< Auxiliary handlers.
+    Address                       m_address;      //!< Controller address.
+    struct remote*                m_remote;       //!< Library remote struct.
+    Time                          m_retryDelay;   //!< Reconnection backoff.
+    EventId                       m_retryEvent;   //!< Reconnection event.
+    EventId                       m_echoEvent;    //!< Next echo request.
+    uint32_t                      m_echoXid;      //!< Pending echo xid.
+    Time                          m_echoSent;     //!< Pending echo time.
+    uint32_t                      m_echoMissed;   //!< Missed echo replies.
+    Time                          m_ewmaRtt;      //!< EWMA control RTT.
+    std::vector<uint32_t>         m_rttHistogram; //!< Control RTT histogram.
   }; // Class RemoteController
 
   /**
@@ -92,12 +109,17 @@ public:
      * Save packet metadata.
      * \param id Packet unique ID.
      * \param packet The packet pointer.
+     * \param arrival The packet arrival time at the switch port.
      */
-    void SetPacket (uint64_t id, Ptr<Packet> packet);
+    void SetPacket (uint64_t id, Ptr<Packet> packet,
+                    Time arrival = Time (0));
 
     /** \return The packet pointer. */
     Ptr<Packet> GetPacket (void) const;
 
+    /** \return The packet arrival time at the switch port. */
+    Time GetArrival (void) const;
+
     /** Invalidate packet metatada.*/
     void Invalidate (void);
 
@@ -130,6 +152,7 @@ public:
 private:
     bool                  m_valid;  //!< Valid flag.
     Ptr<Packet>           m_packet; //!< Packet pointer.
+    Time                  m_arrival; //!< Packet arrival time.
     std::vector<uint64_t> m_ids;    //!< Internal list of IDs for this packet.
   }; // Struct PipelinePacket
 
@@ -177,6 +200,21 @@ public:
   uint32_t GetSumFlowEntries    (void) const;
   //\}
 
+  /**
+   * Get the shared packet buffer pool for the port queues in this switch.
+   * \return The shared buffer, or 0 when disabled.
+   */
+  Ptr<OFSwitch13SharedBuffer> GetSharedBuffer (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables used
+   * by the queues of the switch ports.
+   * \attention Call this method only after adding the switch ports.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned.
+   */
+  int64_t AssignStreams (int64_t stream);
+
   /**
    * Add a 'port' to the switch device. This method adds a new switch port to a
    * OFSwitch13Device, so that the new switch port NetDevice becomes part of
@@ -207,6 +245,32 @@ public:
    */
   void StartControllerConnection (Address ctrlAddr);
 
+  /**
+   * Starts the connection between this switch and the target controller over
+   * an in-process direct channel, bypassing the TCP/IP stack. Auxiliary
+   * connections are not supported over direct channels.
+   * \param handler The switch end of the direct channel.
+   * \param ctrlAddr The controller address at the other end of the channel.
+   * \see OFSwitch13DirectChannel
+   */
+  void StartDirectConnection (Ptr<OFSwitch13SocketHandler> handler,
+                              Address ctrlAddr);
+
+  /**
+   * Get the EWMA of the control channel RTT measured by the echo monitor.
+   * \param ctrlAddr The controller address.
+   * \return The EWMA RTT (zero for unknown controllers or no measures yet).
+   */
+  Time GetEwmaRtt (Address ctrlAddr) const;
+
+  /**
+   * Get the histogram of the control channel RTT measured by the echo
+   * monitor. The bin width is given by the RttBinWidth attribute.
+   * \param ctrlAddr The controller address.
+   * \return The RTT histogram (empty for unknown controllers).
+   */
+  std::vector<uint32_t> GetRttHistogram (Address ctrlAddr) const;
+
   /**
    * Overriding ofsoftswitch13 send_packet_to_controller weak function
    * from udatapath/pipeline.c. Sends the given packet to controller(s) in a
@@ -322,6 +386,34 @@ public:
    */
   typedef void (*DeviceTracedCallback)(Ptr<const OFSwitch13Device> dev);
 
+  /**
+   * TracedCallback signature for controller connection state changes.
+   * \param ctrlAddr The controller address.
+   * \param connected True when connected, false when disconnected.
+   */
+  typedef void (*ConnectionTracedCallback)(Address ctrlAddr, bool connected);
+
+  /**
+   * TracedCallback signature for echo RTT samples.
+   * \param ctrlAddr The controller address.
+   * \param rtt The RTT sample.
+   * \param ewmaRtt The updated EWMA RTT.
+   */
+  typedef void (*EchoRttTracedCallback)(Address ctrlAddr, Time rtt,
+                                        Time ewmaRtt);
+
+  /**
+   * TracedCallback signature for flow setup latency samples.
+   * \param packet The buffered packet released by the controller.
+   * \param total The time from packet arrival to the packet release.
+   * \param pipeline The time from packet arrival to the packet-in.
+   * \param channel The estimated control channel delay.
+   * \param controller The controller queueing and processing time.
+   */
+  typedef void (*FlowSetupTracedCallback)(
+    Ptr<const Packet> packet, Time total, Time pipeline, Time channel,
+    Time controller);
+
 protected:
   // Inherited from Object
   virtual void DoDispose (void);
@@ -362,9 +454,17 @@ private:
    */
   Ptr<OFSwitch13Port> GetOFSwitch13Port (uint32_t no);
 
+  /**
+   * Check the control channel congestion state.
+   * \return True when the channels to all connected controllers are
+   *         congested, false otherwise.
+   */
+  bool IsControlChannelCongested (void) const;
+
   /**
    * Create an OpenFlow packet in message and send the packet to all
-   * controllers with open connections.
+   * controllers with open connections. The packet in is discarded when the
+   * channels to all controllers are congested.
    * \param pkt The internal packet to send.
    * \param tableId ID of the table that was looked up.
    * \param reason Reason packet is being sent (on of OFPR_*).
@@ -393,9 +493,10 @@ private:
    * \param packet The packet.
    * \param portNo The switch input port number.
    * \param tunnelId The metadata associated with a logical port.
+   * \param arrival The packet arrival time at the switch port.
    */
   void SendToPipeline (Ptr<Packet> packet, uint32_t portNo,
-                       uint64_t tunnelId = 0);
+                       uint64_t tunnelId, Time arrival);
 
   /**
    * Send a packet to the controller node.
@@ -405,29 +506,68 @@ private:
    * check async config.
    * \param packet The ns-3 packet to send.
    * \param remoteCtrl The remote controller object to send the packet.
+   * \param connId The connection id (0 for the main connection).
    * \return 0 if everything's ok, otherwise an error number.
    */
   int SendToController (Ptr<Packet> packet,
-                        Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+                        Ptr<OFSwitch13Device::RemoteController> remoteCtrl,
+                        uint8_t connId = 0);
+
+  /**
+   * Select the controller connection used to send an OpenFlow message.
+   * Replies go back to the connection that received the request, packet-ins
+   * are hashed by flow across the established auxiliary connections, and any
+   * other asynchronous message goes to the main connection.
+   * \param buffer The message buffer to send.
+   * \param remote The remote controller connection information.
+   * \return The connection id (0 for the main connection).
+   */
+  uint8_t SelectConnection (struct ofpbuf *buffer, struct remote *remote);
 
   /**
-   * Receive an OpenFlow packet from controller.
+   * Open the auxiliary TCP connections to the remote controller.
+   * \param remoteCtrl The remote controller object.
+   */
+  void StartAuxiliaryConnections (
+    Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+
+  /**
+   * Receive an OpenFlow message from controller.
    * \see remote_rconn_run () at udatapath/datapath.c.
-   * \param packet The packet with the OpenFlow message.
-   * \param from The packet sender address.
+   * \param data The message in wire format (a slice of the socket handler
+   *        receive buffer).
+   * \param size The message size.
+   * \param from The message sender address.
+   * \param connId The connection id (0 for the main connection).
+   */
+  void ReceiveFromController (uint8_t *data, size_t size, Address from,
+                              uint8_t connId = 0);
+
+  /**
+   * Receive an OpenFlow message from an auxiliary controller connection.
+   * This static function is bound to the auxiliary socket handler receive
+   * callback together with the device pointer and the auxiliary id.
+   * \param device The OpenFlow device.
+   * \param connId The auxiliary connection id.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \param from The message sender address.
    */
-  void ReceiveFromController (Ptr<Packet> packet, Address from);
+  static void ReceiveFromConnection (OFSwitch13Device *device, uint8_t connId,
+                                     uint8_t *data, size_t size,
+                                     Address from);
 
   /**
    * Create an OpenFlow error message and send it back to the sender
    * controller. This function is used only when an error occurred while
    * processing an OpenFlow message received from the controller.
    * \param error The error code.
-   * \param buffer The message buffer that originated the error.
+   * \param data The message that originated the error.
+   * \param size The message size.
    * \param senderCtrl The origin of a received OpenFlow message.
    * \return 0 if everything's ok, otherwise an error number.
    */
-  int ReplyWithErrorMessage (ofl_err error, struct ofpbuf *buffer,
+  int ReplyWithErrorMessage (ofl_err error, uint8_t *data, size_t size,
                              struct sender *senderCtrl);
 
   /**
@@ -442,6 +582,102 @@ private:
    */
   void SocketCtrlFailed (Ptr<Socket> socket);
 
+  /**
+   * Socket callback fired when a TCP connection to controller is closed,
+   * either normally or by an error.
+   * \param socket The TCP socket.
+   */
+  void SocketCtrlClosed (Ptr<Socket> socket);
+
+  /**
+   * Socket handler callback fired when a direct channel connection to
+   * controller is closed by any of its ends.
+   * \param handler The socket handler of the closed connection.
+   */
+  void DirectCtrlClosed (Ptr<OFSwitch13SocketHandler> handler);
+
+  /**
+   * Open the main TCP connection to the remote controller.
+   * \param remoteCtrl The remote controller object.
+   */
+  void ConnectController (Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+
+  /**
+   * Release the connection to the remote controller and schedule a new
+   * connection attempt with exponential backoff. When reconnection is
+   * disabled (ReconnectDelay is zero) or the connection was over a direct
+   * channel, which can't be reopened, the controller is removed.
+   * \param remoteCtrl The remote controller object.
+   */
+  void ControllerDisconnected (
+    Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+
+  /**
+   * Set up the main connection to the controller after it is established,
+   * sending the OpenFlow Hello message.
+   * \param remoteCtrl The remote controller object.
+   * \param handler The socket handler for this connection.
+   */
+  void ControllerConnected (Ptr<OFSwitch13Device::RemoteController> remoteCtrl,
+                            Ptr<OFSwitch13SocketHandler> handler);
+
+  /**
+   * Send an echo request to the controller and schedule the next one. When
+   * the reply for the previous request was not received yet, it is counted
+   * as missed, and the connection is closed after too many consecutive
+   * missed replies.
+   * \param remoteCtrl The remote controller object.
+   */
+  void EchoPoll (Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+
+  /**
+   * Check for a reply to the pending echo request, updating the RTT.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \param remoteCtrl The remote controller object.
+   * \return true if the message is the reply to the pending echo request.
+   */
+  bool EchoReply (const uint8_t *data, size_t size,
+                  Ptr<OFSwitch13Device::RemoteController> remoteCtrl);
+
+  /**
+   * Check for an OFSwitch13 rate statistics request (an OFPMP_EXPERIMENTER
+   * multipart request with the OFS13_EXPERIMENTER_ID), replying to it from
+   * the switch port and queue rate estimators. As the ofsoftswitch13 library
+   * has no experimenter callbacks, the request is handled in wire format and
+   * the reply is split into multiple messages when necessary.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \param remoteCtrl The remote controller object.
+   * \param connId The connection id that received the request.
+   * \return true if the message is a rate statistics request.
+   */
+  bool RateStatsReply (const uint8_t *data, size_t size,
+                       Ptr<OFSwitch13Device::RemoteController> remoteCtrl,
+                       uint8_t connId);
+
+  /**
+   * Socket callback fired when an auxiliary TCP connection to controller
+   * succeed.
+   * \param socket The TCP socket.
+   */
+  void SocketAuxSucceeded (Ptr<Socket> socket);
+
+  /**
+   * Socket callback fired when an auxiliary TCP connection to controller
+   * fail.
+   * \param socket The TCP socket.
+   */
+  void SocketAuxFailed (Ptr<Socket> socket);
+
+  /**
+   * Socket callback fired when an auxiliary TCP connection to controller is
+   * closed. The auxiliary handler is released, so messages for this
+   * connection go to the main one.
+   * \param socket The TCP socket.
+   */
+  void SocketAuxClosed (Ptr<Socket> socket);
+
   /**
    * Notify this device of a new meter entry created at meter table. This is
    * used to update the initial number of tokens for this meter. Doing this, we
@@ -517,6 +753,15 @@ private:
   Ptr<OFSwitch13Device::RemoteController>
   GetRemoteController (struct remote *remote);
 
+  /**
+   * Get the remote controller and the auxiliary id for this auxiliary socket.
+   * \param socket The auxiliary connection socket.
+   * \param connId The auxiliary connection id (output).
+   * \return The remote controller.
+   */
+  Ptr<OFSwitch13Device::RemoteController>
+  GetAuxiliaryController (Ptr<Socket> socket, uint8_t &connId);
+
   /**
    * Increase the global packet ID counter and return a new packet ID. This ID
    * is different from the internal ns3::Packet::GetUid (), as we need an
@@ -561,6 +806,16 @@ private:
   /** Structure to save packets, indexed by its id. */
   typedef std::map<uint64_t, Ptr<Packet> > IdPacketMap_t;
 
+  /** Flow setup timestamps for a packet saved into buffer. */
+  struct FlowSetupInfo
+  {
+    Time m_arrival;   //!< Packet arrival time at the switch port.
+    Time m_packetIn;  //!< Packet-in send time.
+  };
+
+  /** Structure to save flow setup timestamps, indexed by packet id. */
+  typedef std::map<uint64_t, FlowSetupInfo> FlowSetupMap_t;
+
   /** Trace source fired when a packet in buffer expires. */
   TracedCallback<Ptr<const Packet> > m_bufferExpireTrace;
 
@@ -582,6 +837,18 @@ private:
   /** Trace source fired when a packet is sent to pipeline. */
   TracedCallback<Ptr<const Packet> > m_pipePacketTrace;
 
+  /** Trace source fired when a packet-in is dropped by channel congestion. */
+  TracedCallback<Ptr<const Packet> > m_packetInDropTrace;
+
+  /** Trace source fired when a controller connection is up or down. */
+  TracedCallback<Address, bool> m_ctrlConnectionTrace;
+
+  /** Trace source fired for each echo RTT sample. */
+  TracedCallback<Address, Time, Time> m_echoRttTrace;
+
+  /** Trace source fired when a packet-in buffered packet is released. */
+  TracedCallback<Ptr<const Packet>, Time, Time, Time, Time> m_flowSetupTrace;
+
   /** Buffer space usage in terms of packets. */
   TracedValue<double> m_bufferUsage;
 
@@ -613,8 +880,21 @@ private:
   uint32_t          m_meterTabSize; //!< Meter table maximum entries.
   uint32_t          m_numPipeTabs;  //!< Number of pipeline flow tables.
   IdPacketMap_t     m_bufferPkts;   //!< Packets saved in switch buffer.
+  FlowSetupMap_t    m_flowSetups;   //!< Pending flow setups in buffer.
   uint32_t          m_bufferSize;   //!< Buffer size in terms of packets.
   PipelinePacket    m_pipePkt;      //!< Packet under switch pipeline.
+  uint32_t          m_sharedSize;   //!< Shared buffer size (bytes).
+  double            m_sharedAlpha;  //!< Shared buffer threshold alpha.
+  Ptr<OFSwitch13SharedBuffer> m_sharedBuffer; //!< Shared buffer pool.
+  uint8_t           m_nAuxConns;    //!< Auxiliary connections per ctrl.
+  Time              m_retryDelay;   //!< Initial reconnection delay.
+  Time              m_retryMax;     //!< Maximum reconnection delay.
+  Time              m_echoInterval; //!< Echo monitor interval.
+  uint32_t          m_echoMissLimit; //!< Missed echoes for dead.
+  double            m_echoAlpha;    //!< EWMA RTT alpha.
+  Time              m_rttBinWidth;  //!< RTT histogram bin width.
+  uint32_t          m_echoXid;      //!< Last echo transaction id.
+  struct sender*    m_rxSender;     //!< Sender of the message in process.
   DataRate          m_pipeCapacity; //!< Pipeline throughput capacity.
   uint64_t          m_pipeTokens;   //!< Pipeline capacity available tokens.
   uint64_t          m_pipeConsumed; //!< Pipeline capacity consumed tokens.
@@ -0,0 +1,216 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include <ns3/double.h>
+#include "ofswitch13-direct-channel.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13DirectChannel");
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13DirectChannel);
+
+OFSwitch13DirectChannel::OFSwitch13DirectChannel ()
+  : m_nEnds (0)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_lossRng = CreateObject<UniformRandomVariable> ();
+  m_ends [0].m_handler = 0;
+  m_ends [0].m_busy = false;
+  m_ends [1].m_handler = 0;
+  m_ends [1].m_busy = false;
+}
+
+OFSwitch13DirectChannel::~OFSwitch13DirectChannel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13DirectChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13DirectChannel")
+    .SetParent<Object> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13DirectChannel> ()
+    .AddAttribute ("DataRate",
+                   "The data rate of each channel direction.",
+                   DataRateValue (DataRate ("10Gb/s")),
+                   MakeDataRateAccessor (&OFSwitch13DirectChannel::m_dataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("Delay",
+                   "The propagation delay of the channel.",
+                   TimeValue (MicroSeconds (0)),
+                   MakeTimeAccessor (&OFSwitch13DirectChannel::m_delay),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("LossRate",
+                   "The probability of discarding an OpenFlow message.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&OFSwitch13DirectChannel::m_lossRate),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+
+    .AddTraceSource ("Drop",
+                     "Trace source indicating a message discarded by the "
+                     "loss model.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13DirectChannel::m_dropTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+Ptr<OFSwitch13SocketHandler>
+OFSwitch13DirectChannel::CreateHandler (Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  NS_ABORT_MSG_IF (m_nEnds == 2, "Both channel ends already created.");
+  Ptr<OFSwitch13SocketHandler> handler =
+    CreateObject<OFSwitch13SocketHandler> (
+      Ptr<OFSwitch13DirectChannel> (this));
+  m_ends [m_nEnds].m_handler = PeekPointer (handler);
+  m_ends [m_nEnds].m_address = address;
+  m_nEnds++;
+  return handler;
+}
+
+int64_t
+OFSwitch13DirectChannel::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  m_lossRng->SetStream (stream);
+  return 1;
+}
+
+void
+OFSwitch13DirectChannel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+
+  m_ends [0].m_handler = 0;
+  m_ends [1].m_handler = 0;
+  m_lossRng = 0;
+  Object::DoDispose ();
+}
+
+uint8_t
+OFSwitch13DirectChannel::GetEnd (const OFSwitch13SocketHandler *handler) const
+{
+  if (m_ends [0].m_handler == handler)
+    {
+      return 0;
+    }
+  NS_ASSERT_MSG (m_ends [1].m_handler == handler,
+                 "Socket handler not attached to this channel.");
+  return 1;
+}
+
+void
+OFSwitch13DirectChannel::Detach (const OFSwitch13SocketHandler *handler)
+{
+  NS_LOG_FUNCTION (this << handler);
+
+  m_ends [GetEnd (handler)].m_handler = 0;
+}
+
+Address
+OFSwitch13DirectChannel::GetPeerAddress (
+  const OFSwitch13SocketHandler *handler) const
+{
+  return m_ends [1 - GetEnd (handler)].m_address;
+}
+
+bool
+OFSwitch13DirectChannel::IsBusy (const OFSwitch13SocketHandler *handler) const
+{
+  return m_ends [GetEnd (handler)].m_busy;
+}
+
+void
+OFSwitch13DirectChannel::Transmit (const OFSwitch13SocketHandler *handler,
+                                   Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << handler << packet);
+
+  uint8_t idx = GetEnd (handler);
+  NS_ASSERT_MSG (!m_ends [idx].m_busy, "Channel end is busy.");
+
+  // The sender end is busy while serializing the message. Events hold a
+  // reference to this channel, which may outlive the socket handlers.
+  Time txTime = m_dataRate.CalculateBytesTxTime (packet->GetSize ());
+  m_ends [idx].m_busy = true;
+  Simulator::Schedule (txTime, &OFSwitch13DirectChannel::TxComplete,
+                       Ptr<OFSwitch13DirectChannel> (this), idx);
+
+  if (m_lossRate > 0 && m_lossRng->GetValue () < m_lossRate)
+    {
+      NS_LOG_DEBUG ("Message discarded by the loss model.");
+      m_dropTrace (packet);
+      return;
+    }
+  Simulator::Schedule (txTime + m_delay, &OFSwitch13DirectChannel::Deliver,
+                       Ptr<OFSwitch13DirectChannel> (this), 1 - idx, packet);
+}
+
+void
+OFSwitch13DirectChannel::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Keep this channel alive while the handlers release their references.
+  Ptr<OFSwitch13DirectChannel> channel (this);
+  for (uint8_t idx = 0; idx < 2; idx++)
+    {
+      OFSwitch13SocketHandler *handler = m_ends [idx].m_handler;
+      if (handler)
+        {
+          m_ends [idx].m_handler = 0;
+          handler->m_channel = 0;
+          Simulator::ScheduleNow (&OFSwitch13SocketHandler::NotifyClose,
+                                  Ptr<OFSwitch13SocketHandler> (handler));
+        }
+    }
+}
+
+void
+OFSwitch13DirectChannel::TxComplete (uint8_t idx)
+{
+  NS_LOG_FUNCTION (this << (uint16_t)idx);
+
+  m_ends [idx].m_busy = false;
+  if (m_ends [idx].m_handler)
+    {
+      m_ends [idx].m_handler->Flush ();
+    }
+}
+
+void
+OFSwitch13DirectChannel::Deliver (uint8_t idx, Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << (uint16_t)idx << packet);
+
+  if (m_ends [idx].m_handler)
+    {
+      m_ends [idx].m_handler->RecvDirect (packet, m_ends [1 - idx].m_address);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_DIRECT_CHANNEL_H
+#define OFSWITCH13_DIRECT_CHANNEL_H
+
+#include <ns3/object.h>
+#include <ns3/address.h>
+#include <ns3/data-rate.h>
+#include <ns3/nstime.h>
+#include <ns3/traced-callback.h>
+#include <ns3/random-variable-stream.h>
+#include "ofswitch13-socket-handler.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ * In-process OpenFlow channel connecting a single switch to a single
+ * controller without any network device, IP, or TCP layer. Each end of the
+ * channel is an OFSwitch13SocketHandler created by the CreateHandler ()
+ * method, so the switch and the controller keep the same message queueing,
+ * coalescing, and congestion logic used over TCP sockets.
+ *
+ * Each OpenFlow message is transmitted individually. The sender end is busy
+ * for the message serialization time at the configured DataRate, and the
+ * message is delivered to the other end after the additional propagation
+ * Delay. Messages can also be discarded with the LossRate probability (note
+ * that there is no retransmission, so lost messages are never recovered).
+ *
+ * The channel ends don't hold references to the socket handlers, which hold
+ * the reference to the channel instead. A disposed socket handler is detached
+ * from its end, and closing the connection at any end detaches both of them.
+ * Messages delivered to a detached end are discarded.
+ */
+class OFSwitch13DirectChannel : public Object
+{
+  friend class OFSwitch13SocketHandler;
+
+public:
+  OFSwitch13DirectChannel ();          //!< Default constructor.
+  virtual ~OFSwitch13DirectChannel (); //!< Dummy destructor, see DoDispose.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Create the socket handler for one end of this channel. Each channel has
+   * exactly two ends.
+   * \param address The address of this end, informed to the other end as the
+   *        sender address of the messages.
+   * \return The socket handler.
+   */
+  Ptr<OFSwitch13SocketHandler> CreateHandler (Address address);
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned by this model.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  /** Destructor implementation */
+  virtual void DoDispose ();
+
+private:
+  /** A single end of the channel. */
+  struct End
+  {
+    OFSwitch13SocketHandler      *m_handler;  //!< Socket handler.
+    Address                       m_address;  //!< End address.
+    bool                          m_busy;     //!< Transmitting a message.
+  };
+
+  /**
+   * Get the index of the end for this socket handler.
+   * \param handler The socket handler.
+   * \return The end index.
+   */
+  uint8_t GetEnd (const OFSwitch13SocketHandler *handler) const;
+
+  /**
+   * Detach the socket handler from its end of the channel.
+   * \param handler The socket handler.
+   */
+  void Detach (const OFSwitch13SocketHandler *handler);
+
+  /**
+   * Get the address of the other end of the channel.
+   * \param handler The socket handler of this end.
+   * \return The address of the other end.
+   */
+  Address GetPeerAddress (const OFSwitch13SocketHandler *handler) const;
+
+  /**
+   * Check if this end is still transmitting a message.
+   * \param handler The socket handler of this end.
+   * \return True when busy.
+   */
+  bool IsBusy (const OFSwitch13SocketHandler *handler) const;
+
+  /**
+   * Transmit an OpenFlow message to the other end of the channel.
+   * \param handler The socket handler of the sender end.
+   * \param packet The packet with the OpenFlow message.
+   */
+  void Transmit (const OFSwitch13SocketHandler *handler, Ptr<Packet> packet);
+
+  /**
+   * Close the connection, detaching both ends from the channel and
+   * scheduling the close notification to their socket handlers.
+   */
+  void Close (void);
+
+  /**
+   * Notify the sender end that the message serialization is concluded.
+   * \param idx The sender end index.
+   */
+  void TxComplete (uint8_t idx);
+
+  /**
+   * Deliver the OpenFlow message to the receiver end.
+   * \param idx The receiver end index.
+   * \param packet The packet with the OpenFlow message.
+   */
+  void Deliver (uint8_t idx, Ptr<Packet> packet);
+
+  Time                          m_delay;      //!< Propagation delay.
+  DataRate                      m_dataRate;   //!< Channel data rate.
+  double                        m_lossRate;   //!< Message loss probability.
+  Ptr<UniformRandomVariable>    m_lossRng;    //!< Loss random variable.
+  End                           m_ends [2];   //!< Channel ends.
+  uint8_t                       m_nEnds;      //!< Number of created ends.
+
+  /** Trace source fired when a message is discarded by the loss model. */
+  TracedCallback<Ptr<const Packet> > m_dropTrace;
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_DIRECT_CHANNEL_H */
@@ -0,0 +1,742 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "ofswitch13-flow-shadow.h"
+#include "lib/byte-order.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13FlowShadow");
+
+OFSwitch13FlowShadow::OFSwitch13FlowShadow (Time undoTimeout)
+  : m_undoTimeout (undoTimeout),
+  m_recording (false)
+{
+  NS_LOG_FUNCTION (this << undoTimeout);
+}
+
+void
+OFSwitch13FlowShadow::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_flows.clear ();
+  m_groups.clear ();
+  m_meters.clear ();
+  m_undo.clear ();
+}
+
+uint32_t
+OFSwitch13FlowShadow::GetNFlows (void) const
+{
+  return m_flows.size ();
+}
+
+uint32_t
+OFSwitch13FlowShadow::GetNGroups (void) const
+{
+  return m_groups.size ();
+}
+
+uint32_t
+OFSwitch13FlowShadow::GetNMeters (void) const
+{
+  return m_meters.size ();
+}
+
+bool
+OFSwitch13FlowShadow::Update (const uint8_t *data, size_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  if (size < sizeof (struct ofp_header)
+      || ntohs (((const struct ofp_header*)data)->length) != size)
+    {
+      return false;
+    }
+
+  const struct ofp_header *header = (const struct ofp_header*)data;
+  if (header->type != OFPT_FLOW_MOD && header->type != OFPT_GROUP_MOD
+      && header->type != OFPT_METER_MOD)
+    {
+      return false;
+    }
+
+  // Save the state changed by this message, so it can be undone.
+  if (m_undoTimeout.IsStrictlyPositive ())
+    {
+      StartRecord (ntohl (header->xid), false);
+      m_recording = true;
+    }
+
+  bool applied = false;
+  switch (header->type)
+    {
+    case OFPT_FLOW_MOD:
+      applied = UpdateFlow (data, size);
+      break;
+    case OFPT_GROUP_MOD:
+      applied = UpdateGroup (data, size);
+      break;
+    case OFPT_METER_MOD:
+      applied = UpdateMeter (data, size);
+      break;
+    }
+  m_recording = false;
+  return applied;
+}
+
+void
+OFSwitch13FlowShadow::RemoveFlow (const ofs::FlowRemovedView &view)
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<std::string> oxms;
+  const uint8_t *data = view.GetRawData ();
+  const struct ofp_flow_removed *rem = (const struct ofp_flow_removed*)data;
+  if (ParseMatch (&rem->match, data + view.GetLength (), oxms))
+    {
+      // The removed entry can't be restored by undoing earlier messages.
+      std::string key = FlowKey (view.GetTableId (), view.GetPriority (), oxms);
+      m_flows.erase (key);
+      for (UndoList_t::iterator it = m_undo.begin (); it != m_undo.end (); it++)
+        {
+          it->m_flows.erase (key);
+        }
+    }
+}
+
+void
+OFSwitch13FlowShadow::Barrier (uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << xid);
+
+  if (m_undoTimeout.IsStrictlyPositive ())
+    {
+      StartRecord (xid, true);
+    }
+}
+
+void
+OFSwitch13FlowShadow::Confirm (uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << xid);
+
+  for (UndoList_t::iterator it = m_undo.begin (); it != m_undo.end (); it++)
+    {
+      if (it->m_barrier && it->m_xid == xid)
+        {
+          m_undo.erase (m_undo.begin (), ++it);
+          return;
+        }
+    }
+}
+
+bool
+OFSwitch13FlowShadow::Reject (uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << xid);
+
+  UndoList_t::iterator record;
+  for (record = m_undo.begin (); record != m_undo.end (); record++)
+    {
+      if (!record->m_barrier && record->m_xid == xid)
+        {
+          break;
+        }
+    }
+  if (record == m_undo.end ())
+    {
+      return false;
+    }
+
+  // Restore the previous state, unless a later message changed it again.
+  UndoList_t::iterator later;
+  FlowMap_t::iterator flowIt;
+  for (flowIt = record->m_flows.begin ();
+       flowIt != record->m_flows.end (); flowIt++)
+    {
+      for (later = record + 1; later != m_undo.end (); later++)
+        {
+          if (later->m_flows.count (flowIt->first))
+            {
+              break;
+            }
+        }
+      if (later != m_undo.end ())
+        {
+          continue;
+        }
+      if (flowIt->second.m_wire.empty ())
+        {
+          m_flows.erase (flowIt->first);
+        }
+      else
+        {
+          m_flows [flowIt->first] = flowIt->second;
+        }
+    }
+
+  IdMsgMap_t *states[2] = { &m_groups, &m_meters };
+  IdMsgMap_t *saved[2] = { &record->m_groups, &record->m_meters };
+  for (int i = 0; i < 2; i++)
+    {
+      IdMsgMap_t::iterator idIt;
+      for (idIt = saved[i]->begin (); idIt != saved[i]->end (); idIt++)
+        {
+          for (later = record + 1; later != m_undo.end (); later++)
+            {
+              const IdMsgMap_t &laterIds = i ? later->m_meters
+                                             : later->m_groups;
+              if (laterIds.count (idIt->first))
+                {
+                  break;
+                }
+            }
+          if (later != m_undo.end ())
+            {
+              continue;
+            }
+          if (idIt->second.empty ())
+            {
+              states[i]->erase (idIt->first);
+            }
+          else
+            {
+              (*states[i]) [idIt->first] = idIt->second;
+            }
+        }
+    }
+
+  m_undo.erase (record);
+  NS_LOG_DEBUG ("Modification message " << xid << " undone.");
+  return true;
+}
+
+OFSwitch13FlowShadow::MessageList_t
+OFSwitch13FlowShadow::Diff (const OFSwitch13FlowShadow &desired)
+{
+  NS_LOG_FUNCTION (this);
+
+  PurgeExpired ();
+
+  MessageList_t addMsgs;
+  MessageList_t delMsgs;
+
+  // Groups and meters to be added or modified. They share the same layout
+  // for the command field, and the remaining bytes identify the content.
+  const IdMsgMap_t *curMaps[2] = { &m_groups, &m_meters };
+  const IdMsgMap_t *newMaps[2] = { &desired.m_groups, &desired.m_meters };
+  uint16_t addCmds[2] = { OFPGC_ADD, OFPMC_ADD };
+  uint16_t modCmds[2] = { OFPGC_MODIFY, OFPMC_MODIFY };
+  uint16_t delCmds[2] = { OFPGC_DELETE, OFPMC_DELETE };
+  size_t cmdOffset = sizeof (struct ofp_header);
+  size_t bodyOffset = cmdOffset + sizeof (uint16_t);
+  for (int i = 0; i < 2; i++)
+    {
+      IdMsgMap_t::const_iterator it;
+      for (it = newMaps[i]->begin (); it != newMaps[i]->end (); it++)
+        {
+          IdMsgMap_t::const_iterator cur = curMaps[i]->find (it->first);
+          uint16_t command = addCmds[i];
+          if (cur != curMaps[i]->end ())
+            {
+              if (cur->second.size () == it->second.size ()
+                  && !memcmp (cur->second.data () + bodyOffset,
+                              it->second.data () + bodyOffset,
+                              it->second.size () - bodyOffset))
+                {
+                  continue;
+                }
+              command = modCmds[i];
+            }
+          std::vector<uint8_t> msg (it->second);
+          *(uint16_t*)(msg.data () + cmdOffset) = htons (command);
+          addMsgs.push_back (msg);
+        }
+    }
+
+  // Flow entries to be added or modified. When only the instructions differ,
+  // a strict modify preserves the entry counters. Otherwise, a new add
+  // replaces the existing entry with identical match and priority.
+  FlowMap_t::const_iterator it;
+  for (it = desired.m_flows.begin (); it != desired.m_flows.end (); it++)
+    {
+      // Entries that may have silently expired are always installed again.
+      const std::vector<uint8_t> &want = it->second.m_wire;
+      FlowMap_t::const_iterator cur = m_flows.find (it->first);
+      if (cur == m_flows.end () || cur->second.m_silent)
+        {
+          addMsgs.push_back (FlowMsg (want, OFPFC_ADD));
+          continue;
+        }
+
+      const std::vector<uint8_t> &have = cur->second.m_wire;
+      const struct ofp_flow_mod *wantMod =
+        (const struct ofp_flow_mod*)want.data ();
+      const struct ofp_flow_mod *haveMod =
+        (const struct ofp_flow_mod*)have.data ();
+      size_t offset = GetInstructionsOffset (wantMod);
+      bool sameInstructions = want.size () == have.size ()
+        && !memcmp (want.data () + offset, have.data () + offset,
+                    want.size () - offset);
+      bool sameAttributes = wantMod->cookie == haveMod->cookie
+        && wantMod->idle_timeout == haveMod->idle_timeout
+        && wantMod->hard_timeout == haveMod->hard_timeout
+        && wantMod->flags == haveMod->flags;
+      if (!sameAttributes)
+        {
+          addMsgs.push_back (FlowMsg (want, OFPFC_ADD));
+        }
+      else if (!sameInstructions)
+        {
+          addMsgs.push_back (FlowMsg (want, OFPFC_MODIFY_STRICT));
+        }
+    }
+
+  // Flow entries to be deleted.
+  for (it = m_flows.begin (); it != m_flows.end (); it++)
+    {
+      if (desired.m_flows.find (it->first) == desired.m_flows.end ())
+        {
+          delMsgs.push_back (
+            FlowMsg (it->second.m_wire, OFPFC_DELETE_STRICT));
+        }
+    }
+
+  // Groups and meters to be deleted, after the flow entries using them.
+  for (int i = 0; i < 2; i++)
+    {
+      IdMsgMap_t::const_iterator cur;
+      for (cur = curMaps[i]->begin (); cur != curMaps[i]->end (); cur++)
+        {
+          if (newMaps[i]->find (cur->first) == newMaps[i]->end ())
+            {
+              // Both ofp_group_mod and ofp_meter_mod have 16 bytes, with the
+              // group/meter id at the end of the fixed structure.
+              std::vector<uint8_t> msg (cur->second.begin (),
+                                        cur->second.begin () + 16);
+              struct ofp_header *header = (struct ofp_header*)msg.data ();
+              header->length = htons (msg.size ());
+              *(uint16_t*)(msg.data () + cmdOffset) = htons (delCmds[i]);
+              delMsgs.push_back (msg);
+            }
+        }
+    }
+
+  addMsgs.insert (addMsgs.end (), delMsgs.begin (), delMsgs.end ());
+  NS_LOG_DEBUG ("Reconcile diff with " << addMsgs.size () << " messages.");
+  return addMsgs;
+}
+
+bool
+OFSwitch13FlowShadow::UpdateFlow (const uint8_t *data, size_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  const struct ofp_flow_mod *mod = (const struct ofp_flow_mod*)data;
+  std::vector<std::string> oxms;
+  if (size < sizeof (struct ofp_flow_mod)
+      || !ParseMatch (&mod->match, data + size, oxms)
+      || GetInstructionsOffset (mod) > size)
+    {
+      return false;
+    }
+
+  uint8_t tableId = mod->table_id;
+  uint16_t priority = ntohs (mod->priority);
+  uint64_t cookie = ntohll (mod->cookie);
+  uint64_t cookieMask = ntohll (mod->cookie_mask);
+  bool strict = false;
+  switch (mod->command)
+    {
+    case OFPFC_ADD:
+      {
+        if (tableId >= OFPTT_MAX)
+          {
+            return false;
+          }
+
+        // An add replaces any existing entry with identical match/priority.
+        FlowEntry entry;
+        entry.m_wire.assign (data, data + size);
+        entry.m_oxms = oxms;
+        entry.m_expire = Time (0);
+        uint16_t hardTimeout = ntohs (mod->hard_timeout);
+        if (hardTimeout)
+          {
+            entry.m_expire = Simulator::Now () + Seconds (hardTimeout);
+          }
+        entry.m_silent = mod->idle_timeout
+          && !(ntohs (mod->flags) & OFPFF_SEND_FLOW_REM);
+        struct ofp_flow_mod *saved =
+          (struct ofp_flow_mod*)entry.m_wire.data ();
+        saved->buffer_id = htonl (OFP_NO_BUFFER);
+        std::string key = FlowKey (tableId, priority, oxms);
+        SaveFlow (key);
+        m_flows [key] = entry;
+        return true;
+      }
+
+    case OFPFC_MODIFY_STRICT:
+      strict = true;
+    // fall through
+    case OFPFC_MODIFY:
+      {
+        size_t newOffset = GetInstructionsOffset (mod);
+        for (FlowMap_t::iterator it = m_flows.begin ();
+             it != m_flows.end (); it++)
+          {
+            FlowEntry &entry = it->second;
+            struct ofp_flow_mod *saved =
+              (struct ofp_flow_mod*)entry.m_wire.data ();
+            if ((tableId != OFPTT_ALL && saved->table_id != tableId)
+                || ((ntohll (saved->cookie) ^ cookie) & cookieMask)
+                || (strict && (ntohs (saved->priority) != priority
+                               || entry.m_oxms != oxms))
+                || (!strict && !Covers (oxms, entry.m_oxms)))
+              {
+                continue;
+              }
+
+            // Only the instructions are updated by modify commands.
+            SaveFlow (it->first);
+            size_t offset = GetInstructionsOffset (saved);
+            entry.m_wire.resize (offset);
+            entry.m_wire.insert (entry.m_wire.end (),
+                                 data + newOffset, data + size);
+            struct ofp_header *header =
+              (struct ofp_header*)entry.m_wire.data ();
+            header->length = htons (entry.m_wire.size ());
+          }
+        return true;
+      }
+
+    case OFPFC_DELETE_STRICT:
+      strict = true;
+    // fall through
+    case OFPFC_DELETE:
+      {
+        if (strict && tableId != OFPTT_ALL && cookieMask == 0)
+          {
+            // Fast path for the common case.
+            std::string key = FlowKey (tableId, priority, oxms);
+            SaveFlow (key);
+            m_flows.erase (key);
+            return true;
+          }
+
+        FlowMap_t::iterator it = m_flows.begin ();
+        while (it != m_flows.end ())
+          {
+            const FlowEntry &entry = it->second;
+            const struct ofp_flow_mod *saved =
+              (const struct ofp_flow_mod*)entry.m_wire.data ();
+            if ((tableId != OFPTT_ALL && saved->table_id != tableId)
+                || ((ntohll (saved->cookie) ^ cookie) & cookieMask)
+                || (strict && (ntohs (saved->priority) != priority
+                               || entry.m_oxms != oxms))
+                || (!strict && !Covers (oxms, entry.m_oxms)))
+              {
+                it++;
+                continue;
+              }
+            SaveFlow (it->first);
+            m_flows.erase (it++);
+          }
+        return true;
+      }
+
+    default:
+      return false;
+    }
+}
+
+bool
+OFSwitch13FlowShadow::UpdateGroup (const uint8_t *data, size_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  if (size < sizeof (struct ofp_group_mod))
+    {
+      return false;
+    }
+
+  const struct ofp_group_mod *mod = (const struct ofp_group_mod*)data;
+  uint32_t groupId = ntohl (mod->group_id);
+  switch (ntohs (mod->command))
+    {
+    case OFPGC_ADD:
+      // The switch refuses to add an existing group.
+      SaveId (m_groups, groupId);
+      m_groups.insert (
+        std::make_pair (groupId, std::vector<uint8_t> (data, data + size)));
+      return true;
+
+    case OFPGC_MODIFY:
+      {
+        IdMsgMap_t::iterator it = m_groups.find (groupId);
+        if (it != m_groups.end ())
+          {
+            SaveId (m_groups, groupId);
+            it->second.assign (data, data + size);
+          }
+        return true;
+      }
+
+    case OFPGC_DELETE:
+      if (groupId == OFPG_ALL)
+        {
+          for (IdMsgMap_t::iterator it = m_groups.begin ();
+               it != m_groups.end (); it++)
+            {
+              SaveId (m_groups, it->first);
+            }
+          m_groups.clear ();
+        }
+      else
+        {
+          SaveId (m_groups, groupId);
+          m_groups.erase (groupId);
+        }
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+bool
+OFSwitch13FlowShadow::UpdateMeter (const uint8_t *data, size_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  if (size < sizeof (struct ofp_meter_mod))
+    {
+      return false;
+    }
+
+  const struct ofp_meter_mod *mod = (const struct ofp_meter_mod*)data;
+  uint32_t meterId = ntohl (mod->meter_id);
+  switch (ntohs (mod->command))
+    {
+    case OFPMC_ADD:
+      // The switch refuses to add an existing meter.
+      SaveId (m_meters, meterId);
+      m_meters.insert (
+        std::make_pair (meterId, std::vector<uint8_t> (data, data + size)));
+      return true;
+
+    case OFPMC_MODIFY:
+      {
+        IdMsgMap_t::iterator it = m_meters.find (meterId);
+        if (it != m_meters.end ())
+          {
+            SaveId (m_meters, meterId);
+            it->second.assign (data, data + size);
+          }
+        return true;
+      }
+
+    case OFPMC_DELETE:
+      if (meterId == OFPM_ALL)
+        {
+          for (IdMsgMap_t::iterator it = m_meters.begin ();
+               it != m_meters.end (); it++)
+            {
+              SaveId (m_meters, it->first);
+            }
+          m_meters.clear ();
+        }
+      else
+        {
+          SaveId (m_meters, meterId);
+          m_meters.erase (meterId);
+        }
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+void
+OFSwitch13FlowShadow::PurgeExpired (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  FlowMap_t::iterator it = m_flows.begin ();
+  while (it != m_flows.end ())
+    {
+      if (!it->second.m_expire.IsZero () && it->second.m_expire <= now)
+        {
+          m_flows.erase (it++);
+        }
+      else
+        {
+          it++;
+        }
+    }
+}
+
+void
+OFSwitch13FlowShadow::StartRecord (uint32_t xid, bool barrier)
+{
+  NS_LOG_FUNCTION (this << xid << barrier);
+
+  // Messages not rejected within the undo timeout are assumed accepted.
+  Time now = Simulator::Now ();
+  while (!m_undo.empty () && m_undo.front ().m_time + m_undoTimeout < now)
+    {
+      m_undo.pop_front ();
+    }
+
+  m_undo.push_back (UndoRecord ());
+  m_undo.back ().m_xid = xid;
+  m_undo.back ().m_time = now;
+  m_undo.back ().m_barrier = barrier;
+}
+
+void
+OFSwitch13FlowShadow::SaveFlow (const std::string &key)
+{
+  if (!m_recording)
+    {
+      return;
+    }
+
+  FlowMap_t &saved = m_undo.back ().m_flows;
+  if (saved.find (key) == saved.end ())
+    {
+      FlowMap_t::const_iterator it = m_flows.find (key);
+      if (it != m_flows.end ())
+        {
+          saved [key] = it->second;
+        }
+      else
+        {
+          FlowEntry absent;
+          absent.m_silent = false;
+          saved [key] = absent;
+        }
+    }
+}
+
+void
+OFSwitch13FlowShadow::SaveId (const IdMsgMap_t &state, uint32_t id)
+{
+  if (!m_recording)
+    {
+      return;
+    }
+
+  IdMsgMap_t &saved = (&state == &m_groups) ? m_undo.back ().m_groups
+    : m_undo.back ().m_meters;
+  if (saved.find (id) == saved.end ())
+    {
+      IdMsgMap_t::const_iterator it = state.find (id);
+      saved [id] = (it != state.end ()) ? it->second : std::vector<uint8_t> ();
+    }
+}
+
+bool
+OFSwitch13FlowShadow::ParseMatch (const struct ofp_match *match,
+                                  const uint8_t *end,
+                                  std::vector<std::string> &oxms)
+{
+  const uint8_t *tlv = match->oxm_fields;
+  const uint8_t *matchEnd = (const uint8_t*)match + ntohs (match->length);
+  if (matchEnd > end)
+    {
+      return false;
+    }
+
+  oxms.clear ();
+  while (tlv + sizeof (uint32_t) <= matchEnd)
+    {
+      uint32_t header = ntohl (*(const uint32_t*)tlv);
+      size_t tlvSize = sizeof (uint32_t) + OXM_LENGTH (header);
+      if (tlv + tlvSize > matchEnd)
+        {
+          return false;
+        }
+      oxms.push_back (std::string ((const char*)tlv, tlvSize));
+      tlv += tlvSize;
+    }
+  std::sort (oxms.begin (), oxms.end ());
+  return true;
+}
+
+std::string
+OFSwitch13FlowShadow::FlowKey (uint8_t tableId, uint16_t priority,
+                               const std::vector<std::string> &oxms)
+{
+  std::string key;
+  key.push_back ((char)tableId);
+  key.push_back ((char)(priority >> 8));
+  key.push_back ((char)(priority & 0xff));
+  for (size_t i = 0; i < oxms.size (); i++)
+    {
+      key.append (oxms [i]);
+    }
+  return key;
+}
+
+bool
+OFSwitch13FlowShadow::Covers (const std::vector<std::string> &filter,
+                              const std::vector<std::string> &oxms)
+{
+  return std::includes (oxms.begin (), oxms.end (),
+                        filter.begin (), filter.end ());
+}
+
+size_t
+OFSwitch13FlowShadow::GetInstructionsOffset (const struct ofp_flow_mod *mod)
+{
+  return offsetof (struct ofp_flow_mod, match)
+         + (ntohs (mod->match.length) + 7) / 8 * 8;
+}
+
+std::vector<uint8_t>
+OFSwitch13FlowShadow::FlowMsg (const std::vector<uint8_t> &wire,
+                               uint8_t command)
+{
+  std::vector<uint8_t> msg (wire);
+  struct ofp_flow_mod *mod = (struct ofp_flow_mod*)msg.data ();
+  mod->command = command;
+  mod->buffer_id = htonl (OFP_NO_BUFFER);
+  if (command == OFPFC_DELETE_STRICT)
+    {
+      // Delete commands carry no instructions and no output filters.
+      msg.resize (GetInstructionsOffset (mod));
+      mod = (struct ofp_flow_mod*)msg.data ();
+      mod->cookie_mask = 0;
+      mod->out_port = htonl (OFPP_ANY);
+      mod->out_group = htonl (OFPG_ANY);
+    }
+  mod->header.length = htons (msg.size ());
+  return msg;
+}
+
+} // namespace ns3
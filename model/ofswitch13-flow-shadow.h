@@ -0,0 +1,258 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_FLOW_SHADOW_H
+#define OFSWITCH13_FLOW_SHADOW_H
+
+#include <ns3/nstime.h>
+#include "ofswitch13-interface.h"
+#include "ofswitch13-message-view.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ * Controller-side mirror of the flow entries, groups, and meters installed
+ * into a single OpenFlow switch. The mirror is updated from the modification
+ * messages sent by the controller (in wire format) and from the flow removed
+ * messages received from the switch. Given a desired state (another mirror),
+ * the Diff () method computes the minimal set of add, modify, and delete
+ * messages that takes the switch from the current state to the desired one.
+ *
+ * Flow entries are identified by their table id, priority, and match fields,
+ * just as the OpenFlow strict semantics. OXM match fields are sorted before
+ * building the flow identification, so the order of fields in the match does
+ * not matter.
+ *
+ * Flow entries with idle timeout but without the OFPFF_SEND_FLOW_REM flag may
+ * silently expire at the switch, so they are always installed again by the
+ * Diff () method. When the undo timeout is set, the mirror also keeps the
+ * previous state changed by each modification message, so messages rejected
+ * by the switch with an error can be undone. This information is released
+ * when a later barrier reply confirms the message, or after the undo timeout.
+ *
+ * \attention This is a best-effort mirror: non-strict modify and delete
+ * commands are applied only to flow entries whose match includes all the
+ * fields in the command match (no mask subsumption is evaluated), and the
+ * out_port and out_group filters are ignored.
+ */
+class OFSwitch13FlowShadow : public SimpleRefCount<OFSwitch13FlowShadow>
+{
+public:
+  /** List of OpenFlow messages in wire format. */
+  typedef std::vector<std::vector<uint8_t> > MessageList_t;
+
+  /**
+   * Complete constructor.
+   * \param undoTimeout How long to keep the information required to undo
+   *        modification messages rejected by the switch (zero to disable).
+   */
+  OFSwitch13FlowShadow (Time undoTimeout = Time (0));
+
+  /**
+   * Remove all flow entries, groups, and meters from this mirror.
+   */
+  void Clear (void);
+
+  /**
+   * \name Mirror size accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint32_t GetNFlows  (void) const;
+  uint32_t GetNGroups (void) const;
+  uint32_t GetNMeters (void) const;
+  //\}
+
+  /**
+   * Apply a modification message to this mirror. Only OFPT_FLOW_MOD,
+   * OFPT_GROUP_MOD, and OFPT_METER_MOD messages are considered.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \return true if the message was applied, false otherwise.
+   */
+  bool Update (const uint8_t *data, size_t size);
+
+  /**
+   * Remove the flow entry notified by a flow removed message.
+   * \param view The flow removed message view.
+   */
+  void RemoveFlow (const ofs::FlowRemovedView &view);
+
+  /**
+   * Notify a barrier request sent to the switch.
+   * \param xid The barrier request transaction id.
+   */
+  void Barrier (uint32_t xid);
+
+  /**
+   * Notify a barrier reply received from the switch. The modification
+   * messages sent before the barrier request were accepted by the switch, so
+   * they can't be undone anymore.
+   * \param xid The barrier reply transaction id.
+   */
+  void Confirm (uint32_t xid);
+
+  /**
+   * Undo the modification message rejected by the switch. Flow entries,
+   * groups, and meters changed again by later messages are kept.
+   * \param xid The error message transaction id.
+   * \return true if the message was undone, false otherwise.
+   */
+  bool Reject (uint32_t xid);
+
+  /**
+   * Compute the minimal set of modification messages that takes the switch
+   * from this state to the desired one. Messages are ordered to respect
+   * dependencies: groups and meters are added before the flow entries that
+   * may refer to them, and deleted after them. The transaction id is not set.
+   * \param desired The desired state.
+   * \return The list of modification messages in wire format.
+   */
+  MessageList_t Diff (const OFSwitch13FlowShadow &desired);
+
+private:
+  /** A single mirrored flow entry. */
+  struct FlowEntry
+  {
+    std::vector<uint8_t>      m_wire;     //!< Flow-mod message bytes.
+    std::vector<std::string>  m_oxms;     //!< Sorted match OXM TLVs.
+    Time                      m_expire;   //!< Hard timeout expiration.
+    bool                      m_silent;   //!< Silent idle timeout.
+  };
+
+  /** Map saving flow entries by flow identification */
+  typedef std::map<std::string, FlowEntry> FlowMap_t;
+
+  /** Map saving group-mod or meter-mod message bytes by group/meter id */
+  typedef std::map<uint32_t, std::vector<uint8_t> > IdMsgMap_t;
+
+  /** The state changed by a modification message, or a barrier marker. */
+  struct UndoRecord
+  {
+    uint32_t    m_xid;      //!< Message transaction id.
+    Time        m_time;     //!< Time the message was applied.
+    bool        m_barrier;  //!< Barrier request marker.
+    FlowMap_t   m_flows;    //!< Previous flow entries (empty when absent).
+    IdMsgMap_t  m_groups;   //!< Previous groups (empty when absent).
+    IdMsgMap_t  m_meters;   //!< Previous meters (empty when absent).
+  };
+
+  /** List of undo records in the order of messages sent to the switch. */
+  typedef std::deque<UndoRecord> UndoList_t;
+
+  /**
+   * \name Modification message handlers.
+   * \param data The message in wire format.
+   * \param size The message size.
+   * \return true if the message was applied, false otherwise.
+   */
+  //\{
+  bool UpdateFlow  (const uint8_t *data, size_t size);
+  bool UpdateGroup (const uint8_t *data, size_t size);
+  bool UpdateMeter (const uint8_t *data, size_t size);
+  //\}
+
+  /**
+   * Remove flow entries whose hard timeout already expired.
+   */
+  void PurgeExpired (void);
+
+  /**
+   * Start a new undo record, releasing the ones older than the undo timeout.
+   * \param xid The message transaction id.
+   * \param barrier True for a barrier marker.
+   */
+  void StartRecord (uint32_t xid, bool barrier);
+
+  /**
+   * Save the current state of a flow entry into the undo record of the
+   * message being applied, if not saved yet.
+   * \param key The flow key.
+   */
+  void SaveFlow (const std::string &key);
+
+  /**
+   * Save the current state of a group or meter into the undo record of the
+   * message being applied, if not saved yet.
+   * \param state The current groups or meters.
+   * \param id The group or meter id.
+   */
+  void SaveId (const IdMsgMap_t &state, uint32_t id);
+
+  /**
+   * Parse the OXM TLVs from a wire format ofp_match structure.
+   * \param match The pointer to the ofp_match structure.
+   * \param end The pointer to the end of the message.
+   * \param oxms The sorted list of OXM TLVs (output).
+   * \return true if the match is well formed, false otherwise.
+   */
+  static bool ParseMatch (const struct ofp_match *match, const uint8_t *end,
+                          std::vector<std::string> &oxms);
+
+  /**
+   * Build the flow identification key.
+   * \param tableId The table id.
+   * \param priority The flow priority.
+   * \param oxms The sorted list of OXM TLVs.
+   * \return The flow key.
+   */
+  static std::string FlowKey (uint8_t tableId, uint16_t priority,
+                              const std::vector<std::string> &oxms);
+
+  /**
+   * Check if the list of OXM TLVs includes all the filter TLVs.
+   * \param filter The sorted filter OXM TLVs.
+   * \param oxms The sorted flow entry OXM TLVs.
+   * \return true when all filter TLVs are present, false otherwise.
+   */
+  static bool Covers (const std::vector<std::string> &filter,
+                      const std::vector<std::string> &oxms);
+
+  /**
+   * Get the offset of the instructions in a flow-mod message.
+   * \param mod The flow-mod message.
+   * \return The instructions offset.
+   */
+  static size_t GetInstructionsOffset (const struct ofp_flow_mod *mod);
+
+  /**
+   * Create a copy of a flow-mod message with another command.
+   * \param wire The flow-mod message bytes.
+   * \param command The new command.
+   * \return The new flow-mod message bytes.
+   */
+  static std::vector<uint8_t> FlowMsg (const std::vector<uint8_t> &wire,
+                                       uint8_t command);
+
+  FlowMap_t   m_flows;        //!< Mirrored flow entries.
+  IdMsgMap_t  m_groups;       //!< Mirrored groups.
+  IdMsgMap_t  m_meters;       //!< Mirrored meters.
+  UndoList_t  m_undo;         //!< Undo records.
+  Time        m_undoTimeout;  //!< Undo records lifetime.
+  bool        m_recording;    //!< Saving changes into the last record.
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_FLOW_SHADOW_H */
@@ -85,16 +85,13 @@ PacketFromMsg (struct ofl_msg_header *msg, uint32_t xid)
   uint8_t *buf;
   size_t buf_size;
   Ptr<Packet> packet;
-  struct ofpbuf *buffer;
 
-  buffer = ofpbuf_new (0);
+  // Create the packet directly from the packed bytes, with a single copy.
   error = ofl_msg_pack (msg, xid, &buf, &buf_size, 0);
   if (!error)
     {
-      ofpbuf_use (buffer, buf, buf_size);
-      ofpbuf_put_uninit (buffer, buf_size);
-      packet = Create<Packet> ((uint8_t*)buffer->data, buffer->size);
-      ofpbuf_delete (buffer);
+      packet = Create<Packet> (buf, buf_size);
+      free (buf);
     }
   return packet;
 }
@@ -107,6 +104,64 @@ PacketFromBuffer (struct ofpbuf *buffer)
   return Create<Packet> ((uint8_t*)buffer->data, buffer->size);
 }
 
+MessageTemplate::MessageTemplate (struct ofl_msg_header *msg)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint8_t *buf;
+  size_t buf_size;
+  if (!ofl_msg_pack (msg, 0, &buf, &buf_size, 0))
+    {
+      m_wire.assign (buf, buf + buf_size);
+      free (buf);
+    }
+}
+
+bool
+MessageTemplate::IsValid (void) const
+{
+  return m_wire.size () >= sizeof (struct ofp_header);
+}
+
+uint8_t
+MessageTemplate::GetType (void) const
+{
+  NS_ASSERT_MSG (IsValid (), "Invalid message template.");
+  return ((const struct ofp_header*)m_wire.data ())->type;
+}
+
+size_t
+MessageTemplate::GetSize (void) const
+{
+  return m_wire.size ();
+}
+
+void
+MessageTemplate::SetBufferId (uint32_t value)
+{
+  NS_ASSERT_MSG (IsValid () && GetType () == OFPT_PACKET_OUT,
+                 "Not a packet-out message template.");
+  ((struct ofp_packet_out*)m_wire.data ())->buffer_id = htonl (value);
+}
+
+void
+MessageTemplate::SetInPort (uint32_t value)
+{
+  NS_ASSERT_MSG (IsValid () && GetType () == OFPT_PACKET_OUT,
+                 "Not a packet-out message template.");
+  ((struct ofp_packet_out*)m_wire.data ())->in_port = htonl (value);
+}
+
+Ptr<Packet>
+MessageTemplate::CreatePacket (uint32_t xid)
+{
+  NS_LOG_FUNCTION (this << xid);
+
+  NS_ASSERT_MSG (IsValid (), "Invalid message template.");
+  ((struct ofp_header*)m_wire.data ())->xid = htonl (xid);
+  return Create<Packet> (m_wire.data (), m_wire.size ());
+}
+
 } // namespace ofs
 } // namespace ns3
 
@@ -167,6 +222,6 @@ dpctl_transact_and_print (struct vconn *vconn, struct ofl_msg_header *req,
   // Different from ofsoftswitch13 dpctl, this transaction doesn't wait for a
   // reply, as ns-3 socket library doesn't provide blocking sockets. So, we
   // send the request and return. The reply will came later, using the ns-3
-  // callback mechanism.
+  // callback mechanism (see OFSwitch13Controller::DpctlRequest).
   OFSwitch13Controller::DpctlSendAndPrint (vconn, req);
 }
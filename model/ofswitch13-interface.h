@@ -32,6 +32,7 @@
 #define OFSWITCH13_INTERFACE_H
 
 #include <cassert>
+#include <vector>
 
 #include <ns3/simulator.h>
 #include <ns3/log.h>
@@ -141,6 +142,108 @@ Ptr<Packet> PacketFromMsg (struct ofl_msg_header *msg, uint32_t xid = 0);
  */
 Ptr<Packet> PacketFromBuffer (struct ofpbuf *buffer);
 
+/**
+ * \ingroup ofswitch13
+ * Reusable OpenFlow message in wire format. The OFLib message is packed only
+ * once at construction time, and the wire bytes are reused every time a new
+ * ns3::Packet is created from this template. Before creating each packet,
+ * only the transaction id (and the buffer id and input port for packet-out
+ * messages) are patched into the wire bytes. This is useful for repetitive
+ * messages (echo and barrier requests, packet-outs with identical actions),
+ * as it avoids packing the same message over and over again.
+ */
+class MessageTemplate : public SimpleRefCount<MessageTemplate>
+{
+public:
+  /**
+   * Complete constructor. Pack the OFLib message into wire format.
+   * \param msg The OFLib message structure.
+   */
+  MessageTemplate (struct ofl_msg_header *msg);
+
+  /**
+   * Check for a successfully packed message.
+   * \return true when valid, false otherwise.
+   */
+  bool IsValid (void) const;
+
+  /**
+   * \return The OpenFlow message type (one of OFPT_*).
+   */
+  uint8_t GetType (void) const;
+
+  /**
+   * \return The wire message size.
+   */
+  size_t GetSize (void) const;
+
+  /**
+   * \name Packet-out fields patching.
+   * \attention Only valid for OFPT_PACKET_OUT message templates.
+   * \param value The value to set.
+   */
+  //\{
+  void SetBufferId (uint32_t value);
+  void SetInPort (uint32_t value);
+  //\}
+
+  /**
+   * Patch the transaction id and create a new ns3::Packet from the wire
+   * bytes, with a single copy.
+   * \param xid The transaction id to use.
+   * \return The ns3::Packet created.
+   */
+  Ptr<Packet> CreatePacket (uint32_t xid);
+
+private:
+  std::vector<uint8_t> m_wire;  //!< Packed message bytes.
+};
+
+/**
+ * \ingroup ofswitch13
+ * \name OFSwitch13 experimenter multipart messages.
+ * The rate statistics of switch ports and queues, estimated by the
+ * OFSwitch13RateEstimator, are available through an OFPMP_EXPERIMENTER
+ * multipart request with the OFS13_EXPERIMENTER_ID experimenter id and the
+ * OFS13_EXP_RATE_STATS experimenter type. The request body (after the
+ * ofp_experimenter_multipart_header) is an optional ofs13_rate_stats_request,
+ * and the reply body is an array of ofs13_rate_stats. All fields are in
+ * network byte order.
+ */
+//\{
+const uint32_t OFS13_EXPERIMENTER_ID = 0x004E5333;  //!< Experimenter id.
+const uint32_t OFS13_EXP_RATE_STATS = 1;            //!< Rate stats type.
+
+/** Direction of the rate statistics entry. */
+enum ofs13_rate_direction
+{
+  OFS13_RATE_RX = 0,  //!< Packets received at the port.
+  OFS13_RATE_TX = 1   //!< Packets transmitted by the port or queue.
+};
+
+/** Body of the rate statistics request. */
+struct ofs13_rate_stats_request
+{
+  uint32_t port_no;         //!< Port number, or OFPP_ANY for all ports.
+  uint8_t pad[4];           //!< Align to 64 bits.
+};
+BOOST_STATIC_ASSERT (sizeof (struct ofs13_rate_stats_request) == 8);
+
+/** Body of the rate statistics reply (one entry per port or queue). */
+struct ofs13_rate_stats
+{
+  uint32_t port_no;         //!< Port number.
+  uint32_t queue_id;        //!< Queue id, or OFPQ_ALL for port entries.
+  uint8_t direction;        //!< One of OFS13_RATE_*.
+  uint8_t pad[7];           //!< Align to 64 bits.
+  uint64_t bit_rate;        //!< EWMA bit rate (bps).
+  uint64_t peak_bit_rate;   //!< Peak bit rate (bps).
+  uint64_t packet_rate;     //!< EWMA packet rate (1/1000 pps).
+  uint64_t drop_rate;       //!< EWMA drop rate (1/1000 pps).
+};
+BOOST_STATIC_ASSERT (sizeof (struct ofs13_rate_stats) == 48);
+//\}
+
 } // namespace ofs
 } // namespace ns3
 #endif /* OFSWITCH13_INTERFACE_H */
@@ -64,9 +64,6 @@ OFSwitch13LearningController::HandlePacketIn (
 {
   NS_LOG_FUNCTION (this << swtch << xid);
 
-  static int prio = 100;
-  uint32_t outPort = OFPP_FLOOD;
-  uint64_t dpId = swtch->GetDpId ();
   enum ofp_packet_in_reason reason = msg->reason;
 
   char *msgStr =
@@ -93,91 +90,8 @@ OFSwitch13LearningController::HandlePacketIn (
         oxm_match_lookup (OXM_OF_ETH_DST, (struct ofl_match*)msg->match);
       dst48.CopyFrom (ethDst->value);
 
-      // Get L2Table for this datapath
-      DatapathMap_t::iterator it = m_learnedInfo.find (dpId);
-      if (it != m_learnedInfo.end ())
-        {
-          L2Table_t *l2Table = &it->second;
-
-          // Looking for out port based on dst address (except for broadcast)
-          if (!dst48.IsBroadcast ())
-            {
-              L2Table_t::iterator itDst = l2Table->find (dst48);
-              if (itDst != l2Table->end ())
-                {
-                  outPort = itDst->second;
-                }
-              else
-                {
-                  NS_LOG_DEBUG ("No L2 info for mac " << dst48 << ". Flood.");
-                }
-            }
-
-          // Learning port from source address
-          NS_ASSERT_MSG (!src48.IsBroadcast (), "Invalid src broadcast addr");
-          L2Table_t::iterator itSrc = l2Table->find (src48);
-          if (itSrc == l2Table->end ())
-            {
-              std::pair <L2Table_t::iterator, bool> ret;
-              ret = l2Table->insert (
-                  std::pair<Mac48Address, uint32_t> (src48, inPort));
-              if (ret.second == false)
-                {
-                  NS_LOG_ERROR ("Can't insert mac48address / port pair");
-                }
-              else
-                {
-                  NS_LOG_DEBUG ("Learning that mac " << src48 <<
-                                " can be found at port " << inPort);
-
-                  // Send a flow-mod to switch creating this flow. Let's
-                  // configure the flow entry to 10s idle timeout and to
-                  // notify the controller when flow expires. (flags=0x0001)
-                  std::ostringstream cmd;
-                  cmd << "flow-mod cmd=add,table=0,idle=10,flags=0x0001"
-                      << ",prio=" << ++prio << " eth_dst=" << src48
-                      << " apply:output=" << inPort;
-                  DpctlExecute (swtch, cmd.str ());
-                }
-            }
-          else
-            {
-              NS_ASSERT_MSG (itSrc->second == inPort,
-                             "Inconsistent L2 switching table");
-            }
-        }
-      else
-        {
-          NS_LOG_ERROR ("No L2 table for this datapath id " << dpId);
-        }
-
-      // Lets send the packet out to switch.
-      struct ofl_msg_packet_out reply;
-      reply.header.type = OFPT_PACKET_OUT;
-      reply.buffer_id = msg->buffer_id;
-      reply.in_port = inPort;
-      reply.data_length = 0;
-      reply.data = 0;
-
-      if (msg->buffer_id == NO_BUFFER)
-        {
-          // No packet buffer. Send data back to switch
-          reply.data_length = msg->data_length;
-          reply.data = msg->data;
-        }
-
-      // Create output action
-      struct ofl_action_output *a =
-        (struct ofl_action_output*)xmalloc (sizeof (struct ofl_action_output));
-      a->header.type = OFPAT_OUTPUT;
-      a->port = outPort;
-      a->max_len = 0;
-
-      reply.actions_num = 1;
-      reply.actions = (struct ofl_action_header**)&a;
-
-      SendToSwitch (swtch, (struct ofl_msg_header*)&reply, xid);
-      free (a);
+      LearnAndForward (swtch, xid, inPort, src48, dst48, msg->buffer_id,
+                       msg->data, msg->data_length);
     }
   else
     {
@@ -189,6 +103,39 @@ OFSwitch13LearningController::HandlePacketIn (
   return 0;
 }
 
+bool
+OFSwitch13LearningController::HandlePacketInView (
+  const ofs::PacketInView &view, Ptr<const RemoteSwitch> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch << view.GetXid ());
+
+  if (view.GetReason () != OFPR_NO_MATCH)
+    {
+      return false;
+    }
+
+  // Let's get necessary information (input port and mac address) directly
+  // from the match in wire format. Fall back to the regular handler if any
+  // of them is missing.
+  const uint8_t *ethSrc = view.LookupOxm (OXM_OF_ETH_SRC);
+  const uint8_t *ethDst = view.LookupOxm (OXM_OF_ETH_DST);
+  uint32_t inPort = view.GetInPort ();
+  if (!inPort || !ethSrc || !ethDst)
+    {
+      return false;
+    }
+
+  Mac48Address src48;
+  src48.CopyFrom (ethSrc);
+  Mac48Address dst48;
+  dst48.CopyFrom (ethDst);
+
+  LearnAndForward (swtch, view.GetXid (), inPort, src48, dst48,
+                   view.GetBufferId (), view.GetData (),
+                   view.GetDataLength ());
+  return true;
+}
+
 ofl_err
 OFSwitch13LearningController::HandleFlowRemoved (
   struct ofl_msg_flow_removed *msg, Ptr<const RemoteSwitch> swtch,
@@ -249,5 +196,104 @@ OFSwitch13LearningController::HandshakeSuccessful (
     }
 }
 
+void
+OFSwitch13LearningController::LearnAndForward (
+  Ptr<const RemoteSwitch> swtch, uint32_t xid, uint32_t inPort,
+  Mac48Address src48, Mac48Address dst48, uint32_t bufferId,
+  const uint8_t *data, size_t dataLength)
+{
+  NS_LOG_FUNCTION (this << swtch << xid << inPort << src48 << dst48);
+
+  static int prio = 100;
+  uint32_t outPort = OFPP_FLOOD;
+  uint64_t dpId = swtch->GetDpId ();
+
+  // Get L2Table for this datapath
+  DatapathMap_t::iterator it = m_learnedInfo.find (dpId);
+  if (it != m_learnedInfo.end ())
+    {
+      L2Table_t *l2Table = &it->second;
+
+      // Looking for out port based on dst address (except for broadcast)
+      if (!dst48.IsBroadcast ())
+        {
+          L2Table_t::iterator itDst = l2Table->find (dst48);
+          if (itDst != l2Table->end ())
+            {
+              outPort = itDst->second;
+            }
+          else
+            {
+              NS_LOG_DEBUG ("No L2 info for mac " << dst48 << ". Flood.");
+            }
+        }
+
+      // Learning port from source address
+      NS_ASSERT_MSG (!src48.IsBroadcast (), "Invalid src broadcast addr");
+      L2Table_t::iterator itSrc = l2Table->find (src48);
+      if (itSrc == l2Table->end ())
+        {
+          std::pair <L2Table_t::iterator, bool> ret;
+          ret = l2Table->insert (
+              std::pair<Mac48Address, uint32_t> (src48, inPort));
+          if (ret.second == false)
+            {
+              NS_LOG_ERROR ("Can't insert mac48address / port pair");
+            }
+          else
+            {
+              NS_LOG_DEBUG ("Learning that mac " << src48 <<
+                            " can be found at port " << inPort);
+
+              // Send a flow-mod to switch creating this flow. Let's
+              // configure the flow entry to 10s idle timeout and to
+              // notify the controller when flow expires. (flags=0x0001)
+              std::ostringstream cmd;
+              cmd << "flow-mod cmd=add,table=0,idle=10,flags=0x0001"
+                  << ",prio=" << ++prio << " eth_dst=" << src48
+                  << " apply:output=" << inPort;
+              DpctlExecute (swtch, cmd.str ());
+            }
+        }
+      else
+        {
+          NS_ASSERT_MSG (itSrc->second == inPort,
+                         "Inconsistent L2 switching table");
+        }
+    }
+  else
+    {
+      NS_LOG_ERROR ("No L2 table for this datapath id " << dpId);
+    }
+
+  // Lets send the packet out to switch.
+  struct ofl_msg_packet_out reply;
+  reply.header.type = OFPT_PACKET_OUT;
+  reply.buffer_id = bufferId;
+  reply.in_port = inPort;
+  reply.data_length = 0;
+  reply.data = 0;
+
+  if (bufferId == NO_BUFFER)
+    {
+      // No packet buffer. Send data back to switch
+      reply.data_length = dataLength;
+      reply.data = (uint8_t*)data;
+    }
+
+  // Create output action
+  struct ofl_action_output *a =
+    (struct ofl_action_output*)xmalloc (sizeof (struct ofl_action_output));
+  a->header.type = OFPAT_OUTPUT;
+  a->port = outPort;
+  a->max_len = 0;
+
+  reply.actions_num = 1;
+  reply.actions = (struct ofl_action_header**)&a;
+
+  SendToSwitch (swtch, (struct ofl_msg_header*)&reply, xid);
+  free (a);
+}
+
 } // namespace ns3
 #endif // NS3_OFSWITCH13
@@ -68,11 +68,42 @@ public:
     struct ofl_msg_flow_removed *msg, Ptr<const RemoteSwitch> swtch,
     uint32_t xid);
 
+  /**
+   * Handle packet-in messages directly from wire format, avoiding the message
+   * decoding overhead. Only table-miss packets are handled here, other ones
+   * are handled by HandlePacketIn ().
+   *
+   * \param view The packet-in message view.
+   * \param swtch The switch information.
+   * \return true if the message was handled, false otherwise.
+   */
+  bool HandlePacketInView (
+    const ofs::PacketInView &view, Ptr<const RemoteSwitch> swtch);
+
 protected:
   // Inherited from OFSwitch13Controller
   void HandshakeSuccessful (Ptr<const RemoteSwitch> swtch);
 
 private:
+  /**
+   * Learn the input port for the source MAC address, installing the
+   * corresponding flow entry into the switch, and send the packet-out message
+   * back to the switch, forwarding the packet to the learned output port.
+   *
+   * \param swtch The switch information.
+   * \param xid Transaction id.
+   * \param inPort The packet input port.
+   * \param src48 The packet source MAC address.
+   * \param dst48 The packet destination MAC address.
+   * \param bufferId The packet buffer id at the switch.
+   * \param data The packet data (used only when not buffered).
+   * \param dataLength The packet data length.
+   */
+  void LearnAndForward (Ptr<const RemoteSwitch> swtch, uint32_t xid,
+                        uint32_t inPort, Mac48Address src48,
+                        Mac48Address dst48, uint32_t bufferId,
+                        const uint8_t *data, size_t dataLength);
+
   /** Map saving <IPv4 address / MAC address> */
   typedef std::map<Ipv4Address, Mac48Address> IpMacMap_t;
   IpMacMap_t m_arpTable; //!< ARP resolution table.
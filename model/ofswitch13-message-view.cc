@@ -0,0 +1,516 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include <cstddef>
+#include "ofswitch13-message-view.h"
+#include "lib/byte-order.h"
+
+namespace ns3 {
+namespace ofs {
+
+MessageView::MessageView (const uint8_t *data, size_t size)
+  : m_data (data),
+  m_size (size)
+{
+}
+
+bool
+MessageView::IsValid (void) const
+{
+  return m_data && m_size >= sizeof (struct ofp_header)
+         && GetLength () <= m_size;
+}
+
+uint8_t
+MessageView::GetVersion (void) const
+{
+  return ((const struct ofp_header*)m_data)->version;
+}
+
+uint8_t
+MessageView::GetType (void) const
+{
+  return ((const struct ofp_header*)m_data)->type;
+}
+
+uint16_t
+MessageView::GetLength (void) const
+{
+  return ntohs (((const struct ofp_header*)m_data)->length);
+}
+
+uint32_t
+MessageView::GetXid (void) const
+{
+  return ntohl (((const struct ofp_header*)m_data)->xid);
+}
+
+const uint8_t*
+MessageView::GetRawData (void) const
+{
+  return m_data;
+}
+
+const uint8_t*
+MessageView::LookupOxm (const struct ofp_match *match,
+                        uint32_t oxmHeader) const
+{
+  // The match length includes the type and length fields, but not padding.
+  const uint8_t *tlv = match->oxm_fields;
+  const uint8_t *end = (const uint8_t*)match + ntohs (match->length);
+  if (end > m_data + GetLength ())
+    {
+      return 0;
+    }
+
+  while (tlv + sizeof (uint32_t) <= end)
+    {
+      uint32_t header = ntohl (*(const uint32_t*)tlv);
+      const uint8_t *value = tlv + sizeof (uint32_t);
+      if (value + OXM_LENGTH (header) > end)
+        {
+          return 0;
+        }
+      if (header == oxmHeader)
+        {
+          return value;
+        }
+      tlv = value + OXM_LENGTH (header);
+    }
+  return 0;
+}
+
+size_t
+MessageView::GetPaddedMatchSize (const struct ofp_match *match)
+{
+  return (ntohs (match->length) + 7) / 8 * 8;
+}
+
+PacketInView::PacketInView (const uint8_t *data, size_t size)
+  : MessageView (data, size),
+  m_pktIn ((const struct ofp_packet_in*)data)
+{
+}
+
+bool
+PacketInView::IsValid (void) const
+{
+  return MessageView::IsValid () && GetType () == OFPT_PACKET_IN
+         && GetLength () >= sizeof (struct ofp_packet_in)
+         && GetData () <= m_data + GetLength ();
+}
+
+uint32_t
+PacketInView::GetBufferId (void) const
+{
+  return ntohl (m_pktIn->buffer_id);
+}
+
+uint16_t
+PacketInView::GetTotalLen (void) const
+{
+  return ntohs (m_pktIn->total_len);
+}
+
+uint8_t
+PacketInView::GetReason (void) const
+{
+  return m_pktIn->reason;
+}
+
+uint8_t
+PacketInView::GetTableId (void) const
+{
+  return m_pktIn->table_id;
+}
+
+uint64_t
+PacketInView::GetCookie (void) const
+{
+  return ntohll (m_pktIn->cookie);
+}
+
+const uint8_t*
+PacketInView::GetData (void) const
+{
+  // The packet data comes after the padded match and two more pad bytes.
+  return m_data + offsetof (struct ofp_packet_in, match)
+         + GetPaddedMatchSize (&m_pktIn->match) + 2;
+}
+
+size_t
+PacketInView::GetDataLength (void) const
+{
+  return m_data + GetLength () - GetData ();
+}
+
+const uint8_t*
+PacketInView::LookupOxm (uint32_t oxmHeader) const
+{
+  return MessageView::LookupOxm (&m_pktIn->match, oxmHeader);
+}
+
+uint32_t
+PacketInView::GetInPort (void) const
+{
+  const uint8_t *value = LookupOxm (OXM_OF_IN_PORT);
+  return value ? ntohl (*(const uint32_t*)value) : 0;
+}
+
+FlowRemovedView::FlowRemovedView (const uint8_t *data, size_t size)
+  : MessageView (data, size),
+  m_flowRem ((const struct ofp_flow_removed*)data)
+{
+}
+
+bool
+FlowRemovedView::IsValid (void) const
+{
+  return MessageView::IsValid () && GetType () == OFPT_FLOW_REMOVED
+         && GetLength () >= sizeof (struct ofp_flow_removed);
+}
+
+uint64_t
+FlowRemovedView::GetCookie (void) const
+{
+  return ntohll (m_flowRem->cookie);
+}
+
+uint16_t
+FlowRemovedView::GetPriority (void) const
+{
+  return ntohs (m_flowRem->priority);
+}
+
+uint8_t
+FlowRemovedView::GetReason (void) const
+{
+  return m_flowRem->reason;
+}
+
+uint8_t
+FlowRemovedView::GetTableId (void) const
+{
+  return m_flowRem->table_id;
+}
+
+uint32_t
+FlowRemovedView::GetDurationSec (void) const
+{
+  return ntohl (m_flowRem->duration_sec);
+}
+
+uint32_t
+FlowRemovedView::GetDurationNsec (void) const
+{
+  return ntohl (m_flowRem->duration_nsec);
+}
+
+uint16_t
+FlowRemovedView::GetIdleTimeout (void) const
+{
+  return ntohs (m_flowRem->idle_timeout);
+}
+
+uint16_t
+FlowRemovedView::GetHardTimeout (void) const
+{
+  return ntohs (m_flowRem->hard_timeout);
+}
+
+uint64_t
+FlowRemovedView::GetPacketCount (void) const
+{
+  return ntohll (m_flowRem->packet_count);
+}
+
+uint64_t
+FlowRemovedView::GetByteCount (void) const
+{
+  return ntohll (m_flowRem->byte_count);
+}
+
+const uint8_t*
+FlowRemovedView::LookupOxm (uint32_t oxmHeader) const
+{
+  return MessageView::LookupOxm (&m_flowRem->match, oxmHeader);
+}
+
+PortStatusView::PortStatusView (const uint8_t *data, size_t size)
+  : MessageView (data, size),
+  m_portStatus ((const struct ofp_port_status*)data)
+{
+}
+
+bool
+PortStatusView::IsValid (void) const
+{
+  return MessageView::IsValid () && GetType () == OFPT_PORT_STATUS
+         && GetLength () >= sizeof (struct ofp_port_status);
+}
+
+uint8_t
+PortStatusView::GetReason (void) const
+{
+  return m_portStatus->reason;
+}
+
+uint32_t
+PortStatusView::GetPortNo (void) const
+{
+  return ntohl (m_portStatus->desc.port_no);
+}
+
+uint32_t
+PortStatusView::GetConfig (void) const
+{
+  return ntohl (m_portStatus->desc.config);
+}
+
+uint32_t
+PortStatusView::GetState (void) const
+{
+  return ntohl (m_portStatus->desc.state);
+}
+
+uint32_t
+PortStatusView::GetCurrSpeed (void) const
+{
+  return ntohl (m_portStatus->desc.curr_speed);
+}
+
+uint32_t
+PortStatusView::GetMaxSpeed (void) const
+{
+  return ntohl (m_portStatus->desc.max_speed);
+}
+
+const uint8_t*
+PortStatusView::GetHwAddr (void) const
+{
+  return m_portStatus->desc.hw_addr;
+}
+
+MultipartReplyView::MultipartReplyView (const uint8_t *data, size_t size)
+  : MessageView (data, size),
+  m_reply ((const struct ofp_multipart_reply*)data)
+{
+}
+
+bool
+MultipartReplyView::IsValid (void) const
+{
+  return MessageView::IsValid () && GetType () == OFPT_MULTIPART_REPLY
+         && GetLength () >= sizeof (struct ofp_multipart_reply);
+}
+
+uint16_t
+MultipartReplyView::GetMultipartType (void) const
+{
+  return ntohs (m_reply->type);
+}
+
+uint16_t
+MultipartReplyView::GetFlags (void) const
+{
+  return ntohs (m_reply->flags);
+}
+
+bool
+MultipartReplyView::HasMore (void) const
+{
+  return GetFlags () & OFPMPF_REPLY_MORE;
+}
+
+const uint8_t*
+MultipartReplyView::GetBody (void) const
+{
+  return m_reply->body;
+}
+
+size_t
+MultipartReplyView::GetBodyLength (void) const
+{
+  return GetLength () - sizeof (struct ofp_multipart_reply);
+}
+
+size_t
+MultipartReplyView::GetNPortStats (void) const
+{
+  if (GetMultipartType () != OFPMP_PORT_STATS)
+    {
+      return 0;
+    }
+  return GetBodyLength () / sizeof (struct ofp_port_stats);
+}
+
+const struct ofp_port_stats*
+MultipartReplyView::GetPortStats (size_t idx) const
+{
+  NS_ASSERT_MSG (idx < GetNPortStats (), "Port stats index out of range.");
+  return ((const struct ofp_port_stats*)GetBody ()) + idx;
+}
+
+size_t
+MultipartReplyView::GetNQueueStats (void) const
+{
+  if (GetMultipartType () != OFPMP_QUEUE)
+    {
+      return 0;
+    }
+  return GetBodyLength () / sizeof (struct ofp_queue_stats);
+}
+
+const struct ofp_queue_stats*
+MultipartReplyView::GetQueueStats (size_t idx) const
+{
+  NS_ASSERT_MSG (idx < GetNQueueStats (), "Queue stats index out of range.");
+  return ((const struct ofp_queue_stats*)GetBody ()) + idx;
+}
+
+size_t
+MultipartReplyView::GetNTableStats (void) const
+{
+  if (GetMultipartType () != OFPMP_TABLE)
+    {
+      return 0;
+    }
+  return GetBodyLength () / sizeof (struct ofp_table_stats);
+}
+
+const struct ofp_table_stats*
+MultipartReplyView::GetTableStats (size_t idx) const
+{
+  NS_ASSERT_MSG (idx < GetNTableStats (), "Table stats index out of range.");
+  return ((const struct ofp_table_stats*)GetBody ()) + idx;
+}
+
+const struct ofp_flow_stats*
+MultipartReplyView::GetNextFlowStats (const struct ofp_flow_stats *prev) const
+{
+  if (GetMultipartType () != OFPMP_FLOW)
+    {
+      return 0;
+    }
+
+  const uint8_t *next = GetBody ();
+  if (prev)
+    {
+      uint16_t prevLength = ntohs (prev->length);
+      if (prevLength < sizeof (struct ofp_flow_stats))
+        {
+          return 0;
+        }
+      next = (const uint8_t*)prev + prevLength;
+    }
+
+  // Check that the complete entry fits into the message body.
+  const uint8_t *end = m_data + GetLength ();
+  if (next + sizeof (struct ofp_flow_stats) > end)
+    {
+      return 0;
+    }
+  const struct ofp_flow_stats *entry = (const struct ofp_flow_stats*)next;
+  if (next + ntohs (entry->length) > end)
+    {
+      return 0;
+    }
+  return entry;
+}
+
+uint32_t
+MultipartReplyView::GetExperimenterId (void) const
+{
+  if (GetMultipartType () != OFPMP_EXPERIMENTER
+      || GetBodyLength () < sizeof (struct ofp_experimenter_multipart_header))
+    {
+      return 0;
+    }
+  return ntohl (((const struct ofp_experimenter_multipart_header*)
+                 GetBody ())->experimenter);
+}
+
+uint32_t
+MultipartReplyView::GetExperimenterType (void) const
+{
+  if (GetExperimenterId () == 0)
+    {
+      return 0;
+    }
+  return ntohl (((const struct ofp_experimenter_multipart_header*)
+                 GetBody ())->exp_type);
+}
+
+size_t
+MultipartReplyView::GetNRateStats (void) const
+{
+  if (GetExperimenterId () != OFS13_EXPERIMENTER_ID
+      || GetExperimenterType () != OFS13_EXP_RATE_STATS)
+    {
+      return 0;
+    }
+  return (GetBodyLength () - sizeof (struct ofp_experimenter_multipart_header))
+         / sizeof (struct ofs13_rate_stats);
+}
+
+const struct ofs13_rate_stats*
+MultipartReplyView::GetRateStats (size_t idx) const
+{
+  NS_ASSERT_MSG (idx < GetNRateStats (), "Rate stats index out of range.");
+  return ((const struct ofs13_rate_stats*)(
+            GetBody () + sizeof (struct ofp_experimenter_multipart_header)))
+         + idx;
+}
+
+const struct ofp_meter_stats*
+MultipartReplyView::GetNextMeterStats (const struct ofp_meter_stats *prev) const
+{
+  if (GetMultipartType () != OFPMP_METER)
+    {
+      return 0;
+    }
+
+  const uint8_t *next = GetBody ();
+  if (prev)
+    {
+      uint16_t prevLength = ntohs (prev->len);
+      if (prevLength < sizeof (struct ofp_meter_stats))
+        {
+          return 0;
+        }
+      next = (const uint8_t*)prev + prevLength;
+    }
+
+  // Check that the complete entry fits into the message body.
+  const uint8_t *end = m_data + GetLength ();
+  if (next + sizeof (struct ofp_meter_stats) > end)
+    {
+      return 0;
+    }
+  const struct ofp_meter_stats *entry = (const struct ofp_meter_stats*)next;
+  if (next + ntohs (entry->len) > end)
+    {
+      return 0;
+    }
+  return entry;
+}
+
+} // namespace ofs
+} // namespace ns3
@@ -0,0 +1,307 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_MESSAGE_VIEW_H
+#define OFSWITCH13_MESSAGE_VIEW_H
+
+#include "ofswitch13-interface.h"
+
+namespace ns3 {
+namespace ofs {
+
+/**
+ * \ingroup ofswitch13
+ * Lightweight read-only view over an OpenFlow message in wire format. A view
+ * only holds a pointer to the raw message bytes and decodes the requested
+ * fields on demand, without allocating the tree of ofl_* structures created
+ * by ofl_msg_unpack (). The view is only valid while the underlying buffer is
+ * alive and unmodified, so it must not be saved for later usage.
+ */
+class MessageView
+{
+public:
+  /**
+   * Complete constructor.
+   * \param data The pointer to the message in wire format.
+   * \param size The number of bytes available at data.
+   */
+  MessageView (const uint8_t *data, size_t size);
+
+  /**
+   * Check for a valid view, with enough bytes for the OpenFlow header and a
+   * message length field matching the available bytes.
+   * \return true when valid, false otherwise.
+   */
+  bool IsValid (void) const;
+
+  /**
+   * \name Header accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint8_t  GetVersion (void) const;
+  uint8_t  GetType    (void) const;
+  uint16_t GetLength  (void) const;
+  uint32_t GetXid     (void) const;
+  //\}
+
+  /**
+   * Get the pointer to the raw message bytes.
+   * \return The raw message pointer.
+   */
+  const uint8_t* GetRawData (void) const;
+
+protected:
+  /**
+   * Look for an OXM TLV into a wire format ofp_match structure.
+   * \param match The pointer to the ofp_match structure.
+   * \param oxmHeader The OXM header (one of OXM_OF_* values).
+   * \return The pointer to the TLV value, or 0 when not found.
+   */
+  const uint8_t* LookupOxm (const struct ofp_match *match,
+                            uint32_t oxmHeader) const;
+
+  /**
+   * Get the wire size of an ofp_match structure, including padding bytes.
+   * \param match The pointer to the ofp_match structure.
+   * \return The padded match size.
+   */
+  static size_t GetPaddedMatchSize (const struct ofp_match *match);
+
+  const uint8_t*  m_data;   //!< Raw message bytes.
+  size_t          m_size;   //!< Number of available bytes.
+};
+
+/**
+ * \ingroup ofswitch13
+ * Read-only view for OFPT_PACKET_IN messages.
+ */
+class PacketInView : public MessageView
+{
+public:
+  /**
+   * Complete constructor.
+   * \param data The pointer to the message in wire format.
+   * \param size The number of bytes available at data.
+   */
+  PacketInView (const uint8_t *data, size_t size);
+
+  /** \copydoc MessageView::IsValid */
+  bool IsValid (void) const;
+
+  /**
+   * \name Packet-in field accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint32_t GetBufferId      (void) const;
+  uint16_t GetTotalLen      (void) const;
+  uint8_t  GetReason        (void) const;
+  uint8_t  GetTableId       (void) const;
+  uint64_t GetCookie        (void) const;
+  const uint8_t* GetData    (void) const;
+  size_t   GetDataLength    (void) const;
+  //\}
+
+  /**
+   * Look for an OXM TLV into the packet-in match.
+   * \param oxmHeader The OXM header (one of OXM_OF_* values).
+   * \return The pointer to the TLV value, or 0 when not found.
+   */
+  const uint8_t* LookupOxm (uint32_t oxmHeader) const;
+
+  /**
+   * Get the input port from the packet-in match.
+   * \return The input port number, or 0 when not available.
+   */
+  uint32_t GetInPort (void) const;
+
+private:
+  const struct ofp_packet_in *m_pktIn;  //!< Wire packet-in message.
+};
+
+/**
+ * \ingroup ofswitch13
+ * Read-only view for OFPT_FLOW_REMOVED messages.
+ */
+class FlowRemovedView : public MessageView
+{
+public:
+  /**
+   * Complete constructor.
+   * \param data The pointer to the message in wire format.
+   * \param size The number of bytes available at data.
+   */
+  FlowRemovedView (const uint8_t *data, size_t size);
+
+  /** \copydoc MessageView::IsValid */
+  bool IsValid (void) const;
+
+  /**
+   * \name Flow-removed field accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint64_t GetCookie        (void) const;
+  uint16_t GetPriority      (void) const;
+  uint8_t  GetReason        (void) const;
+  uint8_t  GetTableId       (void) const;
+  uint32_t GetDurationSec   (void) const;
+  uint32_t GetDurationNsec  (void) const;
+  uint16_t GetIdleTimeout   (void) const;
+  uint16_t GetHardTimeout   (void) const;
+  uint64_t GetPacketCount   (void) const;
+  uint64_t GetByteCount     (void) const;
+  //\}
+
+  /**
+   * Look for an OXM TLV into the flow-removed match.
+   * \param oxmHeader The OXM header (one of OXM_OF_* values).
+   * \return The pointer to the TLV value, or 0 when not found.
+   */
+  const uint8_t* LookupOxm (uint32_t oxmHeader) const;
+
+private:
+  const struct ofp_flow_removed *m_flowRem; //!< Wire flow-removed message.
+};
+
+/**
+ * \ingroup ofswitch13
+ * Read-only view for OFPT_PORT_STATUS messages.
+ */
+class PortStatusView : public MessageView
+{
+public:
+  /**
+   * Complete constructor.
+   * \param data The pointer to the message in wire format.
+   * \param size The number of bytes available at data.
+   */
+  PortStatusView (const uint8_t *data, size_t size);
+
+  /** \copydoc MessageView::IsValid */
+  bool IsValid (void) const;
+
+  /**
+   * \name Port-status field accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint8_t  GetReason        (void) const;
+  uint32_t GetPortNo        (void) const;
+  uint32_t GetConfig        (void) const;
+  uint32_t GetState         (void) const;
+  uint32_t GetCurrSpeed     (void) const;
+  uint32_t GetMaxSpeed      (void) const;
+  const uint8_t* GetHwAddr  (void) const;
+  //\}
+
+private:
+  const struct ofp_port_status *m_portStatus; //!< Wire port-status message.
+};
+
+/**
+ * \ingroup ofswitch13
+ * Read-only view for OFPT_MULTIPART_REPLY messages. The body entries of
+ * fixed-size replies (port, queue, and table stats) can be accessed by index,
+ * while variable-size flow and meter stats entries can be walked with
+ * GetNextFlowStats () and GetNextMeterStats ().
+ */
+class MultipartReplyView : public MessageView
+{
+public:
+  /**
+   * Complete constructor.
+   * \param data The pointer to the message in wire format.
+   * \param size The number of bytes available at data.
+   */
+  MultipartReplyView (const uint8_t *data, size_t size);
+
+  /** \copydoc MessageView::IsValid */
+  bool IsValid (void) const;
+
+  /**
+   * \name Multipart reply header accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint16_t GetMultipartType (void) const;
+  uint16_t GetFlags         (void) const;
+  bool     HasMore          (void) const;
+  const uint8_t* GetBody    (void) const;
+  size_t   GetBodyLength    (void) const;
+  //\}
+
+  /**
+   * \name Fixed-size body entries (OFPMP_PORT_STATS, OFPMP_QUEUE, OFPMP_TABLE).
+   * \param idx The entry index.
+   * \return The number of entries or the pointer to the requested entry.
+   */
+  //\{
+  size_t GetNPortStats (void) const;
+  const struct ofp_port_stats* GetPortStats (size_t idx) const;
+  size_t GetNQueueStats (void) const;
+  const struct ofp_queue_stats* GetQueueStats (size_t idx) const;
+  size_t GetNTableStats (void) const;
+  const struct ofp_table_stats* GetTableStats (size_t idx) const;
+  //\}
+
+  /**
+   * Walk the variable-size OFPMP_FLOW body entries.
+   * \param prev The previous entry, or 0 to get the first one.
+   * \return The next flow stats entry, or 0 when no more entries.
+   */
+  const struct ofp_flow_stats* GetNextFlowStats (
+    const struct ofp_flow_stats *prev) const;
+
+  /**
+   * Walk the variable-size OFPMP_METER body entries.
+   * \param prev The previous entry, or 0 to get the first one.
+   * \return The next meter stats entry, or 0 when no more entries.
+   */
+  const struct ofp_meter_stats* GetNextMeterStats (
+    const struct ofp_meter_stats *prev) const;
+
+  /**
+   * \name OFPMP_EXPERIMENTER header accessors.
+   * \return The requested value, or zero for other multipart types.
+   */
+  //\{
+  uint32_t GetExperimenterId   (void) const;
+  uint32_t GetExperimenterType (void) const;
+  //\}
+
+  /**
+   * \name OFSwitch13 rate statistics body entries (OFS13_EXP_RATE_STATS).
+   * \param idx The entry index.
+   * \return The number of entries or the pointer to the requested entry.
+   */
+  //\{
+  size_t GetNRateStats (void) const;
+  const struct ofs13_rate_stats* GetRateStats (size_t idx) const;
+  //\}
+
+private:
+  const struct ofp_multipart_reply *m_reply;  //!< Wire multipart reply.
+};
+
+} // namespace ofs
+} // namespace ns3
+#endif /* OFSWITCH13_MESSAGE_VIEW_H */
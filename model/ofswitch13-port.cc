@@ -22,11 +22,16 @@
 #include <ns3/ethernet-trailer.h>
 #include <ns3/pointer.h>
 #include <ns3/csma-net-device.h>
+#include <ns3/ipv4-l3-protocol.h>
+#include <ns3/ipv6-l3-protocol.h>
+#include <ns3/point-to-point-net-device.h>
 #include <ns3/virtual-net-device.h>
+#include "ethernet-header-tag.h"
 #include "ofswitch13-device.h"
 #include "ofswitch13-queue.h"
 #include "ofswitch13-port.h"
 #include "tunnel-id-tag.h"
+#include <algorithm>
 
 #undef NS_LOG_APPEND_CONTEXT
 #define NS_LOG_APPEND_CONTEXT                                   \
@@ -44,6 +49,9 @@ NS_OBJECT_ENSURE_REGISTERED (OFSwitch13Port);
 OFSwitch13Port::OFSwitch13Port ()
   : m_swPort (0),
   m_netDev (0),
+  m_csmaDev (0),
+  m_p2pDev (0),
+  m_logical (false),
   m_openflowDev (0)
 {
   NS_LOG_FUNCTION (this);
@@ -60,6 +68,8 @@ OFSwitch13Port::DoDispose ()
   NS_LOG_FUNCTION (this);
 
   m_portQueue->Dispose ();
+  m_rxEstimator = 0;
+  m_txEstimator = 0;
   if (m_swPort)
     {
       ofl_structs_free_port (m_swPort->conf);
@@ -68,6 +78,8 @@ OFSwitch13Port::DoDispose ()
 
   m_swPort = 0;
   m_openflowDev = 0;
+  m_csmaDev = 0;
+  m_p2pDev = 0;
   m_netDev = 0;
 }
 
@@ -83,6 +95,16 @@ OFSwitch13Port::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&OFSwitch13Port::m_portQueue),
                    MakePointerChecker<OFSwitch13Queue> ())
+    .AddAttribute ("RxRateEstimator",
+                   "The rate estimator for packets received at this port.",
+                   PointerValue (),
+                   MakePointerAccessor (&OFSwitch13Port::m_rxEstimator),
+                   MakePointerChecker<OFSwitch13RateEstimator> ())
+    .AddAttribute ("TxRateEstimator",
+                   "The rate estimator for packets sent at this port.",
+                   PointerValue (),
+                   MakePointerAccessor (&OFSwitch13Port::m_txEstimator),
+                   MakePointerChecker<OFSwitch13RateEstimator> ())
 
     .AddTraceSource ("SwitchPortRx",
                      "Trace source indicating a packet received at this port.",
@@ -100,15 +122,18 @@ OFSwitch13Port::OFSwitch13Port (struct datapath *dp, Ptr<NetDevice> netDev,
                                 Ptr<OFSwitch13Device> openflowDev)
   : m_swPort (0),
   m_netDev (netDev),
+  m_csmaDev (netDev->GetObject<CsmaNetDevice> ()),
+  m_p2pDev (netDev->GetObject<PointToPointNetDevice> ()),
   m_openflowDev (openflowDev)
 {
   NS_LOG_FUNCTION (this << netDev << openflowDev);
 
   // Check for valid NetDevice type
-  Ptr<CsmaNetDevice> csmaDev = netDev->GetObject<CsmaNetDevice> ();
+  Ptr<CsmaNetDevice> csmaDev = m_csmaDev;
   Ptr<VirtualNetDevice> virtDev = netDev->GetObject<VirtualNetDevice> ();
-  NS_ABORT_MSG_IF (!csmaDev && !virtDev,
-                   "NetDevice must be CsmaNetDevice or VirtualNetDevice.");
+  NS_ABORT_MSG_IF (!Mac48Address::IsMatchingType (netDev->GetAddress ()),
+                   "NetDevice must have a MAC-48 address.");
+  m_logical = (virtDev != 0);
 
   m_portNo = ++(dp->ports_num);
   m_swPort = &dp->ports[m_portNo];
@@ -128,12 +153,8 @@ OFSwitch13Port::OFSwitch13Port (struct datapath *dp, Ptr<NetDevice> netDev,
   m_netDev->GetAddress ().CopyTo (m_swPort->conf->hw_addr);
   m_swPort->conf->config = 0x00000000;
   m_swPort->conf->state = 0x00000000 | OFPPS_LIVE;
-  m_swPort->conf->curr = GetPortFeatures ();
-  m_swPort->conf->advertised = GetPortFeatures ();
-  m_swPort->conf->supported = GetPortFeatures ();
   m_swPort->conf->peer = 0x00000000; // FIXME no information about peer port
-  m_swPort->conf->curr_speed = port_speed (m_swPort->conf->curr);
-  m_swPort->conf->max_speed = port_speed (m_swPort->conf->supported);
+  UpdatePortSpeed (GetPortDataRate ());
 
   dp_port_live_update (m_swPort);
 
@@ -152,10 +173,18 @@ OFSwitch13Port::OFSwitch13Port (struct datapath *dp, Ptr<NetDevice> netDev,
   m_swPort->max_queues = dp->max_queues;
   m_swPort->num_queues = 0;
   m_portQueue = CreateObject<OFSwitch13Queue> (m_swPort);
+  m_portQueue->SetSharedBuffer (openflowDev->GetSharedBuffer ());
+  m_rxEstimator = CreateObject<OFSwitch13RateEstimator> ();
+  m_txEstimator = CreateObject<OFSwitch13RateEstimator> ();
   if (csmaDev)
     {
       csmaDev->SetQueue (m_portQueue);
     }
+  else if (m_p2pDev)
+    {
+      m_p2pDev->SetQueue (m_portQueue);
+      m_portQueue->SetPppFraming (true);
+    }
 
   m_swPort->created = time_msec ();
 
@@ -174,12 +203,20 @@ OFSwitch13Port::OFSwitch13Port (struct datapath *dp, Ptr<NetDevice> netDev,
       csmaDev->SetOpenFlowReceiveCallback (
         MakeCallback (&OFSwitch13Port::Receive, this));
     }
-  else
+  else if (virtDev)
     {
-      NS_ASSERT (virtDev);
       virtDev->SetOpenFlowReceiveCallback (
         MakeCallback (&OFSwitch13Port::Receive, this));
     }
+  else
+    {
+      // Generic NetDevices are connected through the promiscuous receive
+      // callback. Packets forwarded to upper layers are discarded.
+      m_netDev->SetPromiscReceiveCallback (
+        MakeCallback (&OFSwitch13Port::Receive, this));
+      m_netDev->SetReceiveCallback (
+        MakeCallback (&OFSwitch13Port::Discard, this));
+    }
 }
 
 uint32_t
@@ -202,7 +239,12 @@ OFSwitch13Port::PortUpdateState ()
     }
   dp_port_live_update (m_swPort);
 
-  if (orig_state != m_swPort->conf->state)
+  // Check for changes in the link rate.
+  uint32_t orig_speed = m_swPort->conf->curr_speed;
+  UpdatePortSpeed (GetPortDataRate ());
+
+  if (orig_state != m_swPort->conf->state
+      || orig_speed != m_swPort->conf->curr_speed)
     {
       NS_LOG_INFO ("Port status has changed. Notifying the controller.");
       struct ofl_msg_port_status msg;
@@ -215,63 +257,87 @@ OFSwitch13Port::PortUpdateState ()
   return false;
 }
 
-uint32_t
-OFSwitch13Port::GetPortFeatures ()
+DataRate
+OFSwitch13Port::GetPortDataRate (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  DataRate dr;
+  DataRateValue drv;
   Ptr<Channel> channel = m_netDev->GetChannel ();
   if (channel)
     {
       Ptr<CsmaChannel> csmaChannel = channel->GetObject<CsmaChannel> ();
       if (csmaChannel)
         {
-          DataRateValue drv;
           csmaChannel->GetAttribute ("DataRate", drv);
-          dr = drv.Get ();
+          return drv.Get ();
         }
     }
 
+  // Other NetDevices (like the PointToPointNetDevice) hold the link rate.
+  if (m_netDev->GetAttributeFailSafe ("DataRate", drv))
+    {
+      return drv.Get ();
+    }
+  return DataRate (0);
+}
+
+uint32_t
+OFSwitch13Port::GetPortFeatures (DataRate rate) const
+{
+  NS_LOG_FUNCTION (this << rate);
+
   uint32_t feat = 0x00000000;
   feat |= OFPPF_COPPER;
   feat |= OFPPF_AUTONEG;
 
-  if (dr == DataRate ("10Mbps"))
+  switch (rate.GetBitRate ())
     {
+    case 10000000ULL:
       feat |= OFPPF_10MB_FD;
-    }
-  else if (dr == DataRate ("100Mbps"))
-    {
+      break;
+    case 100000000ULL:
       feat |= OFPPF_100MB_FD;
-    }
-  else if (dr == DataRate ("1Gbps"))
-    {
+      break;
+    case 1000000000ULL:
       feat |= OFPPF_1GB_FD;
-    }
-  else if (dr == DataRate ("10Gbps"))
-    {
+      break;
+    case 10000000000ULL:
       feat |= OFPPF_10GB_FD;
-    }
-  else if (dr == DataRate ("40Gbps"))
-    {
+      break;
+    case 40000000000ULL:
       feat |= OFPPF_40GB_FD;
-    }
-  else if (dr == DataRate ("100Gbps"))
-    {
+      break;
+    case 100000000000ULL:
       feat |= OFPPF_100GB_FD;
-    }
-  else if (dr == DataRate ("1000Gbps"))
-    {
+      break;
+    case 1000000000000ULL:
       feat |= OFPPF_1TB_FD;
-    }
-  else
-    {
+      break;
+    default:
+      // There are no feature bits for other rates (like 25G, 50G, or 400G).
+      // The curr_speed and max_speed fields carry the actual rate.
       feat |= OFPPF_OTHER;
     }
   return feat;
 }
 
+void
+OFSwitch13Port::UpdatePortSpeed (DataRate rate)
+{
+  NS_LOG_FUNCTION (this << rate);
+
+  // The port speed fields are in kbps, derived from the actual link rate
+  // instead of from the port features, which only cover a few rates.
+  uint32_t features = GetPortFeatures (rate);
+  uint64_t kbps = rate.GetBitRate () / 1000;
+  m_swPort->conf->curr = features;
+  m_swPort->conf->advertised = features;
+  m_swPort->conf->supported = features;
+  m_swPort->conf->curr_speed = std::min<uint64_t> (kbps, UINT32_MAX);
+  m_swPort->conf->max_speed = m_swPort->conf->curr_speed;
+}
+
 bool
 OFSwitch13Port::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
                          uint16_t protocol, const Address &from,
@@ -283,32 +349,63 @@ OFSwitch13Port::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
   if ((m_swPort->conf->config & (OFPPC_NO_RECV | OFPPC_PORT_DOWN)) != 0)
     {
       NS_LOG_WARN ("This port is down or inoperating. Discarding packet");
+      m_rxEstimator->NotifyDrop ();
       return false;
     }
 
+  // Generic NetDevices don't carry Ethernet frames, so we rebuild the frame
+  // from the Ethernet header tag (when sent by another switch port) or from
+  // the addresses and protocol reported by the NetDevice.
+  if (!m_csmaDev && !m_logical)
+    {
+      Ptr<Packet> frame = packet->Copy ();
+      EthernetHeaderTag headerTag;
+      EthernetHeader header;
+      if (frame->RemovePacketTag (headerTag))
+        {
+          header = headerTag.GetHeader ();
+        }
+      else
+        {
+          header.SetSource (Mac48Address::ConvertFrom (from));
+          header.SetDestination (Mac48Address::ConvertFrom (to));
+          header.SetLengthType (protocol);
+        }
+      frame->AddHeader (header);
+      EthernetTrailer trailer;
+      frame->AddTrailer (trailer);
+      packet = frame;
+    }
+
   // Update port stats
   m_swPort->stats->rx_packets++;
   m_swPort->stats->rx_bytes += packet->GetSize ();
+  m_rxEstimator->NotifyPacket (packet->GetSize ());
 
   // Fire RX trace source
   m_rxTrace (packet);
   NS_LOG_DEBUG ("Pkt " << packet->GetUid () << " received at this port.");
 
-  // Retrieve the tunnel id from packet, if available.
-  Ptr<Packet> localPacket = packet->Copy ();
-  TunnelIdTag tunnelIdTag;
-  localPacket->PeekPacketTag (tunnelIdTag);
-  uint64_t tunnelId = tunnelIdTag.GetTunnelId ();
-  NS_LOG_DEBUG ("Pkt tunnel id is " << tunnelId);
+  // Retrieve the tunnel id from packet, only available at logical ports.
+  uint64_t tunnelId = 0;
+  if (m_logical)
+    {
+      TunnelIdTag tunnelIdTag;
+      packet->PeekPacketTag (tunnelIdTag);
+      tunnelId = tunnelIdTag.GetTunnelId ();
+      NS_LOG_DEBUG ("Pkt tunnel id is " << tunnelId);
+    }
 
-  // Send the packet to the OpenFlow pipeline
-  NS_LOG_DEBUG ("Pkt copy " << localPacket->GetUid () << " sent to pipeline.");
-  m_openflowDev->ReceiveFromSwitchPort (localPacket, m_portNo, tunnelId);
+  // Send the packet to the OpenFlow pipeline. There's no need to copy the
+  // packet, as the pipeline creates a new one when modifying its content.
+  NS_LOG_DEBUG ("Pkt " << packet->GetUid () << " sent to pipeline.");
+  m_openflowDev->ReceiveFromSwitchPort (ConstCast<Packet> (packet), m_portNo,
+                                        tunnelId);
   return true;
 }
 
 bool
-OFSwitch13Port::Send (Ptr<const Packet> packet, uint32_t queueNo,
+OFSwitch13Port::Send (Ptr<Packet> packet, uint32_t queueNo,
                       uint64_t tunnelId)
 {
   NS_LOG_FUNCTION (this << packet << queueNo << tunnelId);
@@ -316,47 +413,193 @@ OFSwitch13Port::Send (Ptr<const Packet> packet, uint32_t queueNo,
   if (m_swPort->conf->config & (OFPPC_PORT_DOWN))
     {
       NS_LOG_WARN ("This port is down. Discarding packet");
+      m_txEstimator->NotifyDrop ();
       return false;
     }
 
   // Fire TX trace source (with complete packet)
   m_txTrace (packet);
+  NS_LOG_DEBUG ("Pkt " << packet->GetUid () << " will be sent at this port.");
 
-  Ptr<Packet> packetCopy = packet->Copy ();
-  NS_LOG_DEBUG ("Pkt " << packetCopy->GetUid () <<
-                " will be sent at this port.");
-
-  // Removing the Ethernet header and trailer from packet, which will be
-  // included again by CsmaNetDevice
-  EthernetTrailer trailer;
-  packetCopy->RemoveTrailer (trailer);
-  EthernetHeader header;
-  packetCopy->RemoveHeader (header);
-
-  // Tagging the packet with queue and tunnel ids.
-  QueueTag queueTag (queueNo);
-  packetCopy->ReplacePacketTag (queueTag);
-  NS_LOG_DEBUG ("Pkt queue will be " << queueNo);
-
-  TunnelIdTag tunnelIdTag (tunnelId);
-  packetCopy->ReplacePacketTag (tunnelIdTag);
-  NS_LOG_DEBUG ("Pkt tunnel tag will be " << tunnelId);
-
-  // Send the packet over the underlying net device.
-  bool status = m_netDev->SendFrom (packetCopy, header.GetSource (),
-                                    header.GetDestination (),
-                                    header.GetLengthType ());
-  // Updating port statistics
+  bool status = false;
+  if (m_csmaDev)
+    {
+      // The packet already includes the Ethernet header and trailer, so we
+      // don't need to copy it, remove them, and let the CsmaNetDevice include
+      // them again. We enqueue the packet directly into the port queue with
+      // the queue id out-of-band, and notify the CsmaNetDevice to start the
+      // transmission. There is no tunnel id for CsmaNetDevice ports.
+      NS_LOG_DEBUG ("Pkt queue will be " << queueNo);
+      if (m_csmaDev->IsLinkUp () && m_csmaDev->IsSendEnabled ())
+        {
+          status = m_portQueue->Enqueue (packet, queueNo);
+        }
+      if (status)
+        {
+          m_csmaDev->NotifyOpenFlowEnqueue (packet);
+        }
+    }
+  else
+    {
+      // Removing the Ethernet header and trailer from packet copy, as the
+      // underlying NetDevice expects the packet payload and the addresses.
+      Ptr<Packet> packetCopy = packet->Copy ();
+      EthernetTrailer trailer;
+      packetCopy->RemoveTrailer (trailer);
+      EthernetHeader header;
+      packetCopy->RemoveHeader (header);
+
+      uint16_t protocol = header.GetLengthType ();
+      if (m_logical)
+        {
+          // Tagging the packet with the tunnel id.
+          TunnelIdTag tunnelIdTag (tunnelId);
+          packetCopy->ReplacePacketTag (tunnelIdTag);
+          NS_LOG_DEBUG ("Pkt tunnel tag will be " << tunnelId);
+        }
+      else
+        {
+          // Tagging the packet with the Ethernet header, which is used by the
+          // switch port at the other side to rebuild the frame, and with the
+          // queue id, used by the OFSwitch13Queue at PointToPointNetDevice.
+          EthernetHeaderTag headerTag (header);
+          packetCopy->ReplacePacketTag (headerTag);
+          QueueTag queueTag (queueNo);
+          packetCopy->ReplacePacketTag (queueTag);
+          NS_LOG_DEBUG ("Pkt queue will be " << queueNo);
+
+          // The PPP only carries IPv4 and IPv6 packets. Other frames (like
+          // ARP) are only sent to switch ports, which rebuild the original
+          // frame from the Ethernet header tag.
+          if (m_p2pDev && protocol != Ipv4L3Protocol::PROT_NUMBER
+              && protocol != Ipv6L3Protocol::PROT_NUMBER)
+            {
+              if (!IsPeerSwitchPort ())
+                {
+                  NS_LOG_WARN ("Protocol not supported by PPP. "
+                               "Discarding packet");
+                  m_swPort->stats->tx_dropped++;
+                  m_txEstimator->NotifyDrop ();
+                  return false;
+                }
+              protocol = Ipv4L3Protocol::PROT_NUMBER;
+            }
+        }
+
+      // Send the packet over the underlying net device.
+      if (m_netDev->SupportsSendFrom ())
+        {
+          status = m_netDev->SendFrom (packetCopy, header.GetSource (),
+                                       header.GetDestination (), protocol);
+        }
+      else
+        {
+          status = m_netDev->Send (packetCopy, header.GetDestination (),
+                                   protocol);
+        }
+    }
+
+  // Updating port statistics, counting the complete frame on every port type
+  // (just like the rx statistics).
   if (status)
     {
       m_swPort->stats->tx_packets++;
-      m_swPort->stats->tx_bytes += packetCopy->GetSize ();
+      m_swPort->stats->tx_bytes += packet->GetSize ();
+      m_txEstimator->NotifyPacket (packet->GetSize ());
     }
   else
     {
       m_swPort->stats->tx_dropped++;
+      m_txEstimator->NotifyDrop ();
     }
   return status;
 }
 
+Ptr<OFSwitch13Queue>
+OFSwitch13Port::GetPortQueue (void) const
+{
+  return m_portQueue;
+}
+
+int64_t
+OFSwitch13Port::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  return m_portQueue->AssignStreams (stream);
+}
+
+void
+OFSwitch13Port::GetRateStats (
+  std::vector<struct ofs::ofs13_rate_stats> &entries) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // Rates are converted to integers in wire format, with packet and drop
+  // rates in 1/1000 of packets per second.
+  struct ofs::ofs13_rate_stats entry;
+  memset (&entry, 0, sizeof (entry));
+  entry.port_no = htonl (m_portNo);
+
+  uint32_t nQueues = m_portQueue->GetNQueues ();
+  for (uint32_t i = 0; i < nQueues + 2; i++)
+    {
+      Ptr<OFSwitch13RateEstimator> estimator;
+      if (i == 0)
+        {
+          estimator = m_rxEstimator;
+          entry.queue_id = htonl (OFPQ_ALL);
+          entry.direction = ofs::OFS13_RATE_RX;
+        }
+      else if (i == 1)
+        {
+          estimator = m_txEstimator;
+          entry.direction = ofs::OFS13_RATE_TX;
+        }
+      else
+        {
+          estimator = m_portQueue->GetRateEstimator (i - 2);
+          entry.queue_id = htonl (i - 2);
+        }
+      double pktRate = estimator->GetPacketRate () * 1000;
+      double dropRate = estimator->GetDropRate () * 1000;
+      entry.bit_rate = htonll ((uint64_t)estimator->GetBitRate ());
+      entry.peak_bit_rate = htonll ((uint64_t)estimator->GetPeakBitRate ());
+      entry.packet_rate = htonll ((uint64_t)pktRate);
+      entry.drop_rate = htonll ((uint64_t)dropRate);
+      entries.push_back (entry);
+    }
+}
+
+bool
+OFSwitch13Port::Discard (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                         uint16_t protocol, const Address &from)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  return true;
+}
+
+bool
+OFSwitch13Port::IsPeerSwitchPort (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<Channel> channel = m_netDev->GetChannel ();
+  if (!channel)
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < channel->GetNDevices (); i++)
+    {
+      Ptr<NetDevice> device = channel->GetDevice (i);
+      if (device != m_netDev && device->GetNode ()
+          && device->GetNode ()->GetObject<OFSwitch13Device> ())
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
 } // namespace ns3
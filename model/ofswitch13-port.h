@@ -22,6 +22,7 @@
 #define OFSWITCH13_PORT_H
 
 #include <ns3/object.h>
+#include <ns3/data-rate.h>
 #include <ns3/net-device.h>
 #include <ns3/packet.h>
 #include <ns3/traced-callback.h>
@@ -29,6 +30,8 @@
 
 namespace ns3 {
 
+class CsmaNetDevice;
+class PointToPointNetDevice;
 class OFSwitch13Queue;
 class OFSwitch13Device;
 
@@ -37,7 +40,13 @@ class OFSwitch13Device;
  *
  * A OpenFlow switch port, interconnecting the underlying NetDevice to the
  * OpenFlow device through the OpenFlow receive callback. This class handles
- * the ofsoftswitch13 internal sw_port structure.
+ * the ofsoftswitch13 internal sw_port structure. The CsmaNetDevice (physical
+ * port) and the VirtualNetDevice (logical port) carry Ethernet frames. Other
+ * NetDevices, like the PointToPointNetDevice, are connected through the
+ * promiscuous receive callback, and the Ethernet header is carried
+ * out-of-band by the EthernetHeaderTag. When the tag is not available (i.e.
+ * the packet was not sent by another switch port), the Ethernet header is
+ * rebuilt from the addresses and protocol reported by the NetDevice.
  * \see ofsoftswitch13 udatapath/dp_ports.h
  * \attention Each underlying NetDevice used as port must only be assigned
  *            a MAC Address. Adding an Ipv4/IPv6 layer to it may cause error.
@@ -72,8 +81,8 @@ public:
                   Ptr<OFSwitch13Device> openflowDev);
 
   /**
-   * Update the port state field based on NetDevice status, and notify the
-   * controller when changes occurs.
+   * Update the port state and speed fields based on NetDevice status and link
+   * rate, and notify the controller when changes occurs.
    * \return true if the state of the port has changed, false otherwise.
    */
   bool PortUpdateState ();
@@ -81,32 +90,75 @@ public:
   /**
    * Send a packet over this OpenFlow switch port. It will check port
    * configuration, update counters and send the packet to the underlying
-   * device.
+   * device. For CsmaNetDevice ports, the packet (which already includes the
+   * Ethernet header and trailer) is enqueued directly into the port queue,
+   * with the queue id carried out-of-band. The packet may be shared with
+   * other ports and must not be modified.
    * \see ofsoftswitch13 function dp_ports_run () at udatapath/dp_ports.c
    * \param packet The Packet to send.
    * \param queueNo The queue to use.
    * \param tunnelId The metadata associated with a logical port.
    * \return true if the packet was sent successfully, false otherwise.
    */
-  bool Send (Ptr<const Packet> packet, uint32_t queueNo = 0,
+  bool Send (Ptr<Packet> packet, uint32_t queueNo = 0,
              uint64_t tunnelId = 0);
 
+  /**
+   * Get the OpenFlow queue used as the tx queue in this port.
+   * \return The port queue.
+   */
+  Ptr<OFSwitch13Queue> GetPortQueue (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables used
+   * by the port queue.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * Append the rate statistics entries for this port to the list, in wire
+   * format: the port rx and tx entries, followed by the tx entries for each
+   * internal queue.
+   * \param entries The list of rate statistics entries.
+   */
+  void GetRateStats (std::vector<struct ofs::ofs13_rate_stats> &entries) const;
+
 protected:
   /** Destructor implementation */
   virtual void DoDispose ();
 
 private:
+  /**
+   * Get the link rate of the underlying NetDevice, from the CsmaChannel or
+   * from the NetDevice DataRate attribute.
+   * \return The link rate, or zero when not available.
+   */
+  DataRate GetPortDataRate (void) const;
+
   /**
    * Create the bitmaps of OFPPF_* describing port features.
    * \see ofsoftswitch netdev_get_features () at lib/netdev.c
+   * \param rate The link rate.
    * \return Port features bitmap.
    */
-  uint32_t GetPortFeatures ();
+  uint32_t GetPortFeatures (DataRate rate) const;
+
+  /**
+   * Update the port features and the curr_speed and max_speed fields from the
+   * link rate.
+   * \param rate The link rate.
+   */
+  void UpdatePortSpeed (DataRate rate);
 
   /**
    * Called when a packet is received on this OpenFlow switch port by the
    * underlying NetDevice. It will check port configuration, update counter
-   * and send the packet to the OpenFlow pipeline.
+   * and send the packet to the OpenFlow pipeline. The packet is not copied,
+   * as the pipeline never modifies it (a new packet is created when the
+   * pipeline changes the packet content). The tunnel id is only read for
+   * logical ports.
    * \see ofsoftswitch13 function dp_ports_run () at udatapath/dp_ports.c
    * \param device Underlying ns-3 network device.
    * \param packet The received packet.
@@ -120,17 +172,43 @@ private:
                 uint16_t protocol, const Address &from, const Address &to,
                 NetDevice::PacketType packetType);
 
+  /**
+   * Called when a packet is received by a generic underlying NetDevice for
+   * upper layers. As the packet was already handled by the promiscuous
+   * receive callback, it is discarded here, so it isn't forwarded up the
+   * stack.
+   * \param device Underlying ns-3 network device.
+   * \param packet The received packet.
+   * \param protocol Next protocol header value.
+   * \param from Address of the correspondant.
+   * \return true.
+   */
+  bool Discard (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                uint16_t protocol, const Address &from);
+
+  /**
+   * Check if the channel peer of the underlying NetDevice is also an OpenFlow
+   * switch port, which can rebuild frames from the Ethernet header tag.
+   * \return true if the peer device belongs to an OpenFlow switch node.
+   */
+  bool IsPeerSwitchPort (void) const;
+
   /** Trace source fired when a packet arrives at this switch port. */
   TracedCallback<Ptr<const Packet> > m_rxTrace;
 
   /** Trace source fired when a packet will be sent over this switch port. */
   TracedCallback<Ptr<const Packet> > m_txTrace;
 
-  uint32_t                  m_portNo;       //!< Port number.
-  struct sw_port*           m_swPort;       //!< ofsoftswitch13 struct sw_port.
-  Ptr<NetDevice>            m_netDev;       //!< Underlying NetDevice.
-  Ptr<OFSwitch13Queue>      m_portQueue;    //!< OpenFlow Port Queue.
-  Ptr<OFSwitch13Device>     m_openflowDev;  //!< OpenFlow device.
+  uint32_t                   m_portNo;      //!< Port number.
+  struct sw_port*            m_swPort;      //!< ofsoftswitch13 struct sw_port.
+  Ptr<NetDevice>             m_netDev;      //!< Underlying NetDevice.
+  Ptr<CsmaNetDevice>         m_csmaDev;     //!< Underlying CSMA NetDevice.
+  Ptr<PointToPointNetDevice> m_p2pDev;      //!< Underlying P2P NetDevice.
+  bool                       m_logical;     //!< Logical port (tunnel).
+  Ptr<OFSwitch13Queue>       m_portQueue;   //!< OpenFlow Port Queue.
+  Ptr<OFSwitch13RateEstimator> m_rxEstimator; //!< Rx rate estimator.
+  Ptr<OFSwitch13RateEstimator> m_txEstimator; //!< Tx rate estimator.
+  Ptr<OFSwitch13Device>      m_openflowDev; //!< OpenFlow device.
 };
 
 } // namespace ns3
@@ -19,12 +19,19 @@
  */
 
 #include "ns3/log.h"
+#include "ns3/simulator.h"
 #include "ns3/enum.h"
 #include "ns3/string.h"
 #include "ns3/uinteger.h"
 #include "ns3/object-vector.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node.h"
+#include "ns3/ppp-header.h"
 #include "ofswitch13-queue.h"
 #include <algorithm>
+#include <iterator>
 
 #undef NS_LOG_APPEND_CONTEXT
 #define NS_LOG_APPEND_CONTEXT                                   \
@@ -49,6 +56,15 @@ GetDefaultQueueFactory ()
   return queueFactory;
 }
 
+ObjectFactory
+GetDefaultAqmFactory ()
+{
+  // No AQM by default, leaving the internal queue with its drop policy.
+  ObjectFactory aqmFactory;
+  aqmFactory.SetTypeId ("ns3::OFSwitch13Aqm");
+  return aqmFactory;
+}
+
 TypeId
 OFSwitch13Queue::GetTypeId (void)
 {
@@ -72,6 +88,54 @@ OFSwitch13Queue::GetTypeId (void)
                    ObjectVectorValue (),
                    MakeObjectVectorAccessor (&OFSwitch13Queue::m_queues),
                    MakeObjectVectorChecker<Queue<Packet> > ())
+    .AddAttribute ("AqmFactory",
+                   "The object factory for creating the AQM algorithm "
+                   "of each internal queue.",
+                   TypeId::ATTR_GET | TypeId::ATTR_CONSTRUCT,
+                   ObjectFactoryValue (GetDefaultAqmFactory ()),
+                   MakeObjectFactoryAccessor (&OFSwitch13Queue::m_aqmFactory),
+                   MakeObjectFactoryChecker ())
+    .AddAttribute ("AqmList",
+                   "The list of AQM algorithms for internal queues.",
+                   ObjectVectorValue (),
+                   MakeObjectVectorAccessor (&OFSwitch13Queue::m_aqms),
+                   MakeObjectVectorChecker<OFSwitch13Aqm> ())
+    .AddAttribute ("RateEstimatorList",
+                   "The list of rate estimators for internal queues.",
+                   ObjectVectorValue (),
+                   MakeObjectVectorAccessor (&OFSwitch13Queue::m_estimators),
+                   MakeObjectVectorChecker<OFSwitch13RateEstimator> ())
+    .AddAttribute ("Scheduler",
+                   "The egress scheduler for internal queues.",
+                   EnumValue (OFSwitch13Queue::PRIORITY),
+                   MakeEnumAccessor (&OFSwitch13Queue::m_scheduler),
+                   MakeEnumChecker (OFSwitch13Queue::PRIORITY, "Priority",
+                                    OFSwitch13Queue::WRR,      "Wrr",
+                                    OFSwitch13Queue::DRR,      "Drr",
+                                    OFSwitch13Queue::WFQ,      "Wfq"))
+    .AddAttribute ("Quantum",
+                   "The DRR quantum in bytes for the queue with the min "
+                   "weight, also used as the max rate bucket size.",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&OFSwitch13Queue::m_quantum),
+                   MakeUintegerChecker<uint32_t> (64))
+    .AddTraceSource ("OccupancyBitmap",
+                     "Bitmap of internal queues holding packets "
+                     "(bit i is set when queue id i is not empty).",
+                     MakeTraceSourceAccessor (&OFSwitch13Queue::m_occupancy),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("QueueOccupancy",
+                     "Number of packets in an internal queue, fired after "
+                     "each enqueue and dequeue operation.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Queue::m_occupancyTrace),
+                     "ns3::OFSwitch13Queue::OccupancyTracedCallback")
+    .AddTraceSource ("SojournTime",
+                     "Time spent by a packet in an internal queue, fired "
+                     "after each dequeue operation.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13Queue::m_sojournTrace),
+                     "ns3::OFSwitch13Queue::SojournTracedCallback")
   ;
   return tid;
 }
@@ -79,6 +143,12 @@ OFSwitch13Queue::GetTypeId (void)
 OFSwitch13Queue::OFSwitch13Queue (struct sw_port *port)
   : Queue<Packet> (),
   m_swPort (port),
+  m_pppFraming (false),
+  m_occupancy (0),
+  m_rateLimited (0),
+  m_next (0),
+  m_minWeight (1),
+  m_virtualTime (0),
   NS_LOG_TEMPLATE_DEFINE ("OFSwitch13Queue")
 {
   NS_LOG_FUNCTION (this << port);
@@ -95,6 +165,127 @@ OFSwitch13Queue::GetNQueues (void) const
   return m_intQueues;
 }
 
+void
+OFSwitch13Queue::SetSharedBuffer (Ptr<OFSwitch13SharedBuffer> buffer)
+{
+  NS_LOG_FUNCTION (this << buffer);
+
+  NS_ASSERT_MSG (IsEmpty (), "Can't change the buffer of a non-empty queue.");
+  m_sharedBuffer = buffer;
+}
+
+void
+OFSwitch13Queue::SetPppFraming (bool ppp)
+{
+  NS_LOG_FUNCTION (this << ppp);
+
+  m_pppFraming = ppp;
+}
+
+void
+OFSwitch13Queue::SetQueueRates (uint32_t queueId, uint16_t minRate,
+                                uint16_t maxRate)
+{
+  NS_LOG_FUNCTION (this << queueId << minRate << maxRate);
+
+  NS_ASSERT_MSG (queueId < m_queues.size (), "Queue id is out of range.");
+  ClearQueueProperties (queueId);
+
+  // Filling the ofsoftswitch13 queue properties, reported to controllers in
+  // queue-get-config replies.
+  struct ofl_packet_queue *props = m_swPort->queues[queueId].props;
+  props->properties = (struct ofl_queue_prop_header**)
+    xmalloc (2 * sizeof (struct ofl_queue_prop_header*));
+  if (minRate <= 1000)
+    {
+      struct ofl_queue_prop_min_rate *prop =
+        (struct ofl_queue_prop_min_rate*)
+        xmalloc (sizeof (struct ofl_queue_prop_min_rate));
+      prop->header.type = OFPQT_MIN_RATE;
+      prop->rate = minRate;
+      props->properties[props->properties_num++] =
+        (struct ofl_queue_prop_header*)prop;
+    }
+  if (maxRate <= 1000)
+    {
+      struct ofl_queue_prop_max_rate *prop =
+        (struct ofl_queue_prop_max_rate*)
+        xmalloc (sizeof (struct ofl_queue_prop_max_rate));
+      prop->header.type = OFPQT_MAX_RATE;
+      prop->rate = maxRate;
+      props->properties[props->properties_num++] =
+        (struct ofl_queue_prop_header*)prop;
+    }
+
+  // Refill the max rate bucket and update the scheduler weights.
+  if (maxRate <= 1000)
+    {
+      m_rateLimited |= (1U << queueId);
+    }
+  else
+    {
+      m_rateLimited &= ~(1U << queueId);
+    }
+  m_states [queueId].m_maxRate = maxRate;
+  m_states [queueId].m_tokens = m_quantum;
+  m_states [queueId].m_lastFill = Simulator::Now ();
+  UpdateWeights ();
+}
+
+uint16_t
+OFSwitch13Queue::GetMinRate (uint32_t queueId) const
+{
+  NS_ASSERT_MSG (queueId < m_queues.size (), "Queue id is out of range.");
+
+  struct ofl_packet_queue *props = m_swPort->queues[queueId].props;
+  for (size_t i = 0; i < props->properties_num; i++)
+    {
+      if (props->properties[i]->type == OFPQT_MIN_RATE)
+        {
+          return ((struct ofl_queue_prop_min_rate*)props->properties[i])->rate;
+        }
+    }
+  return OFPQ_MIN_RATE_UNCFG;
+}
+
+uint16_t
+OFSwitch13Queue::GetMaxRate (uint32_t queueId) const
+{
+  NS_ASSERT_MSG (queueId < m_queues.size (), "Queue id is out of range.");
+
+  struct ofl_packet_queue *props = m_swPort->queues[queueId].props;
+  for (size_t i = 0; i < props->properties_num; i++)
+    {
+      if (props->properties[i]->type == OFPQT_MAX_RATE)
+        {
+          return ((struct ofl_queue_prop_max_rate*)props->properties[i])->rate;
+        }
+    }
+  return OFPQ_MAX_RATE_UNCFG;
+}
+
+Ptr<OFSwitch13RateEstimator>
+OFSwitch13Queue::GetRateEstimator (uint32_t queueId) const
+{
+  NS_ASSERT_MSG (queueId < m_estimators.size (), "Queue id is out of range.");
+
+  return m_estimators [queueId];
+}
+
+int64_t
+OFSwitch13Queue::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  int64_t currentStream = stream;
+  AqmList_t::iterator it;
+  for (it = m_aqms.begin (); it != m_aqms.end (); it++)
+    {
+      currentStream += (*it)->AssignStreams (currentStream);
+    }
+  return (currentStream - stream);
+}
+
 void
 OFSwitch13Queue::DoDispose ()
 {
@@ -108,12 +299,19 @@ OFSwitch13Queue::DoDispose ()
       for (uint32_t i = 0; i < GetNQueues (); i++)
         {
           swQueue = &(m_swPort->queues[i]);
+          ClearQueueProperties (i);
           free (swQueue->stats);
           free (swQueue->props);
         }
       m_swPort = 0;
     }
   m_queues.clear ();
+  m_aqms.clear ();
+  m_estimators.clear ();
+  m_sharedBuffer = 0;
+  m_positions.clear ();
+  m_states.clear ();
+  m_credits.clear ();
 }
 
 void
@@ -125,7 +323,9 @@ OFSwitch13Queue::NotifyConstructionCompleted (void)
   // check for queue space is performed at DoEnqueue () by the internal queues.
   SetAttribute ("MaxSize", StringValue ("100Mp"));
 
-  // Creating the internal queues, defined by the NumQueues attribute.
+  // Creating the internal queues, defined by the NumQueues attribute. Queue
+  // ids must fit into the 32-bit occupancy bitmap.
+  NS_ABORT_MSG_IF (GetNQueues () > 32, "Too many internal queues.");
   for (uint32_t i = 0; i < GetNQueues (); i++)
     {
       AddQueue (m_qFactory.Create<Queue<Packet> > ());
@@ -142,7 +342,14 @@ OFSwitch13Queue::Enqueue (Ptr<Packet> packet)
 
   QueueTag queueNoTag;
   packet->PeekPacketTag (queueNoTag);
-  uint32_t queueNo = queueNoTag.GetQueueId ();
+  return Enqueue (packet, queueNoTag.GetQueueId ());
+}
+
+bool
+OFSwitch13Queue::Enqueue (Ptr<Packet> packet, uint32_t queueNo)
+{
+  NS_LOG_FUNCTION (this << packet << queueNo);
+
   NS_ASSERT_MSG (queueNo < GetNQueues (), "Queue id is out of range.");
   NS_LOG_DEBUG ("Packet " << packet << " to be enqueued in queue id " << queueNo);
 
@@ -150,21 +357,72 @@ OFSwitch13Queue::Enqueue (Ptr<Packet> packet)
   swQueue = dp_ports_lookup_queue (m_swPort, queueNo);
   NS_ASSERT_MSG (swQueue, "Invalid queue id.");
 
+  // Check the AQM algorithm before enqueuing the packet.
+  OFSwitch13Aqm::Verdict verdict =
+    m_aqms [queueNo]->CheckEnqueue (GetQueue (queueNo), packet);
+  if (verdict == OFSwitch13Aqm::MARK)
+    {
+      Ptr<Packet> marked = MarkEcn (packet);
+      if (marked)
+        {
+          packet = marked;
+          verdict = OFSwitch13Aqm::ACCEPT;
+        }
+    }
+  if (verdict != OFSwitch13Aqm::ACCEPT)
+    {
+      NS_LOG_DEBUG ("Packet enqueue dropped by AQM in queue " << queueNo);
+      swQueue->stats->tx_errors++;
+      m_estimators [queueNo]->NotifyDrop ();
+      DropBeforeEnqueue (packet);
+      return false;
+    }
+
+  // Check the shared buffer admission with dynamic threshold.
+  if (m_sharedBuffer && !m_sharedBuffer->Admit (
+        GetQueue (queueNo)->GetNBytes (), packet->GetSize ()))
+    {
+      NS_LOG_DEBUG ("Packet enqueue dropped by shared buffer in queue "
+                    << queueNo);
+      swQueue->stats->tx_errors++;
+      m_estimators [queueNo]->NotifyDrop ();
+      m_sharedBuffer->NotifyDrop (m_swPort->conf->port_no, queueNo, packet);
+      DropBeforeEnqueue (packet);
+      return false;
+    }
+
   bool retval = GetQueue (queueNo)->Enqueue (packet);
   if (retval)
     {
+      if (m_sharedBuffer)
+        {
+          m_sharedBuffer->Reserve (packet->GetSize ());
+        }
       swQueue->stats->tx_packets++;
       swQueue->stats->tx_bytes += packet->GetSize ();
 
       // Enqueue the packet in this queue too.
       // This is necessary to ensure consistent statistics. Otherwise, when the
-      // NetDevice calls the IsEmpty () method, it will return true.
-      DoEnqueue (Tail (), packet);
+      // NetDevice calls the IsEmpty () method, it will return true. We save
+      // the packet position to avoid looking for it when dequeuing.
+      if (DoEnqueue (Tail (), packet))
+        {
+          m_positions [queueNo].push (std::prev (Tail ()));
+        }
+
+      // Stamp the WFQ finish tag for this packet.
+      QueueState &state = m_states [queueNo];
+      state.m_lastTag = std::max (m_virtualTime, state.m_lastTag)
+        + (double)packet->GetSize () / state.m_weight;
+      state.m_tags.push (state.m_lastTag);
+      state.m_arrivals.push (Simulator::Now ());
+      UpdateOccupancy (queueNo);
     }
   else
     {
       NS_LOG_DEBUG ("Packet enqueue dropped by internal queue " << queueNo);
       swQueue->stats->tx_errors++;
+      m_estimators [queueNo]->NotifyDrop ();
 
       // Drop the packet in this queue too.
       // This is necessary to ensure consistent statistics.
@@ -178,27 +436,36 @@ OFSwitch13Queue::Dequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  for (int32_t i = GetNQueues () - 1; i >= 0; i--)
+  // Packets dropped by the AQM algorithm after dequeue are discarded, and
+  // the next packet is selected.
+  int32_t queueId;
+  while ((queueId = SelectQueue (m_credits, m_next)) >= 0)
     {
-      if (GetQueue (i)->IsEmpty () == false)
-        {
-          NS_LOG_DEBUG ("Packet dequeued from queue id " << i);
-          Ptr<Packet> p = GetQueue (i)->Dequeue ();
+      NS_LOG_DEBUG ("Packet dequeued from queue id " << queueId);
+      Time sojourn;
+      Ptr<Packet> p = ExtractPacket (queueId, false, sojourn);
 
-          // Dequeue the packet from this queue too. As we don't know the
-          // exactly packet location on this queue, we have to look for it.
-          for (auto it = Head (); it != Tail (); it++)
+      OFSwitch13Aqm::Verdict verdict =
+        m_aqms [queueId]->CheckDequeue (GetQueue (queueId), p, sojourn);
+      if (verdict == OFSwitch13Aqm::MARK)
+        {
+          Ptr<Packet> marked = MarkEcn (p);
+          if (marked)
             {
-              if ((*it) == p)
-                {
-                  DoDequeue (it);
-                  return p;
-                }
+              p = marked;
+              verdict = OFSwitch13Aqm::ACCEPT;
             }
-
-          NS_LOG_WARN ("Packet " << p << " was not found on this queue.");
+        }
+      if (verdict == OFSwitch13Aqm::ACCEPT)
+        {
+          m_estimators [queueId]->NotifyPacket (p->GetSize ());
           return p;
         }
+
+      NS_LOG_DEBUG ("Packet dequeue dropped by AQM in queue " << queueId);
+      m_swPort->queues[queueId].stats->tx_errors++;
+      m_estimators [queueId]->NotifyDrop ();
+      DropAfterDequeue (p);
     }
 
   NS_LOG_DEBUG ("Queue empty");
@@ -210,31 +477,16 @@ OFSwitch13Queue::Remove (void)
 {
   NS_LOG_FUNCTION (this);
 
-  for (int32_t i = GetNQueues () - 1; i >= 0; i--)
+  int32_t queueId = SelectQueue (m_credits, m_next);
+  if (queueId < 0)
     {
-      if (GetQueue (i)->IsEmpty () == false)
-        {
-          NS_LOG_DEBUG ("Packet removed from queue id " << i);
-          Ptr<Packet> p = GetQueue (i)->Remove ();
-
-          // Remove the packet from this queue too. As we don't know the
-          // exactly packet location on this queue, we have to look for it.
-          for (auto it = Head (); it != Tail (); it++)
-            {
-              if ((*it) == p)
-                {
-                  DoDequeue (it);
-                  return p;
-                }
-            }
-
-          NS_LOG_WARN ("Packet " << p << " was not found on this queue.");
-          return p;
-        }
+      NS_LOG_DEBUG ("Queue empty");
+      return 0;
     }
 
-  NS_LOG_DEBUG ("Queue empty");
-  return 0;
+  NS_LOG_DEBUG ("Packet removed from queue id " << queueId);
+  Time sojourn;
+  return ExtractPacket (queueId, true, sojourn);
 }
 
 Ptr<const Packet>
@@ -242,17 +494,19 @@ OFSwitch13Queue::Peek (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  for (int32_t i = GetNQueues () - 1; i >= 0; i--)
+  // Select the queue using copies of the scheduler state, so the next
+  // dequeue operation will return the same packet.
+  std::vector<int64_t> credits = m_credits;
+  uint32_t next = m_next;
+  int32_t queueId = SelectQueue (credits, next);
+  if (queueId < 0)
     {
-      if (GetQueue (i)->IsEmpty () == false)
-        {
-          NS_LOG_DEBUG ("Packet peeked from queue id " << i);
-          return GetQueue (i)->Peek ();
-        }
+      NS_LOG_DEBUG ("Queue empty");
+      return 0;
     }
 
-  NS_LOG_DEBUG ("Queue empty");
-  return 0;
+  NS_LOG_DEBUG ("Packet peeked from queue id " << queueId);
+  return GetQueue (queueId)->Peek ();
 }
 
 uint32_t
@@ -281,18 +535,357 @@ OFSwitch13Queue::AddQueue (Ptr<Queue<Packet> > queue)
   swQueue->props = (struct ofl_packet_queue*)xmalloc (oflPacketQueueSize);
   swQueue->props->queue_id = queueId;
   swQueue->props->properties_num = 0;
+  swQueue->props->properties = 0;
 
   // Inserting the ns3::Queue object into queue list.
   m_queues.push_back (queue);
+  m_aqms.push_back (m_aqmFactory.Create<OFSwitch13Aqm> ());
+  m_estimators.push_back (CreateObject<OFSwitch13RateEstimator> ());
+  m_positions.push_back (IteratorQueue_t ());
+  m_credits.push_back (0);
+
+  QueueState state;
+  state.m_weight = 1;
+  state.m_maxRate = OFPQ_MAX_RATE_UNCFG;
+  state.m_tokens = m_quantum;
+  state.m_lastFill = Simulator::Now ();
+  state.m_lastTag = 0;
+  m_states.push_back (state);
+  UpdateWeights ();
   NS_LOG_DEBUG ("New queue with id " << queueId);
 
   return queueId;
 }
 
+Ptr<Packet>
+OFSwitch13Queue::ExtractPacket (uint32_t queueId, bool remove, Time &sojourn)
+{
+  NS_LOG_FUNCTION (this << queueId << remove);
+
+  Ptr<Packet> packet = remove ? GetQueue (queueId)->Remove ()
+    : GetQueue (queueId)->Dequeue ();
+  DequeueFromOuter (queueId, packet);
+  UpdateOccupancy (queueId);
+  UpdateScheduler (queueId, packet);
+  if (m_sharedBuffer)
+    {
+      m_sharedBuffer->Release (packet->GetSize ());
+    }
+
+  // Internal queues are FIFO, so the arrival time at the front is the one
+  // for this packet.
+  QueueState &state = m_states [queueId];
+  sojourn = Time (0);
+  if (!state.m_arrivals.empty ())
+    {
+      sojourn = Simulator::Now () - state.m_arrivals.front ();
+      state.m_arrivals.pop ();
+    }
+  m_sojournTrace (queueId, sojourn);
+  return packet;
+}
+
+Ptr<Packet>
+OFSwitch13Queue::MarkEcn (Ptr<const Packet> packet) const
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  // Packets in this queue carry the Ethernet header and trailer, or the PPP
+  // header. Only IPv4 packets with ECN capable transport can be marked.
+  EthernetHeader ethHeader;
+  PppHeader pppHeader;
+  if (m_pppFraming)
+    {
+      packet->PeekHeader (pppHeader);
+      if (pppHeader.GetProtocol () != 0x0021) // PPP IPv4
+        {
+          return 0;
+        }
+    }
+  else
+    {
+      packet->PeekHeader (ethHeader);
+      if (ethHeader.GetLengthType () != Ipv4L3Protocol::PROT_NUMBER)
+        {
+          return 0;
+        }
+    }
+
+  Ptr<Packet> marked = packet->Copy ();
+  if (m_pppFraming)
+    {
+      marked->RemoveHeader (pppHeader);
+    }
+  else
+    {
+      marked->RemoveHeader (ethHeader);
+    }
+  Ipv4Header ipHeader;
+  marked->RemoveHeader (ipHeader);
+  if (ipHeader.GetEcn () == Ipv4Header::ECN_NotECT)
+    {
+      return 0;
+    }
+
+  NS_LOG_DEBUG ("Packet " << packet << " marked with ECN CE.");
+  ipHeader.SetEcn (Ipv4Header::ECN_CE);
+  if (Node::ChecksumEnabled ())
+    {
+      ipHeader.EnableChecksum ();
+    }
+  marked->AddHeader (ipHeader);
+  if (m_pppFraming)
+    {
+      marked->AddHeader (pppHeader);
+    }
+  else
+    {
+      marked->AddHeader (ethHeader);
+    }
+  return marked;
+}
+
+void
+OFSwitch13Queue::DequeueFromOuter (uint32_t queueId, Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << queueId << packet);
+
+  // Internal queues are FIFO, so the packet removed from the internal queue
+  // must be the oldest one enqueued on it. This keeps both enqueue and
+  // dequeue operations in constant time.
+  IteratorQueue_t &positions = m_positions [queueId];
+  if (positions.empty () || *positions.front () != packet)
+    {
+      NS_LOG_WARN ("Packet " << packet << " was not found on this queue.");
+      return;
+    }
+  DoDequeue (positions.front ());
+  positions.pop ();
+}
+
 Ptr<Queue<Packet> >
 OFSwitch13Queue::GetQueue (uint32_t queueId) const
 {
   return m_queues.at (queueId);
 }
 
+void
+OFSwitch13Queue::ClearQueueProperties (uint32_t queueId)
+{
+  NS_LOG_FUNCTION (this << queueId);
+
+  struct ofl_packet_queue *props = m_swPort->queues[queueId].props;
+  for (size_t i = 0; i < props->properties_num; i++)
+    {
+      free (props->properties[i]);
+    }
+  free (props->properties);
+  props->properties = 0;
+  props->properties_num = 0;
+}
+
+void
+OFSwitch13Queue::UpdateWeights (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Queues with min rate use it as the weight, while queues without min rate
+  // equally share the remaining weight (at least 1).
+  uint32_t sumRates = 0;
+  uint32_t numUnset = 0;
+  for (uint32_t i = 0; i < m_states.size (); i++)
+    {
+      uint16_t minRate = GetMinRate (i);
+      if (minRate <= 1000)
+        {
+          sumRates += minRate;
+        }
+      else
+        {
+          numUnset++;
+        }
+    }
+  uint32_t share = 1;
+  if (numUnset && sumRates < 1000)
+    {
+      share = std::max<uint32_t> (1, (1000 - sumRates) / numUnset);
+    }
+
+  m_minWeight = 1000;
+  for (uint32_t i = 0; i < m_states.size (); i++)
+    {
+      uint16_t minRate = GetMinRate (i);
+      m_states [i].m_weight = minRate <= 1000 ? std::max<uint16_t> (1, minRate)
+        : share;
+      m_minWeight = std::min (m_minWeight, m_states [i].m_weight);
+      NS_LOG_DEBUG ("Queue id " << i << " weight " << m_states [i].m_weight);
+    }
+}
+
+int32_t
+OFSwitch13Queue::SelectQueue (std::vector<int64_t> &credits,
+                              uint32_t &next) const
+{
+  uint32_t backlog = m_occupancy;
+  if (!backlog)
+    {
+      return -1;
+    }
+
+  // Look for queues with packets within their max rates. Only queues with
+  // max rate properties must be checked. When all queues with packets are
+  // above their max rates, ignore the limit to keep the port busy, as the
+  // NetDevice will not poll this queue again until a new packet is enqueued.
+  uint32_t eligible = backlog & ~m_rateLimited;
+  for (uint32_t bits = backlog & m_rateLimited; bits; bits &= bits - 1)
+    {
+      uint32_t queueId = __builtin_ctz (bits);
+      if (IsConforming (queueId))
+        {
+          eligible |= (1U << queueId);
+        }
+    }
+  if (!eligible)
+    {
+      eligible = backlog;
+    }
+
+  switch (m_scheduler)
+    {
+    case OFSwitch13Queue::WRR:
+    case OFSwitch13Queue::DRR:
+      {
+        // Serve the queue in service while it has enough credits for the
+        // head packet. Otherwise, move to the next eligible queue in round
+        // robin order, adding the quantum to its credits.
+        while (!(eligible & (1U << next)) || credits [next] < GetCost (next))
+          {
+            next = (next + 1) % m_queues.size ();
+            if (eligible & (1U << next))
+              {
+                credits [next] += GetQuantum (next);
+              }
+          }
+        return next;
+      }
+    case OFSwitch13Queue::WFQ:
+      {
+        // Serve the queue with the smallest finish tag at the head.
+        int32_t queueId = -1;
+        for (uint32_t bits = eligible; bits; bits &= bits - 1)
+          {
+            uint32_t i = __builtin_ctz (bits);
+            if (queueId < 0 || m_states [i].m_tags.front ()
+                < m_states [queueId].m_tags.front ())
+              {
+                queueId = i;
+              }
+          }
+        return queueId;
+      }
+    case OFSwitch13Queue::PRIORITY:
+    default:
+      {
+        // The highest queue id with packets is given by the number of
+        // leading zeros in the bitmap.
+        return 31 - __builtin_clz (eligible);
+      }
+    }
+}
+
+bool
+OFSwitch13Queue::IsConforming (uint32_t queueId) const
+{
+  const QueueState &state = m_states [queueId];
+  if (state.m_maxRate > 1000)
+    {
+      return true;
+    }
+
+  // The port speed is in kbps and the max rate in 1/10 of a percent, so the
+  // max rate in bytes per second is their product divided by 8.
+  double rate = (double)state.m_maxRate * m_swPort->conf->curr_speed / 8;
+  double elapsed = (Simulator::Now () - state.m_lastFill).GetSeconds ();
+  return state.m_tokens + rate * elapsed >= 0;
+}
+
+int64_t
+OFSwitch13Queue::GetQuantum (uint32_t queueId) const
+{
+  // The quantum is computed in the scaled domain, so the weight ratios are
+  // not truncated. WRR credits are in packets times the min weight.
+  if (m_scheduler == OFSwitch13Queue::DRR)
+    {
+      return std::max<int64_t> (
+        1, (int64_t)m_states [queueId].m_weight * m_quantum / m_minWeight);
+    }
+  return m_states [queueId].m_weight;
+}
+
+int64_t
+OFSwitch13Queue::GetCost (uint32_t queueId) const
+{
+  if (m_scheduler == OFSwitch13Queue::DRR)
+    {
+      return GetQueue (queueId)->Peek ()->GetSize ();
+    }
+  return m_minWeight;
+}
+
+void
+OFSwitch13Queue::UpdateOccupancy (uint32_t queueId)
+{
+  NS_LOG_FUNCTION (this << queueId);
+
+  uint32_t packets = GetQueue (queueId)->GetNPackets ();
+  uint32_t bitmap = m_occupancy;
+  if (packets)
+    {
+      bitmap |= (1U << queueId);
+    }
+  else
+    {
+      bitmap &= ~(1U << queueId);
+    }
+  m_occupancy = bitmap;
+  m_occupancyTrace (queueId, packets);
+}
+
+void
+OFSwitch13Queue::UpdateScheduler (uint32_t queueId, Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << queueId << packet);
+
+  QueueState &state = m_states [queueId];
+  if (state.m_maxRate <= 1000)
+    {
+      // Refill the max rate bucket and consume tokens for this packet.
+      double rate = (double)state.m_maxRate * m_swPort->conf->curr_speed / 8;
+      double elapsed = (Simulator::Now () - state.m_lastFill).GetSeconds ();
+      state.m_tokens = std::min<double> (m_quantum,
+                                         state.m_tokens + rate * elapsed);
+      state.m_tokens -= packet->GetSize ();
+      state.m_lastFill = Simulator::Now ();
+    }
+
+  // Advance the WFQ virtual time to the finish tag of this packet.
+  if (!state.m_tags.empty ())
+    {
+      m_virtualTime = state.m_tags.front ();
+      state.m_tags.pop ();
+    }
+
+  // Consume the WRR/DRR credits for this packet.
+  if (m_scheduler == OFSwitch13Queue::WRR
+      || m_scheduler == OFSwitch13Queue::DRR)
+    {
+      m_credits [queueId] -= (m_scheduler == OFSwitch13Queue::DRR)
+        ? packet->GetSize () : m_minWeight;
+      if (!(m_occupancy & (1U << queueId)))
+        {
+          m_credits [queueId] = 0;
+        }
+    }
+}
+
 } // namespace ns3
@@ -21,9 +21,15 @@
 #define OFSWITCH13_QUEUE_H
 
 #include <queue>
+#include <vector>
+#include "ns3/nstime.h"
 #include "ns3/packet.h"
 #include "ns3/queue.h"
+#include "ns3/traced-value.h"
+#include "ofswitch13-aqm.h"
 #include "ofswitch13-interface.h"
+#include "ofswitch13-rate-estimator.h"
+#include "ofswitch13-shared-buffer.h"
 #include "queue-tag.h"
 
 namespace ns3 {
@@ -43,15 +49,32 @@ extern template class Queue<Packet>;
  * takes place outside the OpenFlow protocol. This class implements the queue
  * interface, extending the ns3::Queue class to allow compatibility with the
  * CsmaNetDevice used by OFSwitch13Port. Internally, it can hold a collection
- * of N priority queues, identified by IDs ranging from 0 to N in increasing
- * priority (queue ID 0 has the lowest priority). The ns3::QueueTag is used to
- * identify which internal queue will hold the packet, and the priority
- * algorithms ensures that higher-priority queues "always" get serviced
- * first.
+ * of N queues, identified by IDs ranging from 0 to N. The OFSwitch13Port
+ * enqueues packets with the internal queue ID given out-of-band, while the
+ * ns3::QueueTag is used by other callers to identify which internal queue will
+ * hold the packet. The egress scheduler selects the internal queue to serve
+ * at each dequeue operation.
+ * With the default strict priority scheduler, queue IDs are in increasing
+ * priority (queue ID 0 has the lowest priority) and higher-priority queues
+ * "always" get serviced first. With the weighted schedulers, the bandwidth is
+ * shared among queues according to the OpenFlow min rate queue properties.
+ * The OpenFlow max rate queue property caps the queue throughput while other
+ * queues have packets to send. Each internal queue also has an AQM algorithm
+ * (see OFSwitch13Aqm), which can drop or ECN mark packets before enqueue and
+ * after dequeue, based on the queue length and the packet sojourn time.
  */
 class OFSwitch13Queue : public Queue<Packet>
 {
 public:
+  /** Egress scheduling algorithm for internal queues. */
+  enum SchedulerType
+  {
+    PRIORITY = 0,   //!< Strict priority (higher queue ID first).
+    WRR = 1,        //!< Weighted round robin (in packets).
+    DRR = 2,        //!< Deficit round robin (in bytes).
+    WFQ = 3         //!< Self-clocked weighted fair queuing.
+  };
+
   /**
    * Register this type.
    * \return The object TypeId.
@@ -71,12 +94,95 @@ public:
   Ptr<Packet> Remove (void);
   Ptr<const Packet> Peek (void) const;
 
+  /**
+   * Enqueue the packet into the given internal queue. Packets enqueued by the
+   * OFSwitch13Port are shared with the pipeline and other ports, so they must
+   * not be modified while in this queue.
+   * \param packet The packet, including the Ethernet header and trailer.
+   * \param queueNo The internal queue id.
+   * \return True if the packet was enqueued.
+   */
+  bool Enqueue (Ptr<Packet> packet, uint32_t queueNo);
+
   /**
    * Get the number of internal queues.
    * \return The number of internal queues.
    */
   uint32_t GetNQueues (void) const;
 
+  /**
+   * Set the shared packet buffer pool for internal queues. When set, packets
+   * are admitted into internal queues according to the shared buffer dynamic
+   * threshold, in addition to the internal queue size limit.
+   * \param buffer The shared buffer, or 0 to disable it.
+   */
+  void SetSharedBuffer (Ptr<OFSwitch13SharedBuffer> buffer);
+
+  /**
+   * Set the link framing of packets in this queue, used to find the IPv4
+   * header for ECN marking. By default, packets carry the Ethernet header and
+   * trailer. When this queue is used by a PointToPointNetDevice, packets carry
+   * the PPP header instead.
+   * \param ppp True for PPP framing, false for Ethernet framing.
+   */
+  void SetPppFraming (bool ppp);
+
+  /**
+   * Set the OpenFlow min and max rate properties for an internal queue. These
+   * properties are reported to controllers in queue-get-config replies. The
+   * min rate sets the queue weight for weighted schedulers, and queues with
+   * no min rate equally share the remaining weight. The max rate caps the
+   * queue throughput while other queues have packets to send.
+   * \param queueId The internal queue id.
+   * \param minRate The min rate in 1/10 of a percent of the port speed.
+   * \param maxRate The max rate in 1/10 of a percent of the port speed.
+   * \attention Rate values above 1000 disable the property.
+   */
+  void SetQueueRates (uint32_t queueId, uint16_t minRate,
+                      uint16_t maxRate = OFPQ_MAX_RATE_UNCFG);
+
+  /**
+   * \name OpenFlow queue properties accessors.
+   * \param queueId The internal queue id.
+   * \return The rate in 1/10 of a percent, or a value above 1000 when the
+   *         property is not configured.
+   */
+  //\{
+  uint16_t GetMinRate (uint32_t queueId) const;
+  uint16_t GetMaxRate (uint32_t queueId) const;
+  //\}
+
+  /**
+   * Get the rate estimator for packets transmitted and dropped by an internal
+   * queue. Packets are estimated when dequeued for transmission, and drops
+   * include both enqueue and dequeue drops.
+   * \param queueId The internal queue id.
+   * \return The rate estimator.
+   */
+  Ptr<OFSwitch13RateEstimator> GetRateEstimator (uint32_t queueId) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables used
+   * by the AQM algorithms of the internal queues.
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * TracedCallback signature for internal queue occupancy.
+   * \param queueId The internal queue id.
+   * \param packets The number of packets in the internal queue.
+   */
+  typedef void (*OccupancyTracedCallback)(uint32_t queueId, uint32_t packets);
+
+  /**
+   * TracedCallback signature for packet sojourn time.
+   * \param queueId The internal queue id.
+   * \param sojourn The time the packet spent in the internal queue.
+   */
+  typedef void (*SojournTracedCallback)(uint32_t queueId, Time sojourn);
+
 protected:
   /** Destructor implementation. */
   virtual void DoDispose ();
@@ -101,13 +207,145 @@ private:
    */
   Ptr<Queue<Packet> > GetQueue (uint32_t queueId) const;
 
+  /**
+   * Free the OpenFlow properties of an internal queue.
+   * \param queueId The internal queue id.
+   */
+  void ClearQueueProperties (uint32_t queueId);
+
+  /**
+   * Update the scheduling weights from the OpenFlow min rate properties.
+   */
+  void UpdateWeights (void);
+
+  /**
+   * Select the internal queue to be served, according to the scheduler.
+   * \param credits The WRR/DRR credits for each queue (may be updated).
+   * \param next The WRR/DRR queue in service (may be updated).
+   * \return The internal queue id, or -1 when all queues are empty.
+   * \internal This function is marked as const to allow its usage inside
+   *           Peek () member function, with copies of the scheduler state.
+   */
+  int32_t SelectQueue (std::vector<int64_t> &credits, uint32_t &next) const;
+
+  /**
+   * Check if an internal queue is within its OpenFlow max rate.
+   * \param queueId The internal queue id.
+   * \return True when the queue can be served.
+   */
+  bool IsConforming (uint32_t queueId) const;
+
+  /**
+   * Get the WRR/DRR quantum added to the queue credits at each round.
+   * \param queueId The internal queue id.
+   * \return The quantum (packets times the min weight for WRR, bytes for DRR).
+   */
+  int64_t GetQuantum (uint32_t queueId) const;
+
+  /**
+   * Get the WRR/DRR credits required to serve the packet at queue head.
+   * \param queueId The internal queue id.
+   * \return The cost (packets times the min weight for WRR, bytes for DRR).
+   */
+  int64_t GetCost (uint32_t queueId) const;
+
+  /**
+   * Update the occupancy bitmap bit for an internal queue and fire the
+   * occupancy trace source.
+   * \param queueId The internal queue id.
+   */
+  void UpdateOccupancy (uint32_t queueId);
+
+  /**
+   * Update the scheduler state after a packet is removed from an internal
+   * queue.
+   * \param queueId The internal queue id.
+   * \param packet The packet removed from the internal queue.
+   */
+  void UpdateScheduler (uint32_t queueId, Ptr<Packet> packet);
+
+  /**
+   * Remove the packet at the head of an internal queue, updating this queue
+   * interface, the occupancy bitmap, and the scheduler state.
+   * \param queueId The internal queue id.
+   * \param remove True to remove (drop) the packet, false to dequeue it.
+   * \param sojourn The time the packet spent in the queue (output).
+   * \return The packet.
+   */
+  Ptr<Packet> ExtractPacket (uint32_t queueId, bool remove, Time &sojourn);
+
+  /**
+   * Mark an IPv4 ECN capable packet with the ECN Congestion Experienced
+   * codepoint. As enqueued packets may be shared, the mark is applied to a
+   * copy of the packet.
+   * \param packet The packet, including the link header.
+   * \return The marked packet copy, or 0 when it is not ECN capable.
+   */
+  Ptr<Packet> MarkEcn (Ptr<const Packet> packet) const;
+
+  /**
+   * Dequeue the packet from this queue interface, using the position saved at
+   * enqueue time for the packet at the head of the internal queue.
+   * \param queueId The internal queue id.
+   * \param packet The packet removed from the internal queue.
+   */
+  void DequeueFromOuter (uint32_t queueId, Ptr<Packet> packet);
+
   /** Structure to save the list of internal queues in this queue interface. */
   typedef std::vector<Ptr<Queue> > QueueList_t;
 
+  /** Structure to save the list of AQM algorithms for internal queues. */
+  typedef std::vector<Ptr<OFSwitch13Aqm> > AqmList_t;
+
+  /** Structure to save the list of rate estimators for internal queues. */
+  typedef std::vector<Ptr<OFSwitch13RateEstimator> > EstimatorList_t;
+
+  /** Structure to save the positions of enqueued packets (FIFO order). */
+  typedef std::queue<ConstIterator> IteratorQueue_t;
+
+  /** Structure to save the positions for each internal queue. */
+  typedef std::vector<IteratorQueue_t> IteratorList_t;
+
+  /** Scheduler metadata for an internal queue. */
+  struct QueueState
+  {
+    uint32_t            m_weight;   //!< Scheduling weight.
+    uint16_t            m_maxRate;  //!< Max rate (1/10 of a percent).
+    double              m_tokens;   //!< Max rate bucket tokens (bytes).
+    Time                m_lastFill; //!< Last bucket refill time.
+    double              m_lastTag;  //!< WFQ finish tag of the last packet.
+    std::queue<double>  m_tags;     //!< WFQ finish tags of queued packets.
+    std::queue<Time>    m_arrivals; //!< Arrival times of queued packets.
+  };
+
+  /** Structure to save the scheduler metadata for each internal queue. */
+  typedef std::vector<QueueState> StateList_t;
+
   struct sw_port*       m_swPort;     //!< ofsoftswitch13 struct sw_port.
   ObjectFactory         m_qFactory;   //!< Factory for internal queues.
   uint32_t              m_intQueues;  //!< Number of internal queues.
   QueueList_t           m_queues;     //!< List of internal queues.
+  ObjectFactory         m_aqmFactory; //!< Factory for AQM algorithms.
+  AqmList_t             m_aqms;       //!< List of AQM algorithms.
+  EstimatorList_t       m_estimators; //!< List of rate estimators.
+  Ptr<OFSwitch13SharedBuffer> m_sharedBuffer; //!< Shared buffer pool.
+  bool                  m_pppFraming; //!< Packets with PPP framing.
+  IteratorList_t        m_positions;  //!< Packet positions in this queue.
+  TracedValue<uint32_t> m_occupancy;  //!< Non-empty queues bitmap.
+  uint32_t              m_rateLimited; //!< Queues with max rate bitmap.
+  SchedulerType         m_scheduler;  //!< Egress scheduler.
+  uint32_t              m_quantum;    //!< DRR quantum for the min weight.
+  StateList_t           m_states;     //!< Scheduler metadata.
+  std::vector<int64_t>  m_credits;    //!< WRR/DRR queue credits.
+  uint32_t              m_next;       //!< WRR/DRR queue in service.
+  uint32_t              m_minWeight;  //!< Min weight among queues.
+  double                m_virtualTime; //!< WFQ virtual time.
+
+  /** Trace source fired when an internal queue occupancy changes. */
+  TracedCallback<uint32_t, uint32_t> m_occupancyTrace;
+
+  /** Trace source fired with the sojourn time of a dequeued packet. */
+  TracedCallback<uint32_t, Time> m_sojournTrace;
 
   NS_LOG_TEMPLATE_DECLARE;            //!< Redefinition of the log component.
 };
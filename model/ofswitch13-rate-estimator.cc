@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ofswitch13-rate-estimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13RateEstimator");
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13RateEstimator);
+
+OFSwitch13RateEstimator::OFSwitch13RateEstimator ()
+  : m_lastPacket (Simulator::Now ()),
+  m_lastDrop (Simulator::Now ()),
+  m_windowStart (Simulator::Now ()),
+  m_windowPeak (0),
+  m_lastPeak (0),
+  m_bitRate (0),
+  m_packetRate (0),
+  m_dropRate (0),
+  m_peakBitRate (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OFSwitch13RateEstimator::~OFSwitch13RateEstimator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+OFSwitch13RateEstimator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13RateEstimator")
+    .SetParent<Object> ()
+    .SetGroupName ("OFSwitch13")
+    .AddConstructor<OFSwitch13RateEstimator> ()
+    .AddAttribute ("TimeConstant",
+                   "The EWMA time constant (tau).",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&OFSwitch13RateEstimator::m_tau),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("PeakWindow",
+                   "The window length for the peak bit rate.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&OFSwitch13RateEstimator::m_peakWindow),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddTraceSource ("BitRate",
+                     "The EWMA bit rate (bps).",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13RateEstimator::m_bitRate),
+                     "ns3::TracedValueCallback::Double")
+    .AddTraceSource ("PacketRate",
+                     "The EWMA packet rate (pps).",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13RateEstimator::m_packetRate),
+                     "ns3::TracedValueCallback::Double")
+    .AddTraceSource ("DropRate",
+                     "The EWMA drop rate (pps).",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13RateEstimator::m_dropRate),
+                     "ns3::TracedValueCallback::Double")
+    .AddTraceSource ("PeakBitRate",
+                     "The peak bit rate over the peak window (bps).",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13RateEstimator::m_peakBitRate),
+                     "ns3::TracedValueCallback::Double")
+  ;
+  return tid;
+}
+
+void
+OFSwitch13RateEstimator::NotifyPacket (uint32_t bytes)
+{
+  NS_LOG_FUNCTION (this << bytes);
+
+  double decay = GetDecay (m_lastPacket);
+  double tau = m_tau.GetSeconds ();
+  m_lastPacket = Simulator::Now ();
+  m_bitRate = m_bitRate * decay + bytes * 8 / tau;
+  m_packetRate = m_packetRate * decay + 1 / tau;
+  UpdatePeak ();
+}
+
+void
+OFSwitch13RateEstimator::NotifyDrop (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  double decay = GetDecay (m_lastDrop);
+  m_lastDrop = Simulator::Now ();
+  m_dropRate = m_dropRate * decay + 1 / m_tau.GetSeconds ();
+}
+
+double
+OFSwitch13RateEstimator::GetBitRate (void) const
+{
+  return m_bitRate * GetDecay (m_lastPacket);
+}
+
+double
+OFSwitch13RateEstimator::GetPacketRate (void) const
+{
+  return m_packetRate * GetDecay (m_lastPacket);
+}
+
+double
+OFSwitch13RateEstimator::GetDropRate (void) const
+{
+  return m_dropRate * GetDecay (m_lastDrop);
+}
+
+double
+OFSwitch13RateEstimator::GetPeakBitRate (void) const
+{
+  // Without packets since the last window roll, the window peaks must be
+  // shifted to the current time.
+  Time elapsed = Simulator::Now () - m_windowStart;
+  if (elapsed >= m_peakWindow * 2)
+    {
+      return GetBitRate ();
+    }
+  if (elapsed >= m_peakWindow)
+    {
+      return std::max (m_windowPeak, GetBitRate ());
+    }
+  return m_peakBitRate;
+}
+
+double
+OFSwitch13RateEstimator::GetDecay (Time last) const
+{
+  Time elapsed = Simulator::Now () - last;
+  if (elapsed.IsZero ())
+    {
+      return 1;
+    }
+  return std::exp (-elapsed.GetSeconds () / m_tau.GetSeconds ());
+}
+
+void
+OFSwitch13RateEstimator::UpdatePeak (void)
+{
+  Time elapsed = Simulator::Now () - m_windowStart;
+  if (elapsed >= m_peakWindow)
+    {
+      // Roll the peak window. When more than one window has elapsed, the
+      // last window had no packets.
+      m_lastPeak = (elapsed >= m_peakWindow * 2) ? 0 : m_windowPeak;
+      m_windowPeak = 0;
+      int64_t windows = elapsed.GetTimeStep () / m_peakWindow.GetTimeStep ();
+      m_windowStart += m_peakWindow * windows;
+    }
+  m_windowPeak = std::max (m_windowPeak, m_bitRate.Get ());
+  double peak = std::max (m_lastPeak, m_windowPeak);
+  if (peak != m_peakBitRate)
+    {
+      m_peakBitRate = peak;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_RATE_ESTIMATOR_H
+#define OFSWITCH13_RATE_ESTIMATOR_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-value.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ *
+ * \brief Hardware-like rate estimator for OpenFlow switch ports and queues,
+ * maintained on the data path. The bit, packet, and drop rates are estimated
+ * with a time-decaying exponentially weighted moving average (EWMA), updated
+ * at each packet event: the current estimate decays exponentially with the
+ * time since the last event (using the time constant tau), and each new event
+ * adds its contribution divided by tau. The peak bit rate is the highest EWMA
+ * bit rate observed during the current and the last peak windows. The
+ * estimates are exposed as traced values, updated at each packet event, and
+ * through the Get* methods, which decay the estimates to the current time.
+ */
+class OFSwitch13RateEstimator : public Object
+{
+public:
+  OFSwitch13RateEstimator ();           //!< Default constructor.
+  virtual ~OFSwitch13RateEstimator ();  //!< Dummy destructor.
+
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Notify a packet that went through the estimated point.
+   * \param bytes The packet size in bytes.
+   */
+  void NotifyPacket (uint32_t bytes);
+
+  /**
+   * Notify a packet dropped at the estimated point.
+   */
+  void NotifyDrop (void);
+
+  /**
+   * \name Rate estimates at the current time.
+   * \return The requested value.
+   */
+  //\{
+  double GetBitRate     (void) const;   //!< EWMA bit rate (bps).
+  double GetPacketRate  (void) const;   //!< EWMA packet rate (pps).
+  double GetDropRate    (void) const;   //!< EWMA drop rate (pps).
+  double GetPeakBitRate (void) const;   //!< Peak bit rate (bps).
+  //\}
+
+private:
+  /**
+   * Get the decay factor for the time elapsed since the last update.
+   * \param last The time of the last update.
+   * \return The decay factor.
+   */
+  double GetDecay (Time last) const;
+
+  /**
+   * Update the peak bit rate with the current EWMA bit rate, rolling the peak
+   * window when necessary.
+   */
+  void UpdatePeak (void);
+
+  Time                  m_tau;          //!< EWMA time constant.
+  Time                  m_peakWindow;   //!< Peak window length.
+  Time                  m_lastPacket;   //!< Last packet update time.
+  Time                  m_lastDrop;     //!< Last drop update time.
+  Time                  m_windowStart;  //!< Current peak window start.
+  double                m_windowPeak;   //!< Peak bit rate at this window.
+  double                m_lastPeak;     //!< Peak bit rate at last window.
+  TracedValue<double>   m_bitRate;      //!< EWMA bit rate (bps).
+  TracedValue<double>   m_packetRate;   //!< EWMA packet rate (pps).
+  TracedValue<double>   m_dropRate;     //!< EWMA drop rate (pps).
+  TracedValue<double>   m_peakBitRate;  //!< Peak bit rate (bps).
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_RATE_ESTIMATOR_H */
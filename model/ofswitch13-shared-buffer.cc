@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#include "ns3/log.h"
+#include "ofswitch13-shared-buffer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OFSwitch13SharedBuffer");
+NS_OBJECT_ENSURE_REGISTERED (OFSwitch13SharedBuffer);
+
+TypeId
+OFSwitch13SharedBuffer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OFSwitch13SharedBuffer")
+    .SetParent<Object> ()
+    .SetGroupName ("OFSwitch13")
+    .AddTraceSource ("Occupancy",
+                     "Traced value indicating the shared buffer space in use "
+                     "(bytes).",
+                     MakeTraceSourceAccessor (&OFSwitch13SharedBuffer::m_used),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Drop",
+                     "Trace source indicating a packet dropped by the "
+                     "shared buffer dynamic threshold.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13SharedBuffer::m_dropTrace),
+                     "ns3::OFSwitch13SharedBuffer::DropTracedCallback")
+  ;
+  return tid;
+}
+
+OFSwitch13SharedBuffer::OFSwitch13SharedBuffer (uint32_t size, double alpha)
+  : m_size (size),
+  m_alpha (alpha),
+  m_used (0)
+{
+  NS_LOG_FUNCTION (this << size << alpha);
+}
+
+OFSwitch13SharedBuffer::~OFSwitch13SharedBuffer ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+OFSwitch13SharedBuffer::GetSize (void) const
+{
+  return m_size;
+}
+
+uint32_t
+OFSwitch13SharedBuffer::GetUsed (void) const
+{
+  return m_used;
+}
+
+double
+OFSwitch13SharedBuffer::GetAlpha (void) const
+{
+  return m_alpha;
+}
+
+uint64_t
+OFSwitch13SharedBuffer::GetPortDrops (uint32_t portNo) const
+{
+  DropMap_t::const_iterator it = m_portDrops.find (portNo);
+  return it != m_portDrops.end () ? it->second : 0;
+}
+
+bool
+OFSwitch13SharedBuffer::Admit (uint32_t queueBytes, uint32_t size) const
+{
+  NS_LOG_FUNCTION (this << queueBytes << size);
+
+  uint32_t freeBytes = m_size - m_used;
+  if (size > freeBytes)
+    {
+      NS_LOG_DEBUG ("No room for the packet in the shared buffer.");
+      return false;
+    }
+  if (queueBytes >= m_alpha * freeBytes)
+    {
+      NS_LOG_DEBUG ("Queue length " << queueBytes << " above threshold.");
+      return false;
+    }
+  return true;
+}
+
+void
+OFSwitch13SharedBuffer::Reserve (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  NS_ASSERT_MSG (m_used + size <= m_size, "Shared buffer overflow.");
+  m_used += size;
+}
+
+void
+OFSwitch13SharedBuffer::Release (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  NS_ASSERT_MSG (m_used >= size, "Shared buffer underflow.");
+  m_used -= size;
+}
+
+void
+OFSwitch13SharedBuffer::NotifyDrop (uint32_t portNo, uint32_t queueId,
+                                    Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << portNo << queueId << packet);
+
+  m_portDrops [portNo]++;
+  m_dropTrace (portNo, queueId, packet);
+}
+
+} // namespace ns3
@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of Campinas (Unicamp)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
+ */
+
+#ifndef OFSWITCH13_SHARED_BUFFER_H
+#define OFSWITCH13_SHARED_BUFFER_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \ingroup ofswitch13
+ *
+ * \brief Shared packet buffer pool for all port queues in an OpenFlow switch
+ * device, modeling the shared memory of switch ASICs. Packet admission into
+ * the internal queues uses the dynamic threshold algorithm: a packet is
+ * admitted only when the buffer has room for it and the internal queue length
+ * is below alpha times the free buffer space. In this way, the threshold for
+ * each queue shrinks as the buffer fills up, leaving room for other queues.
+ */
+class OFSwitch13SharedBuffer : public Object
+{
+public:
+  /**
+   * Register this type.
+   * \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Complete constructor.
+   * \param size The buffer size in bytes.
+   * \param alpha The dynamic threshold alpha parameter.
+   */
+  OFSwitch13SharedBuffer (uint32_t size, double alpha);
+  virtual ~OFSwitch13SharedBuffer ();  //!< Dummy destructor.
+
+  /**
+   * \name Private member accessors.
+   * \return The requested value.
+   */
+  //\{
+  uint32_t GetSize  (void) const;
+  uint32_t GetUsed  (void) const;
+  double   GetAlpha (void) const;
+  //\}
+
+  /**
+   * Get the number of packets dropped by the dynamic threshold at a port.
+   * \param portNo The switch port number.
+   * \return The number of dropped packets.
+   */
+  uint64_t GetPortDrops (uint32_t portNo) const;
+
+  /**
+   * Check the dynamic threshold admission for a packet.
+   * \param queueBytes The current internal queue length in bytes.
+   * \param size The packet size in bytes.
+   * \return True when the packet is admitted.
+   */
+  bool Admit (uint32_t queueBytes, uint32_t size) const;
+
+  /**
+   * \name Buffer space accounting.
+   * Reserve buffer space for a packet enqueued into an internal queue, or
+   * release the buffer space of a packet dequeued from it.
+   * \param size The packet size in bytes.
+   */
+  //\{
+  void Reserve (uint32_t size);
+  void Release (uint32_t size);
+  //\}
+
+  /**
+   * Notify a packet dropped by the dynamic threshold.
+   * \param portNo The switch port number.
+   * \param queueId The internal queue id.
+   * \param packet The dropped packet.
+   */
+  void NotifyDrop (uint32_t portNo, uint32_t queueId,
+                   Ptr<const Packet> packet);
+
+  /**
+   * TracedCallback signature for packets dropped by the shared buffer.
+   * \param portNo The switch port number.
+   * \param queueId The internal queue id.
+   * \param packet The dropped packet.
+   */
+  typedef void (*DropTracedCallback)(uint32_t portNo, uint32_t queueId,
+                                     Ptr<const Packet> packet);
+
+private:
+  /** Map saving the number of dropped packets by port number */
+  typedef std::map<uint32_t, uint64_t> DropMap_t;
+
+  uint32_t              m_size;       //!< Buffer size in bytes.
+  double                m_alpha;      //!< Dynamic threshold alpha.
+  TracedValue<uint32_t> m_used;       //!< Buffer space in use (bytes).
+  DropMap_t             m_portDrops;  //!< Dropped packets by port.
+
+  /** Trace source fired when a packet is dropped by the threshold. */
+  TracedCallback<uint32_t, uint32_t, Ptr<const Packet> > m_dropTrace;
+};
+
+} // namespace ns3
+#endif /* OFSWITCH13_SHARED_BUFFER_H */
@@ -18,7 +18,10 @@
  * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
  */
 
+#include <cstring>
+#include <ns3/uinteger.h>
 #include "ofswitch13-socket-handler.h"
+#include "ofswitch13-direct-channel.h"
 
 namespace ns3 {
 
@@ -31,15 +34,60 @@ OFSwitch13SocketHandler::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::OFSwitch13SocketHandler")
     .SetParent<Object> ()
     .SetGroupName ("OFSwitch13")
+    .AddAttribute ("CoalesceDelay",
+                   "Time to wait for more messages before writing them to "
+                   "the socket in a single send (zero to write immediately).",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (
+                     &OFSwitch13SocketHandler::m_coalesceDelay),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("HighWatermark",
+                   "Number of queued bytes that sets the congestion state "
+                   "(zero to disable).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (
+                     &OFSwitch13SocketHandler::m_highWatermark),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LowWatermark",
+                   "Number of queued bytes that clears the congestion state.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (
+                     &OFSwitch13SocketHandler::m_lowWatermark),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxTxBytes",
+                   "Maximum number of queued bytes. Messages beyond this "
+                   "limit are discarded (zero for unlimited).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (
+                     &OFSwitch13SocketHandler::m_maxTxBytes),
+                   MakeUintegerChecker<uint32_t> ())
+
+    .AddTraceSource ("Congestion",
+                     "Trace source indicating a congestion state change.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13SocketHandler::m_congestionTrace),
+                     "ns3::OFSwitch13SocketHandler::CongestionTracedCallback")
+    .AddTraceSource ("TxDrop",
+                     "Trace source indicating a message dropped by full "
+                     "tx queue.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13SocketHandler::m_txDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("TxQueueBytes",
+                     "Traced value indicating the number of queued bytes.",
+                     MakeTraceSourceAccessor (
+                       &OFSwitch13SocketHandler::m_txBytes),
+                     "ns3::TracedValueCallback::Uint32")
   ;
   return tid;
 }
 
 OFSwitch13SocketHandler::OFSwitch13SocketHandler (Ptr<Socket> socket)
   : m_socket (socket),
-  m_pendingPacket (0),
-  m_pendingBytes (0),
-  m_txQueue ()
+  m_rxBytes (0),
+  m_txQueue (),
+  m_txBytes (0),
+  m_congested (false)
 {
   NS_LOG_FUNCTION (this << socket);
 
@@ -50,6 +98,18 @@ OFSwitch13SocketHandler::OFSwitch13SocketHandler (Ptr<Socket> socket)
     MakeCallback (&OFSwitch13SocketHandler::Recv, this));
 }
 
+OFSwitch13SocketHandler::OFSwitch13SocketHandler (
+  Ptr<OFSwitch13DirectChannel> channel)
+  : m_socket (0),
+  m_channel (channel),
+  m_rxBytes (0),
+  m_txQueue (),
+  m_txBytes (0),
+  m_congested (false)
+{
+  NS_LOG_FUNCTION (this << channel);
+}
+
 OFSwitch13SocketHandler::~OFSwitch13SocketHandler ()
 {
   NS_LOG_FUNCTION (this);
@@ -63,14 +123,103 @@ OFSwitch13SocketHandler::SetReceiveCallback (MessageCallback cb)
   m_receivedMsg = cb;
 }
 
+void
+OFSwitch13SocketHandler::SetReceiveRawCallback (RawMessageCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_receivedRawMsg = cb;
+}
+
+void
+OFSwitch13SocketHandler::SetCongestionCallback (CongestionCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_congestionCb = cb;
+}
+
+void
+OFSwitch13SocketHandler::SetCloseCallback (CloseCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_closeCb = cb;
+}
+
+bool
+OFSwitch13SocketHandler::IsCongested (void) const
+{
+  return m_congested;
+}
+
+uint32_t
+OFSwitch13SocketHandler::GetTxQueueBytes (void) const
+{
+  return m_txBytes;
+}
+
+Ptr<Socket>
+OFSwitch13SocketHandler::GetSocket (void) const
+{
+  return m_socket;
+}
+
+void
+OFSwitch13SocketHandler::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_flushEvent.Cancel ();
+  while (!m_txQueue.empty ())
+    {
+      m_txQueue.pop ();
+    }
+  m_txBytes = 0;
+  if (m_socket)
+    {
+      ReleaseSocketCallbacks ();
+      m_socket->Close ();
+    }
+  else if (m_channel)
+    {
+      m_channel->Close ();
+    }
+}
+
 int
 OFSwitch13SocketHandler::SendMessage (Ptr<Packet> packet)
 {
   NS_LOG_FUNCTION (this << packet);
 
-  // Insert this message into tx queue and try to forward it to the socket.
+  if (!m_socket && !m_channel)
+    {
+      NS_LOG_WARN ("Direct channel connection closed. Discarding message.");
+      return -1;
+    }
+
+  uint32_t size = packet->GetSize ();
+  if (m_maxTxBytes && m_txBytes.Get () + size > m_maxTxBytes)
+    {
+      NS_LOG_WARN ("No space available in tx queue. Discarding message.");
+      m_txDropTrace (packet);
+      return -1;
+    }
+
+  // Insert this message into tx queue and try to forward it to the socket,
+  // unless we are waiting for more messages to coalesce.
   m_txQueue.push (packet);
-  Send (m_socket, m_socket->GetTxAvailable ());
+  m_txBytes += size;
+  UpdateCongestion ();
+  if (m_coalesceDelay.IsZero ())
+    {
+      Flush ();
+    }
+  else if (!m_flushEvent.IsRunning ())
+    {
+      m_flushEvent = Simulator::Schedule (
+          m_coalesceDelay, &OFSwitch13SocketHandler::Flush, this);
+    }
   return 0;
 }
 
@@ -79,8 +228,47 @@ OFSwitch13SocketHandler::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
 
-  m_socket = 0;
-  m_pendingPacket = 0;
+  m_flushEvent.Cancel ();
+  if (m_socket)
+    {
+      ReleaseSocketCallbacks ();
+      m_socket = 0;
+    }
+  if (m_channel)
+    {
+      m_channel->Detach (this);
+      m_channel = 0;
+    }
+  m_rxBuffer.clear ();
+  m_rxBytes = 0;
+  std::queue<Ptr<Packet> > empty;
+  m_txQueue.swap (empty);
+  m_txBytes = 0;
+  m_closeCb = MakeNullCallback<void, Ptr<OFSwitch13SocketHandler> > ();
+}
+
+void
+OFSwitch13SocketHandler::NotifyConstructionCompleted (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // An inverted pair would clear the congestion state right after setting it.
+  NS_ABORT_MSG_IF (m_highWatermark && m_lowWatermark > m_highWatermark,
+                   "LowWatermark must not be above HighWatermark.");
+
+  // Chain up.
+  Object::NotifyConstructionCompleted ();
+}
+
+void
+OFSwitch13SocketHandler::ReleaseSocketCallbacks (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // The socket may outlive this handler while closing the connection, so its
+  // callbacks can't point to this handler anymore.
+  m_socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+  m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
 }
 
 void
@@ -93,14 +281,29 @@ OFSwitch13SocketHandler::Send (Ptr<Socket> socket, uint32_t available)
       // Get a reference for the next packet in the queue and check for
       // available space in socket tx buffer.
       Ptr<Packet> packet = m_txQueue.front ();
-      if (socket->GetTxAvailable () < packet->GetSize ())
+      uint32_t room = socket->GetTxAvailable ();
+      if (room < packet->GetSize ())
         {
           NS_LOG_WARN ("No space available to send message now.");
-          return;
+          break;
         }
 
-      // Remove the packet from the queue and send it to the socket.
+      // Remove the packet from the queue and coalesce the following ones
+      // that also fit into socket tx buffer, so we write them all at once.
       m_txQueue.pop ();
+      room -= packet->GetSize ();
+      if (!m_txQueue.empty () && m_txQueue.front ()->GetSize () <= room)
+        {
+          packet = packet->Copy ();
+          while (!m_txQueue.empty () && m_txQueue.front ()->GetSize () <= room)
+            {
+              room -= m_txQueue.front ()->GetSize ();
+              packet->AddAtEnd (m_txQueue.front ());
+              m_txQueue.pop ();
+            }
+        }
+      m_txBytes -= packet->GetSize ();
+
       int retval = socket->Send (packet);
       if (retval == -1)
         {
@@ -108,6 +311,108 @@ OFSwitch13SocketHandler::Send (Ptr<Socket> socket, uint32_t available)
                         "Discarding. Socket error: " << socket->GetErrno ());
         }
     }
+  UpdateCongestion ();
+}
+
+void
+OFSwitch13SocketHandler::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_socket)
+    {
+      Send (m_socket, m_socket->GetTxAvailable ());
+    }
+  else if (m_channel)
+    {
+      SendDirect ();
+    }
+}
+
+void
+OFSwitch13SocketHandler::SendDirect (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Messages are not coalesced, as the channel transmits them individually.
+  if (!m_txQueue.empty () && !m_channel->IsBusy (this))
+    {
+      Ptr<Packet> packet = m_txQueue.front ();
+      m_txQueue.pop ();
+      m_txBytes -= packet->GetSize ();
+      m_channel->Transmit (this, packet);
+    }
+  UpdateCongestion ();
+}
+
+void
+OFSwitch13SocketHandler::RecvDirect (Ptr<Packet> packet, Address from)
+{
+  NS_LOG_FUNCTION (this << packet << from);
+
+  uint32_t length = packet->GetSize ();
+  if (!m_receivedRawMsg.IsNull ())
+    {
+      if (m_rxBuffer.size () < length)
+        {
+          m_rxBuffer.resize (length);
+        }
+      packet->CopyData (m_rxBuffer.data (), length);
+      m_receivedRawMsg (m_rxBuffer.data (), length, from);
+    }
+  else if (!m_receivedMsg.IsNull ())
+    {
+      m_receivedMsg (packet->Copy (), from);
+    }
+}
+
+void
+OFSwitch13SocketHandler::NotifyClose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_closeCb.IsNull ())
+    {
+      m_closeCb (this);
+    }
+}
+
+void
+OFSwitch13SocketHandler::UpdateCongestion (void)
+{
+  NS_LOG_FUNCTION (this << m_txBytes);
+
+  bool congested = m_congested;
+  if (!m_congested && m_highWatermark && m_txBytes >= m_highWatermark)
+    {
+      congested = true;
+    }
+  else if (m_congested && m_txBytes <= m_lowWatermark)
+    {
+      congested = false;
+    }
+  if (congested == m_congested)
+    {
+      return;
+    }
+
+  m_congested = congested;
+  NS_LOG_INFO ("Control channel congestion " << (congested ? "on" : "off") <<
+               " with " << m_txBytes << " queued bytes.");
+  m_congestionTrace (congested);
+  if (!m_congestionCb.IsNull ())
+    {
+      Address peer;
+      if (m_socket)
+        {
+          m_socket->GetPeerName (peer);
+        }
+      else
+        {
+          peer = m_channel->GetPeerAddress (this);
+        }
+      m_congestionCb (congested, peer);
+    }
 }
 
 void
@@ -118,47 +423,63 @@ OFSwitch13SocketHandler::Recv (Ptr<Socket> socket)
   static const size_t ofpHeaderSize = sizeof (struct ofp_header);
   Address from;
 
-  // Repeat the loop until socket buffer gets empty.
+  // Drain the socket, appending all available bytes to the contiguous receive
+  // buffer (after any incomplete message left from previous calls).
   while (socket->GetRxAvailable ())
     {
-      // If we don't have pending bytes from an incomplete OpenFlow messages it
-      // means that this is the start of a new message.
-      if (!m_pendingBytes)
+      Ptr<Packet> chunk = socket->RecvFrom (socket->GetRxAvailable (), 0, from);
+      uint32_t read = chunk->GetSize ();
+      if (m_rxBuffer.size () < m_rxBytes + read)
         {
-          // At least 8 bytes from the OpenFlow header must be available.
-          if (socket->GetRxAvailable () < 8)
-            {
-              return; // Wait for more bytes.
-            }
+          m_rxBuffer.resize (m_rxBytes + read);
+        }
+      chunk->CopyData (m_rxBuffer.data () + m_rxBytes, read);
+      m_rxBytes += read;
+    }
 
-          // Read the OpenFlow header and get the OpenFlow message size.
-          struct ofp_header header;
-          m_pendingPacket = socket->RecvFrom (ofpHeaderSize, 0, from);
-          m_pendingPacket->CopyData ((uint8_t*)&header, ofpHeaderSize);
-          m_pendingBytes = ntohs (header.length) - ofpHeaderSize;
+  // Deliver all complete OpenFlow messages in the buffer in a single batch.
+  size_t offset = 0;
+  while (m_rxBytes - offset >= ofpHeaderSize)
+    {
+      uint8_t *data = m_rxBuffer.data () + offset;
+      size_t length = ntohs (((struct ofp_header*)data)->length);
+      if (length < ofpHeaderSize)
+        {
+          // We can't find the next message boundary anymore.
+          NS_LOG_ERROR ("Invalid OpenFlow message length. Discarding " <<
+                        m_rxBytes - offset << " bytes.");
+          m_rxBytes = 0;
+          return;
+        }
+      if (m_rxBytes - offset < length)
+        {
+          break; // Wait for more bytes.
         }
 
-      // If we have pending bytes from an incomplete OpenFlow message and we
-      // also have bytes available to read at socket, let's read them now.
-      uint32_t read = std::min (m_pendingBytes, socket->GetRxAvailable ());
-      if (read)
+      // Let's send the message to the registered callback.
+      if (!m_receivedRawMsg.IsNull ())
+        {
+          m_receivedRawMsg (data, length, from);
+        }
+      else if (!m_receivedMsg.IsNull ())
         {
-          m_pendingPacket->AddAtEnd (socket->RecvFrom (read, 0, from));
-          m_pendingBytes -= read;
+          m_receivedMsg (Create<Packet> (data, length), from);
         }
+      offset += length;
 
-      // If we don't have pending bytes anymore it means that now we have a
-      // complete OpenFlow message.
-      if (!m_pendingBytes)
+      // The callback may have disposed this handler.
+      if (!m_socket)
         {
-          // Let's send the message to the registered callback.
-          if (!m_receivedMsg.IsNull ())
-            {
-              m_receivedMsg (m_pendingPacket, from);
-            }
-          m_pendingPacket = 0;
+          return;
         }
     }
+
+  // Move the incomplete message (if any) to the start of the buffer.
+  if (offset)
+    {
+      m_rxBytes -= offset;
+      memmove (m_rxBuffer.data (), m_rxBuffer.data () + offset, m_rxBytes);
+    }
 }
 
 } // namespace ns3
@@ -25,25 +25,41 @@
 #include <ns3/log.h>
 #include <ns3/packet.h>
 #include <ns3/socket.h>
+#include <ns3/traced-callback.h>
+#include <ns3/traced-value.h>
 #include "ofswitch13-interface.h"
 #include <queue>
+#include <vector>
 
 namespace ns3 {
 
+class OFSwitch13DirectChannel;
+
 /**
  * \ingroup ofswitch13
  * Class used to read/send single OpenFlow message from/to an open socket.
- * The TCP socket receive callback is connected to the Recv () method, which is
- * responsible for reading the correct number of bytes of a complete OpenFlow
- * message. When the OpenFlow message is completely received, it is sent to the
- * connected callback that was previously set using the SetReceiveCallback ()
- * method. On the other direction, the TCP socket send callback is connected to
- * the Send () method that forwards OpenFlow message received by the
- * SendMessage () method to the open socket, respecting the original order of
- * the messages.
+ * The TCP socket receive callback is connected to the Recv () method, which
+ * drains all available bytes from the socket into a reusable contiguous
+ * receive buffer. All complete OpenFlow messages in this buffer are then
+ * delivered in a single batch, in order, to the connected callback that was
+ * previously set using the SetReceiveRawCallback () (preferred, as the message
+ * is delivered as a slice of the receive buffer, without further copies) or
+ * the SetReceiveCallback () method. On the other direction, the TCP socket
+ * send callback is connected to the Send () method that forwards OpenFlow
+ * message received by the SendMessage () method to the open socket,
+ * respecting the original order of the messages. Queued messages are
+ * coalesced into a single socket write whenever possible, optionally waiting
+ * for more messages during the CoalesceDelay interval. When the number of
+ * queued bytes crosses the HighWatermark and then the LowWatermark, the
+ * congestion callback is invoked, so the owner can throttle the generation
+ * of new messages. The handler can also be attached to one end of an
+ * OFSwitch13DirectChannel, exchanging messages with the other end without
+ * any socket.
  */
 class OFSwitch13SocketHandler : public Object
 {
+  friend class OFSwitch13DirectChannel;
+
 public:
   /**
    * Register this type.
@@ -56,6 +72,13 @@ public:
    * \param socket The socket pointer.
    */
   OFSwitch13SocketHandler (Ptr<Socket> socket);
+
+  /**
+   * Complete constructor for direct channels.
+   * \param channel The direct channel.
+   * \see OFSwitch13DirectChannel::CreateHandler ()
+   */
+  OFSwitch13SocketHandler (Ptr<OFSwitch13DirectChannel> channel);
   virtual ~OFSwitch13SocketHandler ();   //!< Dummy destructor, see DoDispose.
 
   /**
@@ -64,6 +87,33 @@ public:
    */
   typedef Callback <void, Ptr<Packet>, Address > MessageCallback;
 
+  /**
+   * \param data The pointer to the received OpenFlow message. The bytes are
+   *        only valid during the callback execution, but they can be changed
+   *        in place by the callback.
+   * \param size The message size.
+   * \param sender The address of the sender.
+   */
+  typedef Callback <void, uint8_t*, size_t, Address > RawMessageCallback;
+
+  /**
+   * \param congested True when the channel becomes congested, false when it
+   *        is not congested anymore.
+   * \param peer The address of the remote peer.
+   */
+  typedef Callback <void, bool, Address > CongestionCallback;
+
+  /**
+   * \param handler The socket handler of the closed connection.
+   */
+  typedef Callback <void, Ptr<OFSwitch13SocketHandler> > CloseCallback;
+
+  /**
+   * TracedCallback signature for control channel congestion.
+   * \param congested The congestion state.
+   */
+  typedef void (*CongestionTracedCallback)(bool congested);
+
   /**
    * Set the callback to invoke whenever an OpenFlow message has been received
    * at the associated socket.
@@ -72,17 +122,74 @@ public:
   void SetReceiveCallback (MessageCallback cb);
 
   /**
-   * Send an OpenFlow message to the TCP socket.
+   * Set the callback to invoke whenever an OpenFlow message has been received
+   * at the associated socket, with the message bytes in wire format. When
+   * set, this callback is used instead of the one set by SetReceiveCallback.
+   * \param cb The callback to invoke.
+   */
+  void SetReceiveRawCallback (RawMessageCallback cb);
+
+  /**
+   * Set the callback to invoke whenever the congestion state of this channel
+   * changes, based on the high and low watermarks.
+   * \param cb The callback to invoke.
+   */
+  void SetCongestionCallback (CongestionCallback cb);
+
+  /**
+   * Set the callback to invoke when a direct channel connection is closed by
+   * any of its ends. TCP connections are notified by the socket close
+   * callbacks instead.
+   * \param cb The callback to invoke.
+   */
+  void SetCloseCallback (CloseCallback cb);
+
+  /**
+   * \return True when the number of queued bytes reached the high watermark
+   *         and did not get back to the low watermark yet.
+   */
+  bool IsCongested (void) const;
+
+  /**
+   * \return The number of bytes waiting in the tx queue.
+   */
+  uint32_t GetTxQueueBytes (void) const;
+
+  /**
+   * \return The TCP socket, or 0 for direct channel connections.
+   */
+  Ptr<Socket> GetSocket (void) const;
+
+  /**
+   * Send an OpenFlow message to the TCP socket. When the tx queue is full
+   * (see the MaxTxBytes attribute), the message is discarded.
    * \param packet The packet with the OpenFlow message.
    * \return 0 if everything's ok, otherwise an error number.
    */
   int SendMessage (Ptr<Packet> packet);
 
+  /**
+   * Close the connection. Messages still waiting in the tx queue are
+   * discarded, and messages received from a TCP socket are not delivered
+   * anymore. Closing a direct channel connection detaches both ends from
+   * the channel, discarding messages in transit, and fires the close callback
+   * of both handlers.
+   */
+  void Close (void);
+
 protected:
   /** Destructor implementation */
   virtual void DoDispose ();
 
+  // Inherited from ObjectBase.
+  virtual void NotifyConstructionCompleted (void);
+
 private:
+  /**
+   * Reset the socket send and receive callbacks pointing to this handler.
+   */
+  void ReleaseSocketCallbacks (void);
+
   /**
    * Callback for bytes available in tx buffer.
    * \param socket The connected socket.
@@ -90,6 +197,35 @@ private:
    */
   void Send (Ptr<Socket> socket, uint32_t available);
 
+  /**
+   * Send queued messages to the socket or direct channel. This is also
+   * called when the coalescing timer expires.
+   */
+  void Flush (void);
+
+  /**
+   * Send the next queued message to the direct channel, if it is not busy.
+   */
+  void SendDirect (void);
+
+  /**
+   * Receive an OpenFlow message from the direct channel.
+   * \param packet The packet with a single OpenFlow message.
+   * \param from The address of the sender end.
+   */
+  void RecvDirect (Ptr<Packet> packet, Address from);
+
+  /**
+   * Notify the closing of the direct channel connection.
+   */
+  void NotifyClose (void);
+
+  /**
+   * Check the number of queued bytes against the high and low watermarks,
+   * notifying any change in the congestion state.
+   */
+  void UpdateCongestion (void);
+
   /**
    * Callback for bytes available in rx buffer.
    * \param socket The connected socket.
@@ -97,10 +233,27 @@ private:
   void Recv (Ptr<Socket> socket);
 
   Ptr<Socket>               m_socket;         //!< TCP socket.
-  Ptr<Packet>               m_pendingPacket;  //!< Buffer for receiving bytes.
-  uint32_t                  m_pendingBytes;   //!< Pending bytes for message.
+  Ptr<OFSwitch13DirectChannel> m_channel;   //!< Direct channel.
+  std::vector<uint8_t>      m_rxBuffer;       //!< Contiguous rx buffer.
+  size_t                    m_rxBytes;        //!< Bytes into rx buffer.
   MessageCallback           m_receivedMsg;    //!< OpenFlow message callback.
+  RawMessageCallback        m_receivedRawMsg; //!< Raw message callback.
   std::queue<Ptr<Packet> >  m_txQueue;        //!< TX queue.
+  TracedValue<uint32_t>     m_txBytes;        //!< Bytes into TX queue.
+  uint32_t                  m_maxTxBytes;     //!< TX queue limit.
+  uint32_t                  m_highWatermark;  //!< Congestion on threshold.
+  uint32_t                  m_lowWatermark;   //!< Congestion off threshold.
+  bool                      m_congested;      //!< Congestion state.
+  Time                      m_coalesceDelay;  //!< Coalescing delay.
+  EventId                   m_flushEvent;     //!< Coalescing timer.
+  CongestionCallback        m_congestionCb;   //!< Congestion callback.
+  CloseCallback             m_closeCb;        //!< Close callback.
+
+  /** Trace source fired when the congestion state changes. */
+  TracedCallback<bool> m_congestionTrace;
+
+  /** Trace source fired when a message is discarded by a full TX queue. */
+  TracedCallback<Ptr<const Packet> > m_txDropTrace;
 };
 
 } // namespace ns3